@@ -5,26 +5,60 @@
 #include "FunctionRegistry.hpp"
 #include <stdexcept>
 
-void FunctionRegistry::registerFunction(const std::string &name,
-                                        RegisteredFunction func) {
-    functions[name] = std::move(func);
+FunctionRegistry::FunctionId FunctionRegistry::registerFunction(
+    const std::string &name, RegisteredFunction func) {
+    auto handler = std::make_shared<const RegisteredFunction>(std::move(func));
+    std::unique_lock lock(mutex);
+    const auto [it, added] =
+        ids.try_emplace(name, static_cast<FunctionId>(handlers.size()));
+    if (added) {
+        handlers.push_back(std::move(handler));
+    } else {
+        handlers[it->second] = std::move(handler);
+    }
+    return it->second;
 }
 
-json FunctionRegistry::callFunction(const std::string &name, const json &args) {
-    auto it = functions.find(name);
-    if (it == functions.end()) {
-        return {{"status", "error"},
-                {"message", "Function not found: " + name},
-                {"data", nullptr}};
+json FunctionRegistry::callFunction(const FunctionId id, const json &args) {
+    // the function is called outside the lock, so it may itself register
+    // functions
+    std::shared_ptr<const RegisteredFunction> func;
+    {
+        std::shared_lock lock(mutex);
+        if (id >= handlers.size()) {
+            return {{"status", "error"},
+                    {"message", "Function not found: #" + std::to_string(id)},
+                    {"data", nullptr}};
+        }
+        func = handlers[id];
     }
 
     try {
-        return it->second(args);
+        return (*func)(args);
     } catch (const std::exception &e) {
         return {{"status", "error"}, {"message", e.what()}, {"data", nullptr}};
     }
 }
 
+json FunctionRegistry::callFunction(const std::string &name, const json &args) {
+    const std::optional<FunctionId> id = functionId(name);
+    if (!id) {
+        return {{"status", "error"},
+                {"message", "Function not found: " + name},
+                {"data", nullptr}};
+    }
+    return callFunction(*id, args);
+}
+
+std::optional<FunctionRegistry::FunctionId> FunctionRegistry::functionId(
+    const std::string &name) const {
+    std::shared_lock lock(mutex);
+    const auto it = ids.find(name);
+    if (it == ids.end()) return std::nullopt;
+    return it->second;
+}
+
 bool FunctionRegistry::hasFunction(const std::string &name) const {
-    return functions.find(name) != functions.end();
+    std::shared_lock lock(mutex);
+    return ids.find(name) != ids.end();
 }
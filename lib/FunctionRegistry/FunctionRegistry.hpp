@@ -4,33 +4,58 @@
 
 #ifndef FUNCTIONREGISTRY_HPP
 #define FUNCTIONREGISTRY_HPP
+#include <cstdint>
 #include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
+#include <optional>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 using json = nlohmann::json;
 
+// Functions may be called from several threads at once, and registered
+// while others are being called. Each name gets a stable integer id when
+// first registered; calls by id index a flat table of handlers, and the
+// names are only looked up for calls by name and introspection.
 class FunctionRegistry {
 public:
     using RegisteredFunction = std::function<json(const json &args)>;
-    // Register a function with a name
-    void registerFunction(const std::string &name, RegisteredFunction func);
+    using FunctionId = uint32_t;
+    // Register a function with a name; registering a name again replaces
+    // its function and keeps its id
+    FunctionId registerFunction(const std::string &name,
+                                RegisteredFunction func);
+    // Call a registered function by id with json arguments
+    json callFunction(FunctionId id, const json &args);
     // Call a registered function by name with json arguments
     json callFunction(const std::string &name, const json &args);
+    // The id of a registered function, if any
+    std::optional<FunctionId> functionId(const std::string &name) const;
     // Check if a function is registered
     bool hasFunction(const std::string &name) const;
     std::vector<std::string> getRegisteredFunctions() {
+        std::shared_lock lock(mutex);
         std::vector<std::string> function_names;
-        for (const auto &pair : functions) {
+        for (const auto &pair : ids) {
             function_names.push_back(pair.first);
         }
         return function_names;
     }
+    // every registered name with its id, for callers that dispatch by id
+    std::map<std::string, FunctionId> getFunctionIds() const {
+        std::shared_lock lock(mutex);
+        return {ids.begin(), ids.end()};
+    }
 
 private:
-    std::unordered_map<std::string, RegisteredFunction> functions;
+    mutable std::shared_mutex mutex;
+    // indexed by id; shared so a call outlives its function being replaced
+    std::vector<std::shared_ptr<const RegisteredFunction>> handlers;
+    std::unordered_map<std::string, FunctionId> ids;
 };
 #endif  // FUNCTIONREGISTRY_HPP
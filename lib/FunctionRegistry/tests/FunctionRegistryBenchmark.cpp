@@ -0,0 +1,48 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "FunctionRegistry.hpp"
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// Calls per second by name and by id, whose speed depends on the machine;
+// run by hand rather than by ctest.
+
+namespace {
+// calls per second of call, made count times
+template <typename Call>
+double call_rate(const int count, const Call &call) {
+    const auto start = std::chrono::steady_clock::now();
+    size_t results = 0;
+    for (int i = 0; i < count; i++) results += call().is_null();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (results != static_cast<size_t>(count)) {
+        std::fprintf(stderr, "unexpected call results\n");
+    }
+    return count / elapsed.count();
+}
+}  // namespace
+
+int main() {
+    FunctionRegistry registry;
+    // many names, so the lookup by name is not served by a tiny table
+    for (int i = 0; i < 500; i++) {
+        registry.registerFunction("padding_function_" + std::to_string(i),
+                                  [](const json &) -> json { return nullptr; });
+    }
+    const std::string name = "membrane_benchmark_noop";
+    const auto id = registry.registerFunction(
+        name, [](const json &) -> json { return nullptr; });
+    const json args = json::array();
+    constexpr int calls = 200000;
+
+    const double by_name =
+        call_rate(calls, [&] { return registry.callFunction(name, args); });
+    const double by_id =
+        call_rate(calls, [&] { return registry.callFunction(id, args); });
+    std::printf("calls/s by name: %.0f, by id: %.0f\n", by_name, by_id);
+    return 0;
+}
@@ -162,6 +162,53 @@ TEST_F(FunctionRegistryTest, FunctionThrowingException) {
     EXPECT_EQ(result["data"], nullptr);
 }
 
+TEST_F(FunctionRegistryTest, StableFunctionIds) {
+    const auto add_id = registry.functionId("add");
+    ASSERT_TRUE(add_id.has_value());
+    EXPECT_FALSE(registry.functionId("nonexistent").has_value());
+
+    // registering the name again replaces the function but keeps its id
+    const auto replaced_id = registry.registerFunction("add", [](const json& args) -> json {
+        return {{"status", "success"}, {"data", args["a"].get<int>() - args["b"].get<int>()}};
+    });
+    EXPECT_EQ(replaced_id, *add_id);
+    EXPECT_EQ(registry.callFunction(*add_id, {{"a", 5}, {"b", 3}})["data"], 2);
+
+    const auto new_id = registry.registerFunction("negate", [](const json& args) -> json {
+        return {{"status", "success"}, {"data", -args["a"].get<int>()}};
+    });
+    EXPECT_NE(new_id, *add_id);
+    EXPECT_EQ(registry.callFunction(new_id, {{"a", 4}})["data"], -4);
+    const auto ids = registry.getFunctionIds();
+    EXPECT_EQ(ids.at("add"), *add_id);
+    EXPECT_EQ(ids.at("negate"), new_id);
+
+    json result = registry.callFunction(new_id + 100, {});
+    EXPECT_EQ(result["status"], "error");
+    EXPECT_EQ(result["data"], nullptr);
+}
+
+// A call by id reaches the same function as the call by its name, among
+// many registered ones
+TEST_F(FunctionRegistryTest, CallsByNameAndIdAgree) {
+    for (int i = 0; i < 500; i++) {
+        registry.registerFunction("padding_function_" + std::to_string(i), [i](const json& args) -> json {
+            return {{"status", "success"}, {"data", args["a"].get<int>() * 1000 + i}};
+        });
+    }
+    for (int i = 0; i < 500; i += 37) {
+        const std::string name = "padding_function_" + std::to_string(i);
+        const auto id = registry.functionId(name);
+        ASSERT_TRUE(id.has_value()) << name;
+        const json args = {{"a", i}};
+        const json by_name = registry.callFunction(name, args);
+        EXPECT_EQ(registry.callFunction(*id, args), by_name) << name;
+        EXPECT_EQ(by_name["data"], i * 1000 + i);
+    }
+    EXPECT_EQ(registry.callFunction("add", {{"a", 2}, {"b", 3}}),
+              registry.callFunction(*registry.functionId("add"), {{"a", 2}, {"b", 3}}));
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
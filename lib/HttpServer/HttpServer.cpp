@@ -6,9 +6,45 @@
 #include <arpa/inet.h>
 #include <poll.h>
 #include <algorithm>
+#include <array>
+#include <climits>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <sstream>
+#include <string_view>
+
+namespace {
+// whether the Accept-Encoding header lists coding with a non-zero q-value
+bool accepts_encoding(
+    const std::unordered_map<std::string, std::string> &headers,
+    const std::string_view coding) {
+    const auto header = headers.find("accept-encoding");
+    if (header == headers.end()) return false;
+    std::string_view list = header->second;
+    while (!list.empty()) {
+        const size_t comma = list.find(',');
+        std::string_view item = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view()
+                                               : list.substr(comma + 1);
+        const size_t params = item.find(';');
+        std::string_view name = item.substr(0, params);
+        while (!name.empty() && name.front() == ' ') name.remove_prefix(1);
+        while (!name.empty() && name.back() == ' ') name.remove_suffix(1);
+        if (!std::ranges::equal(name, coding, [](const char a, const char b) {
+                return ::tolower(a) == b;
+            })) {
+            continue;
+        }
+        if (params == std::string_view::npos) return true;
+        const size_t q = item.find("q=", params);
+        if (q == std::string_view::npos) return true;
+        const std::string value(item.substr(q + 2));
+        return std::strtod(value.c_str(), nullptr) > 0;
+    }
+    return false;
+}
+}  // namespace
 
 HttpServer::HttpServer(const int port)
     : server_fd(-1), port(port), running(false) {}
@@ -28,6 +64,17 @@ void HttpServer::mount_vfs(const std::string &prefix,
     mounted_vfs[normalized_prefix] = vfs;
 }
 
+void HttpServer::mount_resource_pack(const std::string &prefix,
+                                     const ResourcePack *pack) {
+    std::string normalized_prefix = prefix;
+    if (!normalized_prefix.empty() && normalized_prefix.back() != '/')
+        normalized_prefix += '/';
+
+    if (normalized_prefix.front() != '/')
+        normalized_prefix = '/' + normalized_prefix;
+    mounted_packs[normalized_prefix] = pack;
+}
+
 void HttpServer::register_route(
     const std::string &path,
     const std::function<
@@ -38,6 +85,19 @@ void HttpServer::register_route(
     route_handlers[path] = handler;
 }
 
+void HttpServer::register_prefix_route(const std::string &prefix,
+                                       PrefixHandler handler,
+                                       const size_t max_body_size) {
+    prefix_routes.emplace_back(prefix, std::move(handler), max_body_size);
+}
+
+void HttpServer::set_max_body_size(const std::string &prefix,
+                                   const size_t bytes) {
+    for (auto &route : prefix_routes) {
+        if (route.prefix == prefix) route.max_body_size = bytes;
+    }
+}
+
 bool HttpServer::start() {
     if (running) return false;
 
@@ -154,8 +214,9 @@ void HttpServer::handle_client(ClientConnection client) {
     client_thread.detach();
 }
 
-bool HttpServer::parse_request(const int client_socket, HttpRequest &request) {
-    char buffer[4096];
+bool HttpServer::parse_request(const int client_socket,
+                               HttpRequest &request) const {
+    char buffer[READ_BUFFER_SIZE];
     std::string request_str;
     bool headers_complete = false;
     size_t content_length = 0;
@@ -190,7 +251,12 @@ bool HttpServer::parse_request(const int client_socket, HttpRequest &request) {
 
         buffer[bytes_read] = '\0';
 
-        request_str.append(buffer, bytes_read);
+        // once the headers are parsed, the rest goes straight to the body
+        if (headers_complete) {
+            request.body.append(buffer, bytes_read);
+        } else {
+            request_str.append(buffer, bytes_read);
+        }
 
         if (!headers_complete) {
             if (const auto header_end = request_str.find("\r\n\r\n");
@@ -250,12 +316,29 @@ bool HttpServer::parse_request(const int client_socket, HttpRequest &request) {
                         }
                     }
                 }
-                request.body = request_str.substr(header_end + 4);
+                // refused before any of the body is read or allocated
+                if (content_length > max_body_size_for(request.path)) {
+                    send_response(client_socket, 413, get_status_message(413),
+                                  {{"Connection", "close"}}, "");
+                    shutdown(client_socket, SHUT_WR);
+                    return false;
+                }
+                request.body.reserve(
+                    std::min(content_length, MAX_BODY_RESERVE));
+                request.body.append(request_str, header_end + 4);
                 headers_complete = true;
                 if (request.body.length() >= content_length) {
                     request.body.resize(content_length);
                     break;
                 }
+                // a client asking first waits for this before the body
+                if (const auto expect = request.headers.find("expect");
+                    expect != request.headers.end() &&
+                    expect->second == "100-continue") {
+                    constexpr std::string_view proceed =
+                        "HTTP/1.1 100 Continue\r\n\r\n";
+                    send(client_socket, proceed.data(), proceed.size(), 0);
+                }
             }
         } else {
             if (request.body.length() >= content_length) {
@@ -268,8 +351,21 @@ bool HttpServer::parse_request(const int client_socket, HttpRequest &request) {
     return true;
 }
 
+size_t HttpServer::max_body_size_for(std::string_view path) const {
+    // routed as process_request does: exact routes, then prefix routes
+    if (route_handlers.contains(std::string(path))) return max_body_size;
+    if (const size_t query = path.find('?'); query != std::string_view::npos)
+        path = path.substr(0, query);
+    for (const auto &route : prefix_routes) {
+        if (!path.starts_with(route.prefix)) continue;
+        const size_t limit = route.max_body_size;
+        return limit != 0 ? limit : max_body_size.load();
+    }
+    return max_body_size;
+}
+
 void HttpServer::process_request(const int client_socket,
-                                 const HttpRequest &request) {
+                                 HttpRequest &request) {
     if (const auto handler_it = route_handlers.find(request.path);
         handler_it != route_handlers.end()) {
         std::string response_body;
@@ -280,7 +376,13 @@ void HttpServer::process_request(const int client_socket,
                       response_body);
         return;
     }
-    if (serve_file_from_vfs(client_socket, request.path)) {
+    if (serve_prefix_route(client_socket, request)) {
+        return;
+    }
+    if (serve_file_from_pack(client_socket, request)) {
+        return;
+    }
+    if (serve_file_from_vfs(client_socket, request)) {
         return;
     }
     const std::string not_found_body =
@@ -291,57 +393,216 @@ void HttpServer::process_request(const int client_socket,
     send_response(client_socket, 404, "Not Found", headers, not_found_body);
 }
 
+bool HttpServer::serve_prefix_route(const int client_socket,
+                                    HttpRequest &request) {
+    std::string_view path = request.path;
+    if (const size_t query = path.find('?'); query != std::string_view::npos)
+        path = path.substr(0, query);
+    for (const auto &route : prefix_routes) {
+        if (!path.starts_with(route.prefix)) continue;
+        RawResponse response;
+        route.handler(request.method, path.substr(route.prefix.size()),
+                      request.headers, request.body, response);
+
+        std::string head = "HTTP/1.1 " + std::to_string(response.status) +
+                           " " + get_status_message(response.status) + "\r\n";
+        for (const auto &[key, value] : response.headers) {
+            head += key + ": " + value + "\r\n";
+        }
+        head += "Content-Length: " + std::to_string(response.body.size()) +
+                "\r\n\r\n";
+        std::array<iovec, 2> iov = {
+            iovec{head.data(), head.size()},
+            iovec{const_cast<unsigned char *>(response.body.data()),
+                  response.body.size()}};
+        if (!send_all(client_socket, iov.data(),
+                      response.body.empty() ? 1 : 2)) {
+            std::cerr << "Failed to send response: " << strerror(errno)
+                      << std::endl;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool HttpServer::serve_file_from_pack(const int client_socket,
+                                      const HttpRequest &request) {
+    std::string_view path = request.path;
+    if (const size_t query = path.find('?'); query != std::string_view::npos)
+        path = path.substr(0, query);
+    if (!path.empty() && path[0] == '/') path.remove_prefix(1);
+
+    for (const auto &[prefix, pack] : mounted_packs) {
+        // prefixes are stored as "/.../"
+        const std::string_view relative_prefix =
+            std::string_view(prefix).substr(1);
+        if (!path.starts_with(relative_prefix)) continue;
+        std::string_view pack_path = path.substr(relative_prefix.size());
+        if (pack_path.empty()) pack_path = "index.html";
+
+        const ResourceRecord *record = pack->find(pack_path);
+        if (record == nullptr) continue;
+        if (const auto match = request.headers.find("if-none-match");
+            match != request.headers.end() && match->second == record->etag) {
+            send_response(client_socket, 304, "Not Modified",
+                          {{"ETag", std::string(record->etag)}}, "");
+            return true;
+        }
+        const std::span<const unsigned char> contents =
+            pack->contents(*record);
+        std::string response = "HTTP/1.1 200 OK\r\n";
+        response += "Content-Type: ";
+        response += record->mime_type;
+        response += "\r\nContent-Length: ";
+        response += std::to_string(contents.size());
+        response += "\r\nETag: ";
+        response += record->etag;
+        response += "\r\n\r\n";
+        // headers and contents in one gathered write, waiting while the
+        // socket is full so large assets are sent whole
+        std::array<iovec, 2> iov = {
+            {{response.data(), response.size()},
+             {const_cast<unsigned char *>(contents.data()), contents.size()}}};
+        if (!send_all(client_socket, iov.data(), contents.empty() ? 1 : 2)) {
+            std::cerr << "Failed to send file: " << strerror(errno)
+                      << std::endl;
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
 bool HttpServer::serve_file_from_vfs(const int client_socket,
-                                     const std::string &path) {
-    std::string normalized_path = path;
+                                     const HttpRequest &request) {
+    std::string normalized_path = request.path;
     if (normalized_path.empty() || normalized_path[0] != '/') {
         normalized_path = '/' + normalized_path;
     }
 
     for (const auto &[prefix, vfs] : mounted_vfs) {
         if (normalized_path.compare(0, prefix.length(), prefix) == 0) {
-            std::string vfs_path = normalized_path.substr(prefix.length());
+            std::string_view vfs_path =
+                std::string_view(normalized_path).substr(prefix.length());
             if (vfs_path.empty() || vfs_path == "/") vfs_path = "index.html";
 
             if (!vfs_path.empty() && vfs_path[0] == '/')
-                vfs_path = vfs_path.substr(1);
-
-            if (vfs->exists(vfs_path)) {
-                if (const VirtualFileSystem::FileEntry *file =
-                        vfs->get_file(vfs_path)) {
-                    std::unordered_map<std::string, std::string> headers = {
-                        {"Content-Type", file->mime_type},
-                        {"Content-Length", std::to_string(file->data.size())}};
-
-                    std::string response = "HTTP/1.1 200 OK\r\n";
-                    for (const auto &[key, value] : headers) {
-                        response += key + ": " + value + "\r\n";
-                    }
-                    response += "\r\n";
+                vfs_path.remove_prefix(1);
+
+            // one lookup; the handle keeps this version alive while it is
+            // sent, even if the entry is replaced or removed meanwhile
+            const VirtualFileSystem::FileHandle stored =
+                vfs->get_stored_file(vfs_path);
+            if (!stored) continue;
+
+            // compressed entries are sent as stored to clients that accept
+            // them, and inflated for the others. HTTP's deflate is the zlib
+            // format, so a raw deflate stream from a ZIP goes out as gzip
+            // only.
+            std::string_view encoding;
+            if (stored->compressed) {
+                if (accepts_encoding(request.headers, "gzip")) {
+                    encoding = "gzip";
+                } else if (!stored->raw_deflate &&
+                           accepts_encoding(request.headers, "deflate")) {
+                    encoding = "deflate";
+                }
+            }
+            const VirtualFileSystem::FileHandle file =
+                stored->compressed && encoding.empty()
+                    ? vfs->uncompressed(stored)
+                    : stored;
+            // chunked entries are sent chunk by chunk, without joining them
+            std::vector<std::span<const unsigned char>> body = file->scatter();
+
+            // gzip wraps the raw deflate stream of the zlib data: a fixed
+            // header, and the CRC-32 and size of the contents after it
+            std::array<unsigned char, 10> gzip_header = {
+                0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+            std::array<unsigned char, 8> gzip_trailer{};
+            if (encoding == "gzip") {
+                if (!file->raw_deflate) {
+                    body.front() =
+                        body.front().subspan(2, body.front().size() - 6);
+                }
+                for (int i = 0; i < 4; ++i) {
+                    gzip_trailer[i] =
+                        static_cast<unsigned char>(file->crc32 >> (8 * i));
+                    gzip_trailer[4 + i] = static_cast<unsigned char>(
+                        file->original_size >> (8 * i));
+                }
+            }
+            size_t content_length = 0;
+            for (const auto piece : body) content_length += piece.size();
+            if (encoding == "gzip") {
+                content_length += gzip_header.size() + gzip_trailer.size();
+            }
 
-                    if (send(client_socket, response.c_str(), response.length(),
-                             0) < 0) {
-                        std::cerr << "Failed to send response headers: "
-                                  << strerror(errno) << std::endl;
-                        return false;
-                    }
+            std::string response = "HTTP/1.1 200 OK\r\n";
+            response += "Content-Type: " + file->mime_type + "\r\n";
+            response +=
+                "Content-Length: " + std::to_string(content_length) + "\r\n";
+            if (stored->compressed) {
+                response += "Vary: Accept-Encoding\r\n";
+            }
+            if (!encoding.empty()) {
+                response += "Content-Encoding: ";
+                response += encoding;
+                response += "\r\n";
+            }
+            response += "\r\n";
 
-                    if (send(client_socket, file->data.data(),
-                             file->data.size(), 0) < 0) {
-                        std::cerr
-                            << "Failed to send file data: " << strerror(errno)
-                            << std::endl;
-                        return false;
-                    }
-                    return true;
-                }
+            std::vector<iovec> iov;
+            iov.reserve(body.size() + 3);
+            iov.push_back({response.data(), response.size()});
+            if (encoding == "gzip") {
+                iov.push_back({gzip_header.data(), gzip_header.size()});
+            }
+            for (const auto piece : body) {
+                iov.push_back({const_cast<unsigned char *>(piece.data()),
+                               piece.size()});
+            }
+            if (encoding == "gzip") {
+                iov.push_back({gzip_trailer.data(), gzip_trailer.size()});
+            }
+            if (!send_all(client_socket, iov.data(),
+                          static_cast<int>(iov.size()))) {
+                std::cerr << "Failed to send file: " << strerror(errno)
+                          << std::endl;
+                return false;
             }
+            return true;
         }
     }
 
     return false;
 }
 
+bool HttpServer::send_all(const int client_socket, iovec *iov, int count) {
+    while (count > 0) {
+        const ssize_t sent =
+            ::writev(client_socket, iov, std::min(count, IOV_MAX));
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+            pollfd pfd{client_socket, POLLOUT, 0};
+            if (poll(&pfd, 1, 5000) <= 0) return false;
+            continue;
+        }
+        auto remaining = static_cast<size_t>(sent);
+        while (count > 0 && remaining >= iov->iov_len) {
+            remaining -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + remaining;
+            iov->iov_len -= remaining;
+        }
+    }
+    return true;
+}
+
 void HttpServer::send_response(
     const int client_socket, const int status_code,
     const std::string &status_message,
@@ -383,6 +644,10 @@ std::string HttpServer::get_status_message(const int status_code) {
             return "Forbidden";
         case 404:
             return "Not Found";
+        case 405:
+            return "Method Not Allowed";
+        case 413:
+            return "Content Too Large";
         case 500:
             return "Internal Server Error";
         case 501:
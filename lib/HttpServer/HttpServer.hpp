@@ -7,13 +7,18 @@
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <atomic>
+#include <deque>
 #include <functional>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
+#include "ResourcePack.hpp"
 #include "vfs.hpp"
 
 class HttpServer {
@@ -22,6 +27,10 @@ public:
     ~HttpServer();
 
     void mount_vfs(const std::string &prefix, const VirtualFileSystem *vfs);
+    // compiled-in assets under prefix; they are looked up before the VFS
+    // mounted on the same paths
+    void mount_resource_pack(const std::string &prefix,
+                             const ResourcePack *pack);
 
     void register_route(
         const std::string &path,
@@ -31,6 +40,33 @@ public:
                  const std::string &, std::string &,
                  std::unordered_map<std::string, std::string> &)> &handler);
 
+    // a response whose body is sent as is, without being copied
+    struct RawResponse {
+        int status = 200;
+        std::unordered_map<std::string, std::string> headers;
+        Buffer body;
+    };
+    using PrefixHandler = std::function<void(
+        const std::string &method, std::string_view rest,
+        const std::unordered_map<std::string, std::string> &headers,
+        std::string &body, RawResponse &response)>;
+    // handles every request whose path starts with prefix, after the exact
+    // routes; rest is the path past the prefix, without the query. The
+    // handler may move the request body out. Its requests may carry bodies
+    // up to max_body_size, 0 leaving them to the server's limit.
+    void register_prefix_route(const std::string &prefix,
+                               PrefixHandler handler,
+                               size_t max_body_size = 0);
+
+    // requests announcing a larger body are answered 413 without reading
+    // it; may be changed while the server runs
+    void set_max_body_size(size_t bytes) {
+        max_body_size = bytes;
+    }
+    // the same for the requests of one prefix route, 0 leaving them to the
+    // server's limit
+    void set_max_body_size(const std::string &prefix, size_t bytes);
+
     bool start();
     void stop();
     bool is_running() const;
@@ -56,7 +92,15 @@ private:
     std::thread accept_thread;
     std::vector<std::thread> worker_threads;
     static constexpr int NUM_WORKER_THREADS = 4;
+    static constexpr size_t READ_BUFFER_SIZE = 64 * 1024;
+    // a body announcing more than this grows as it arrives instead of being
+    // allocated upfront
+    static constexpr size_t MAX_BODY_RESERVE = 64 * 1024 * 1024;
+    // largest body accepted unless set_max_body_size() says otherwise
+    static constexpr size_t DEFAULT_MAX_BODY_SIZE = 256 * 1024 * 1024;
+    std::atomic<size_t> max_body_size{DEFAULT_MAX_BODY_SIZE};
     std::unordered_map<std::string, const VirtualFileSystem *> mounted_vfs;
+    std::unordered_map<std::string, const ResourcePack *> mounted_packs;
     std::unordered_map<
         std::string,
         std::function<void(const std::string &,
@@ -64,15 +108,34 @@ private:
                            const std::string &, std::string &,
                            std::unordered_map<std::string, std::string> &)>>
         route_handlers;
+    struct PrefixRoute {
+        PrefixRoute(std::string prefix, PrefixHandler handler,
+                    const size_t max_body_size)
+            : prefix(std::move(prefix)),
+              handler(std::move(handler)),
+              max_body_size(max_body_size) {
+        }
+        std::string prefix;
+        PrefixHandler handler;
+        std::atomic<size_t> max_body_size;
+    };
+    // a deque, as the routes' limits cannot move
+    std::deque<PrefixRoute> prefix_routes;
     void accept_connections();
     void handle_client(ClientConnection client);
-    static bool parse_request(int client_socket, HttpRequest &request);
-    void process_request(int client_socket, const HttpRequest &request);
+    bool parse_request(int client_socket, HttpRequest &request) const;
+    // largest body accepted for a request to path
+    size_t max_body_size_for(std::string_view path) const;
+    void process_request(int client_socket, HttpRequest &request);
+    bool serve_prefix_route(int client_socket, HttpRequest &request);
     static void send_response(
         int client_socket, int status_code, const std::string &status_message,
         const std::unordered_map<std::string, std::string> &headers,
         const std::string &body);
-    bool serve_file_from_vfs(int client_socket, const std::string &path);
+    bool serve_file_from_pack(int client_socket, const HttpRequest &request);
+    bool serve_file_from_vfs(int client_socket, const HttpRequest &request);
+    // writes every byte of iov, waiting while the socket is full
+    static bool send_all(int client_socket, iovec *iov, int count);
     static std::string get_status_message(int status_code);
     static bool set_nonblocking(int socket);
 };
@@ -6,33 +6,17 @@
 #include <memory>
 #include <sstream>
 #include <fstream>
+#include <algorithm>
 
-// Helper class for creating a mock VirtualFileSystem
+// Helper class for filling a VirtualFileSystem from strings
 class MockVFS : public VirtualFileSystem {
 public:
     MockVFS() = default;
 
     void add_file(const std::string& path, const std::string& content, const std::string& mime_type) {
-        VirtualFileSystem::FileEntry entry;
-        entry.data = std::vector<uint8_t>(content.begin(), content.end());
-        entry.mime_type = mime_type;
-        files[path] = entry;
+        VirtualFileSystem::add_file(path, reinterpret_cast<const unsigned char*>(content.data()),
+                                    content.size());
     }
-
-    bool exists(const std::string& path) const override {
-        return files.find(path) != files.end();
-    }
-
-    const FileEntry* get_file(const std::string& path) const override {
-        auto it = files.find(path);
-        if (it != files.end()) {
-            return &it->second;
-        }
-        return nullptr;
-    }
-
-private:
-    std::unordered_map<std::string, FileEntry> files;
 };
 
 // Callback for CURL to write received data
@@ -341,6 +325,115 @@ TEST_F(HttpServerTest, ServerHandlesMultipleRequests) {
     server.stop();
 }
 
+// Prefix routes see the rest of the path, take large bodies whole and set the status
+TEST_F(HttpServerTest, ServerHandlesPrefixRoutes) {
+    HttpServer server(8088);
+    std::string received;
+    server.register_prefix_route("/raw/", [&received](
+        const std::string& method,
+        std::string_view rest,
+        const std::unordered_map<std::string, std::string>& headers,
+        std::string& body,
+        HttpServer::RawResponse& response) {
+            if (method == "PUT") {
+                received = std::move(body);
+                response.status = 204;
+                return;
+            }
+            if (rest != "known") {
+                response.status = 404;
+                return;
+            }
+            const std::string text = "raw bytes";
+            response.body = Buffer(std::vector<unsigned char>(text.begin(), text.end()));
+            response.headers["Content-Type"] = "application/octet-stream";
+    });
+
+    ASSERT_TRUE(server.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    auto [status, body] = make_request("http://localhost:8088/raw/known?x=1");
+    EXPECT_EQ(status, 200);
+    EXPECT_EQ(body, "raw bytes");
+    EXPECT_EQ(make_request("http://localhost:8088/raw/other").first, 404);
+
+    // much larger than one read from the socket
+    const std::string upload(3 * 1024 * 1024 + 17, 'u');
+    EXPECT_EQ(make_request("http://localhost:8088/raw/upload", "PUT", upload).first, 204);
+    EXPECT_EQ(received, upload);
+
+    server.stop();
+}
+
+namespace {
+constexpr size_t kBigAsset = 16 * 1024 * 1024 + 3;
+unsigned char kPackBlob[kBigAsset + 5];
+constexpr ResourcePackIndex<2> kPackIndex{
+    {{
+        {"big.bin", 0, kBigAsset, "application/octet-stream", "\"big\""},
+        {"small.txt", kBigAsset, 5, "text/plain", "\"small\""},
+    }},
+    {{6, 0}},
+};
+static_assert(kPackIndex.find("small.txt")->offset == kBigAsset);
+}  // namespace
+
+// Compiled-in assets are sent whole, however many writes the socket needs
+TEST_F(HttpServerTest, ServerServesLargePackAssets) {
+    for (size_t i = 0; i < sizeof(kPackBlob); i++) kPackBlob[i] = static_cast<unsigned char>(i * 7);
+    const ResourcePack pack(kPackBlob, sizeof(kPackBlob), kPackIndex);
+    HttpServer server(8090);
+    server.mount_resource_pack("/", &pack);
+
+    ASSERT_TRUE(server.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    auto [status, body] = make_request("http://localhost:8090/big.bin");
+    EXPECT_EQ(status, 200);
+    ASSERT_EQ(body.size(), kBigAsset);
+    EXPECT_TRUE(std::equal(body.begin(), body.end(), reinterpret_cast<const char*>(kPackBlob)));
+    auto [small_status, small_body] = make_request("http://localhost:8090/small.txt");
+    EXPECT_EQ(small_status, 200);
+    EXPECT_EQ(small_body.size(), 5);
+
+    server.stop();
+}
+
+// A body over the limit is refused from its Content-Length, before it is read;
+// a prefix route may have a limit of its own
+TEST_F(HttpServerTest, ServerRejectsOversizedBodies) {
+    HttpServer server(8089);
+    size_t calls = 0;
+    const auto handler = [&calls](
+        const std::string&, std::string_view,
+        const std::unordered_map<std::string, std::string>&,
+        std::string&, HttpServer::RawResponse& response) {
+            calls++;
+            response.status = 204;
+    };
+    server.register_prefix_route("/raw/", handler);
+    server.register_prefix_route("/small/", handler, 1024);
+    server.set_max_body_size(64 * 1024);
+
+    ASSERT_TRUE(server.start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    EXPECT_EQ(make_request("http://localhost:8089/raw/x", "PUT", std::string(64 * 1024, 'u')).first, 204);
+    EXPECT_EQ(make_request("http://localhost:8089/raw/x", "PUT", std::string(64 * 1024 + 1, 'u')).first, 413);
+    EXPECT_EQ(make_request("http://localhost:8089/raw/x", "PUT", std::string(4 * 1024 * 1024, 'u')).first, 413);
+    EXPECT_EQ(calls, 1);
+
+    EXPECT_EQ(make_request("http://localhost:8089/small/x", "PUT", std::string(1024, 'u')).first, 204);
+    EXPECT_EQ(make_request("http://localhost:8089/small/x?q", "PUT", std::string(1025, 'u')).first, 413);
+    // raising the route's limit leaves the server's alone
+    server.set_max_body_size("/small/", 128 * 1024);
+    EXPECT_EQ(make_request("http://localhost:8089/small/x", "PUT", std::string(128 * 1024, 'u')).first, 204);
+    EXPECT_EQ(make_request("http://localhost:8089/raw/x", "PUT", std::string(64 * 1024 + 1, 'u')).first, 413);
+    EXPECT_EQ(calls, 3);
+
+    server.stop();
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
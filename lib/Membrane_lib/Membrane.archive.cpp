@@ -0,0 +1,694 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "Membrane.hpp"
+#include <miniz.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <span>
+
+// --------------------------------
+// Data Management and Compression
+// --------------------------------
+
+namespace {
+// each extracting thread inflates into one buffer of this size
+constexpr size_t UNZIP_CHUNK_SIZE = 64 * 1024;
+// deflate cannot expand data by much more than this, so a declared size
+// beyond it marks a corrupt entry, not one worth allocating for
+constexpr uint64_t MAX_DEFLATE_RATIO = 1032;
+
+// opens a reader over the archive; every thread needs its own
+using ZipOpener = std::function<bool(mz_zip_archive &)>;
+
+// shared by the threads extracting one archive
+struct UnzipRun {
+    const UnzipOptions &options;
+    uint64_t total_bytes = 0;
+    size_t file_count = 0;
+    std::atomic<uint64_t> bytes_done{0};
+    std::atomic<size_t> files_done{0};
+    // set when a limit is hit; no further entry or chunk is started
+    std::atomic<bool> stopped{false};
+    std::atomic<bool> ok{true};
+    std::mutex progress_mutex{};
+
+    // accounts for n more bytes of an entry that now has entry_bytes;
+    // false once a limit is passed
+    bool count(const uint64_t n, const uint64_t entry_bytes,
+               const std::string &path) {
+        const uint64_t extracted = bytes_done += n;
+        if (options.max_entry_bytes != 0 &&
+            entry_bytes > options.max_entry_bytes) {
+            stop("ZIP entry exceeds the size limit: " + path);
+            return false;
+        }
+        if (options.max_total_bytes != 0 &&
+            extracted > options.max_total_bytes) {
+            stop("ZIP archive exceeds the size limit");
+            return false;
+        }
+        report();
+        return true;
+    }
+    void report() {
+        if (!options.on_progress) return;
+        std::lock_guard lock(progress_mutex);
+        options.on_progress(
+            {bytes_done, total_bytes, files_done, file_count});
+    }
+    void stop(const std::string &reason) {
+        if (!stopped.exchange(true)) std::cerr << reason << std::endl;
+        ok = false;
+    }
+};
+
+// inflates the entry chunk by chunk, passing each one to emit(data, size).
+// Returns false if the entry is corrupt, a limit is hit or emit fails.
+template <typename Emit>
+bool stream_entry(mz_zip_archive &zip, const mz_zip_archive_file_stat &stat,
+                  const std::string &path, UnzipRun &run,
+                  std::vector<unsigned char> &chunk, Emit &&emit) {
+    mz_zip_reader_extract_iter_state *iter =
+        mz_zip_reader_extract_iter_new(&zip, stat.m_file_index, 0);
+    if (iter == nullptr) return false;
+    uint64_t entry_bytes = 0;
+    bool complete = true;
+    while (!run.stopped) {
+        const size_t n =
+            mz_zip_reader_extract_iter_read(iter, chunk.data(), chunk.size());
+        if (n == 0) break;
+        entry_bytes += n;
+        if (!run.count(n, entry_bytes, path) || !emit(chunk.data(), n)) {
+            complete = false;
+            break;
+        }
+    }
+    // also checks the size and CRC-32 of what was read
+    const bool intact = mz_zip_reader_extract_iter_free(iter);
+    return complete && !run.stopped && intact;
+}
+
+// inflates the entry straight into contents, sized from the central
+// directory, a chunk's worth at a time so that limits and stops are still
+// checked between reads. Returns false if the entry is corrupt, holds more
+// or less than it declared, or a limit is hit.
+bool extract_entry(mz_zip_archive &zip, const mz_zip_archive_file_stat &stat,
+                   const std::string &path, UnzipRun &run,
+                   std::vector<unsigned char> &chunk,
+                   std::span<unsigned char> contents) {
+    mz_zip_reader_extract_iter_state *iter =
+        mz_zip_reader_extract_iter_new(&zip, stat.m_file_index, 0);
+    if (iter == nullptr) return false;
+    size_t filled = 0;
+    bool complete = true;
+    while (!run.stopped && filled < contents.size()) {
+        const size_t n = mz_zip_reader_extract_iter_read(
+            iter, contents.data() + filled,
+            std::min(chunk.size(), contents.size() - filled));
+        if (n == 0) break;
+        filled += n;
+        if (!run.count(n, filled, path)) {
+            complete = false;
+            break;
+        }
+    }
+    // anything past the declared size makes the entry corrupt
+    if (complete && filled == contents.size() &&
+        mz_zip_reader_extract_iter_read(iter, chunk.data(), chunk.size()) !=
+            0) {
+        complete = false;
+    }
+    // also checks the size and CRC-32 of what was read
+    const bool intact = mz_zip_reader_extract_iter_free(iter);
+    return complete && filled == contents.size() && !run.stopped && intact;
+}
+
+// calls body(zip, stat, path, chunk) for every file of the archive on
+// workers, each with its own reader and chunk buffer. path is the entry
+// name, without its first component with strip_root; body returns false
+// on failure.
+template <typename Body>
+bool for_each_zip_entry(ThreadPool &workers, const std::string &zip_path,
+                        const ZipOpener &open, const bool strip_root,
+                        UnzipRun &run, Body &&body) {
+    // the totals come from the central directory, so a limit the archive
+    // admits to exceeding fails before anything is inflated
+    {
+        mz_zip_archive zip;
+        memset(&zip, 0, sizeof(zip));
+        if (!open(zip)) {
+            std::cerr << "Failed to open ZIP archive: " << zip_path
+                      << std::endl;
+            return false;
+        }
+        const mz_uint file_count = mz_zip_reader_get_num_files(&zip);
+        for (mz_uint i = 0; i < file_count; ++i) {
+            mz_zip_archive_file_stat stat;
+            if (!mz_zip_reader_file_stat(&zip, i, &stat) ||
+                stat.m_is_directory) {
+                continue;
+            }
+            run.total_bytes += stat.m_uncomp_size;
+            run.file_count++;
+            if (run.options.max_entry_bytes != 0 &&
+                stat.m_uncomp_size > run.options.max_entry_bytes) {
+                run.stop(std::string("ZIP entry exceeds the size limit: ") +
+                         stat.m_filename);
+            }
+        }
+        mz_zip_reader_end(&zip);
+        if (run.options.max_total_bytes != 0 &&
+            run.total_bytes > run.options.max_total_bytes) {
+            run.stop("ZIP archive exceeds the size limit: " + zip_path);
+        }
+        if (run.stopped) return false;
+    }
+
+    // a reader's state is not shared, so each worker opens its own over the
+    // same bytes and claims entries until none are left
+    std::atomic<mz_uint> next{0};
+    workers.parallel_for(workers.size(), [&](size_t) {
+        mz_zip_archive zip;
+        memset(&zip, 0, sizeof(zip));
+        if (!open(zip)) {
+            run.stop("Failed to open ZIP archive: " + zip_path);
+            return;
+        }
+        std::vector<unsigned char> chunk(UNZIP_CHUNK_SIZE);
+        const mz_uint file_count = mz_zip_reader_get_num_files(&zip);
+        for (mz_uint i = next++; i < file_count && !run.stopped; i = next++) {
+            mz_zip_archive_file_stat stat;
+            if (!mz_zip_reader_file_stat(&zip, i, &stat)) {
+                std::cerr << "Failed to get file stat for entry " << i
+                          << std::endl;
+                run.ok = false;
+                continue;
+            }
+            if (stat.m_is_directory) continue;
+            std::string path = stat.m_filename;
+            if (strip_root) path = path.substr(path.find_first_of('/') + 1);
+            if (!body(zip, stat, path, chunk)) {
+                if (!run.stopped) {
+                    std::cerr << "Failed to extract file: " << stat.m_filename
+                              << std::endl;
+                }
+                run.ok = false;
+                continue;
+            }
+            run.files_done++;
+            run.report();
+        }
+        mz_zip_reader_end(&zip);
+    });
+    return run.ok;
+}
+// extracts the archive into vfs, each entry at prefix followed by its path
+bool unzip_into_vfs(ThreadPool &workers, const std::string &zip_path,
+                    const ZipOpener &open, VirtualFileSystem &vfs,
+                    const std::string &prefix, const bool strip_root,
+                    const UnzipOptions &options) {
+    UnzipRun run{options};
+    return for_each_zip_entry(
+        workers, zip_path, open, strip_root, run,
+        [&vfs, &prefix, &run](mz_zip_archive &zip,
+                              const mz_zip_archive_file_stat &stat,
+                              const std::string &path,
+                              std::vector<unsigned char> &chunk) {
+            // the limits were checked against the declared size before
+            // anything was inflated; what is left is a size no deflate
+            // stream of that length could produce
+            if (stat.m_uncomp_size >
+                std::max<uint64_t>(stat.m_comp_size, 1) * MAX_DEFLATE_RATIO) {
+                std::cerr << "Corrupt ZIP entry size: " << stat.m_filename
+                          << std::endl;
+                return false;
+            }
+            std::vector<unsigned char> contents(stat.m_uncomp_size);
+            if (!extract_entry(zip, stat, path, run, chunk, contents)) {
+                return false;
+            }
+            vfs.add_file(prefix + path, Buffer(std::move(contents)));
+            return true;
+        });
+}
+
+// extracts the archive below the directory destination
+bool unzip_into_directory(ThreadPool &workers, const std::string &zip_path,
+                          const ZipOpener &open,
+                          const std::filesystem::path &destination,
+                          const bool strip_root, const UnzipOptions &options) {
+    std::error_code error;
+    std::filesystem::create_directories(destination, error);
+    const std::filesystem::path root =
+        std::filesystem::weakly_canonical(destination, error);
+    if (error) {
+        std::cerr << "Failed to create directory: " << destination
+                  << std::endl;
+        return false;
+    }
+    UnzipRun run{options};
+    return for_each_zip_entry(
+        workers, zip_path, open, strip_root, run,
+        [&root, &run](mz_zip_archive &zip,
+                      const mz_zip_archive_file_stat &stat,
+                      const std::string &path,
+                      std::vector<unsigned char> &chunk) {
+            // a name like "../x" or "/x" must not write outside root
+            const std::filesystem::path target =
+                (root / path).lexically_normal();
+            const auto [end, _] = std::mismatch(root.begin(), root.end(),
+                                                target.begin(), target.end());
+            if (path.empty() || end != root.end()) {
+                std::cerr << "Skipping ZIP entry outside the destination: "
+                          << stat.m_filename << std::endl;
+                return true;
+            }
+            std::error_code ignored;
+            std::filesystem::create_directories(target.parent_path(),
+                                                ignored);
+            std::ofstream out(target, std::ios::binary | std::ios::trunc);
+            const bool written =
+                out && stream_entry(zip, stat, path, run, chunk,
+                                    [&out](const unsigned char *data,
+                                           const size_t size) {
+                                        out.write(reinterpret_cast<
+                                                      const char *>(data),
+                                                  size);
+                                        return static_cast<bool>(out);
+                                    });
+            out.close();
+            if (!written || !out) {
+                std::filesystem::remove(target, ignored);
+                return false;
+            }
+            return true;
+        });
+}
+
+// an ArchiveLocation with its VFS looked up; vfs is null on disk
+struct Endpoint {
+    VirtualFileSystem *vfs = nullptr;
+    std::string path;
+};
+
+Endpoint endpoint_of(Membrane &app, const ArchiveLocation &location) {
+    return {location.vfs.empty() ? nullptr : &app.getCustomVFS(location.vfs),
+            location.path};
+}
+
+// a VFS path naming a directory of entries: empty, or ending with '/'
+std::string directory_prefix(std::string path) {
+    if (!path.empty() && !path.ends_with('/')) path += '/';
+    return path;
+}
+
+// a file going into an archive, read from disk or from a VFS entry
+struct ArchiveItem {
+    std::string name;
+    std::filesystem::path file;
+    VirtualFileSystem::FileHandle entry;
+    uint64_t size = 0;
+};
+
+// an item ready to be written; deflated is empty if it is stored
+struct PackedItem {
+    Buffer contents;
+    Buffer deflated;
+    uint32_t crc32 = 0;
+    bool ok = false;
+};
+
+std::vector<ArchiveItem> archive_items(const Endpoint &source) {
+    std::vector<ArchiveItem> items;
+    if (source.vfs) {
+        const std::string prefix = directory_prefix(source.path);
+        for (auto &listed : source.vfs->list(prefix).entries) {
+            const uint64_t size = listed.entry->size();
+            items.push_back({listed.path.substr(prefix.size()), {},
+                             std::move(listed.entry), size});
+        }
+        return items;
+    }
+    for (const auto &file :
+         std::filesystem::recursive_directory_iterator(source.path)) {
+        if (!file.is_regular_file()) continue;
+        items.push_back(
+            {file.path().lexically_relative(source.path).generic_string(),
+             file.path(), nullptr, file.file_size()});
+    }
+    return items;
+}
+
+PackedItem pack_item(const ArchiveItem &item, const int level) {
+    PackedItem packed;
+    try {
+        packed.contents = item.entry
+                              ? VirtualFileSystem::contiguous(item.entry)->data
+                              : Buffer(readBinaryFile(item.file.string()));
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return packed;
+    }
+    const Buffer &contents = packed.contents;
+    packed.crc32 = static_cast<uint32_t>(
+        mz_crc32(MZ_CRC32_INIT, contents.data(), contents.size()));
+    packed.ok = true;
+    if (level == 0 || contents.empty()) return packed;
+    size_t deflated_size = 0;
+    void *deflated = tdefl_compress_mem_to_heap(
+        contents.data(), contents.size(), &deflated_size,
+        tdefl_create_comp_flags_from_zip_params(
+            level, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY));
+    if (deflated == nullptr) return packed;
+    // entries deflate does not shrink are stored
+    if (deflated_size >= contents.size()) {
+        mz_free(deflated);
+        return packed;
+    }
+    packed.deflated =
+        Buffer(static_cast<const unsigned char *>(deflated), deflated_size,
+               std::shared_ptr<const void>(deflated, mz_free));
+    return packed;
+}
+
+bool create_archive(ThreadPool &workers, const Endpoint &source,
+                    const Endpoint &destination,
+                    const ArchiveOptions &options) {
+    std::vector<ArchiveItem> items;
+    try {
+        items = archive_items(source);
+    } catch (const std::filesystem::filesystem_error &e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    const int level = std::clamp(options.level, 0, 10);
+    ArchiveProgress progress;
+    progress.file_count = items.size();
+    for (const ArchiveItem &item : items) progress.total_bytes += item.size;
+
+    mz_zip_archive zip;
+    memset(&zip, 0, sizeof(zip));
+    // a file destination is written entry by entry
+    if (destination.vfs ? !mz_zip_writer_init_heap(&zip, 0, 0)
+                        : !mz_zip_writer_init_file(
+                              &zip, destination.path.c_str(), 0)) {
+        std::cerr << "Failed to create ZIP archive: " << destination.path
+                  << std::endl;
+        return false;
+    }
+    // a batch is deflated in parallel, then written in order while only
+    // the batch is held in memory
+    const size_t batch_size = workers.size() * 2;
+    std::vector<PackedItem> batch(batch_size);
+    bool ok = true;
+    for (size_t first = 0; ok && first < items.size(); first += batch_size) {
+        const size_t count = std::min(batch_size, items.size() - first);
+        workers.parallel_for(count, [&](const size_t i) {
+            batch[i] = pack_item(items[first + i], level);
+        });
+        for (size_t i = 0; ok && i < count; ++i) {
+            const ArchiveItem &item = items[first + i];
+            PackedItem &packed = batch[i];
+            if (!packed.ok) {
+                ok = false;
+                break;
+            }
+            const Buffer &contents = packed.contents;
+            ok = packed.deflated.empty()
+                     ? mz_zip_writer_add_mem(&zip, item.name.c_str(),
+                                             contents.data(), contents.size(),
+                                             MZ_NO_COMPRESSION)
+                     : mz_zip_writer_add_mem_ex(
+                           &zip, item.name.c_str(), packed.deflated.data(),
+                           packed.deflated.size(), nullptr, 0,
+                           level | MZ_ZIP_FLAG_COMPRESSED_DATA,
+                           contents.size(), packed.crc32);
+            if (!ok) {
+                std::cerr << "Failed to add to ZIP archive: " << item.name
+                          << std::endl;
+            }
+            packed = {};
+            progress.bytes_done += item.size;
+            progress.files_done++;
+            if (ok && options.on_progress) options.on_progress(progress);
+        }
+    }
+
+    if (destination.vfs) {
+        void *archive = nullptr;
+        size_t archive_size = 0;
+        ok = ok &&
+             mz_zip_writer_finalize_heap_archive(&zip, &archive, &archive_size);
+        if (ok) {
+            // the VFS entry adopts the heap archive
+            destination.vfs->add_file(
+                destination.path,
+                Buffer(static_cast<const unsigned char *>(archive),
+                       archive_size,
+                       std::shared_ptr<const void>(archive, mz_free)));
+        }
+    } else {
+        ok = ok && mz_zip_writer_finalize_archive(&zip);
+    }
+    mz_zip_writer_end(&zip);
+    if (!ok && !destination.vfs) {
+        std::error_code ignored;
+        std::filesystem::remove(destination.path, ignored);
+    }
+    return ok;
+}
+
+bool extract_archive(ThreadPool &workers, const Endpoint &source,
+                     const Endpoint &destination,
+                     const UnzipOptions &options) {
+    // a VFS archive is read from one contiguous copy of its entry
+    VirtualFileSystem::FileHandle archive;
+    ZipOpener open;
+    if (source.vfs) {
+        archive = source.vfs->get_file(source.path);
+        if (!archive) {
+            std::cerr << "ZIP archive not found: " << source.path
+                      << std::endl;
+            return false;
+        }
+        open = [&archive](mz_zip_archive &zip) {
+            return mz_zip_reader_init_mem(&zip, archive->data.data(),
+                                          archive->data.size(), 0);
+        };
+    } else {
+        open = [&source](mz_zip_archive &zip) {
+            return mz_zip_reader_init_file(&zip, source.path.c_str(), 0);
+        };
+    }
+    if (destination.vfs) {
+        return unzip_into_vfs(workers, source.path, open, *destination.vfs,
+                              directory_prefix(destination.path), false,
+                              options);
+    }
+    return unzip_into_directory(workers, source.path, open, destination.path,
+                                false, options);
+}
+}  // namespace
+
+bool Membrane::UnzipData(const std::string &zip_path,
+                         const VirtualFileSystem::FileEntry &file_entry,
+                         const UnzipOptions &options) {
+    const Buffer &archive = file_entry.data;
+    return unzip_into_vfs(
+        _workers, zip_path,
+        [&archive](mz_zip_archive &zip) {
+            return mz_zip_reader_init_mem(&zip, archive.data(),
+                                          archive.size(), 0);
+        },
+        _vfs, "", true, options);
+}
+
+bool Membrane::UnzipToDirectory(const std::string &zip_path,
+                                const std::filesystem::path &destination,
+                                const UnzipOptions &options) {
+    return unzip_into_directory(
+        _workers, zip_path,
+        [&zip_path](mz_zip_archive &zip) {
+            return mz_zip_reader_init_file(&zip, zip_path.c_str(), 0);
+        },
+        destination, true, options);
+}
+
+bool Membrane::CreateArchive(const ArchiveLocation &source,
+                             const ArchiveLocation &destination,
+                             const ArchiveOptions &options) {
+    return create_archive(_workers, endpoint_of(*this, source),
+                          endpoint_of(*this, destination), options);
+}
+
+bool Membrane::ExtractArchive(const ArchiveLocation &source,
+                              const ArchiveLocation &destination,
+                              const UnzipOptions &options) {
+    return extract_archive(_workers, endpoint_of(*this, source),
+                           endpoint_of(*this, destination), options);
+}
+
+void Membrane::checkAndUnzip(const bool in_place,
+                             const UnzipOptions &options) {
+    // unzipping adds entries, so the archives are collected first
+    std::vector<std::pair<std::string, VirtualFileSystem::FileHandle>> zips;
+    _vfs.for_each_file([&zips](const std::string &path,
+                               const VirtualFileSystem::FileHandle &entry) {
+        if (entry->mime_type == "application/zip") {
+            zips.emplace_back(path, entry);
+        }
+    });
+    for (const auto &[path, entry] : zips) {
+        // the entries share the archive's buffer, so it is held once
+        if (in_place) {
+            _vfs.add_zip(entry->data, true);
+        } else {
+            UnzipData(path, *entry, options);
+        }
+    }
+    for (const ResourcePack *pack : _resource_packs) {
+        for (const ResourceRecord &record : pack->records()) {
+            if (record.mime_type != "application/zip") continue;
+            const std::span<const unsigned char> contents =
+                pack->contents(record);
+            const Buffer archive =
+                Buffer::borrow(contents.data(), contents.size());
+            if (in_place) {
+                _vfs.add_zip(archive, true);
+            } else {
+                UnzipData(std::string(record.path),
+                          {archive, std::string(record.mime_type)}, options);
+            }
+        }
+    }
+}
+
+// --------------------------------
+// Archive JavaScript Bridge
+// --------------------------------
+
+namespace {
+// progress events are sent at most this often, so a job with many small
+// entries does not flood the UI thread
+constexpr auto ARCHIVE_PROGRESS_INTERVAL = std::chrono::milliseconds(100);
+
+// a location from JavaScript: a path on disk, or {vfs, path}
+ArchiveLocation location_from_json(const json &value) {
+    if (value.is_string()) return {"", value.get<std::string>()};
+    if (value.is_object() && value.contains("vfs") &&
+        value["vfs"].is_string()) {
+        return {value["vfs"].get<std::string>(),
+                value.value("path", std::string())};
+    }
+    throw std::invalid_argument(
+        "Invalid location. Expected a path or {vfs, path}");
+}
+
+json progress_json(const uint64_t job, const ArchiveProgress &progress) {
+    return {{"job", job},
+            {"type", "progress"},
+            {"bytesDone", progress.bytes_done},
+            {"totalBytes", progress.total_bytes},
+            {"filesDone", progress.files_done},
+            {"fileCount", progress.file_count}};
+}
+}  // namespace
+
+uint64_t Membrane::startArchiveJob(ArchiveJob job) {
+    const uint64_t id = ++_archive_jobs;
+    const auto emit = [this](const json &detail) {
+        const std::string js =
+            "window.dispatchEvent(new CustomEvent('membrane-archive', "
+            "{ detail: " +
+            detail.dump() + " }));";
+        _window.dispatch([this, js] { _window.eval(js); });
+    };
+    (void)_workers.submit([id, emit, job = std::move(job)] {
+        // the job reports one call at a time, so last needs no lock
+        std::chrono::steady_clock::time_point last;
+        const auto on_progress = [id, &emit,
+                                  &last](const ArchiveProgress &progress) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now - last < ARCHIVE_PROGRESS_INTERVAL) return;
+            last = now;
+            emit(progress_json(id, progress));
+        };
+        json result = {{"job", id}, {"type", "done"}};
+        try {
+            if (!job(on_progress)) {
+                result["type"] = "error";
+                result["message"] = "Archive operation failed";
+            }
+        } catch (const std::exception &e) {
+            result["type"] = "error";
+            result["message"] = e.what();
+        }
+        emit(result);
+    });
+    return id;
+}
+
+void Membrane::registerArchiveFunctions() {
+    registerFunction("membrane_archive_create", [this](const json &args) {
+        if (args.size() != 3 || !args[2].is_object()) {
+            return retObj("error",
+                          "Invalid arguments. Expected 3 arguments: "
+                          "source, destination, options");
+        }
+
+        try {
+            // unknown VFS names fail here rather than in the job
+            const Endpoint from =
+                endpoint_of(*this, location_from_json(args[0]));
+            const Endpoint to =
+                endpoint_of(*this, location_from_json(args[1]));
+            const int level = args[2].value("level", ArchiveOptions{}.level);
+            const uint64_t job = startArchiveJob(
+                [this, from, to, level](const auto &on_progress) {
+                    return create_archive(_workers, from, to,
+                                          {level, on_progress});
+                });
+            return json({{"status", "success"},
+                         {"message", "Started creating archive"},
+                         {"data", {{"job", job}}}});
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+
+    registerFunction("membrane_archive_extract", [this](const json &args) {
+        if (args.size() != 3 || !args[2].is_object()) {
+            return retObj("error",
+                          "Invalid arguments. Expected 3 arguments: "
+                          "source, destination, options");
+        }
+
+        try {
+            const Endpoint from =
+                endpoint_of(*this, location_from_json(args[0]));
+            const Endpoint to =
+                endpoint_of(*this, location_from_json(args[1]));
+            const auto max_total =
+                args[2].value("maxTotalBytes", uint64_t{0});
+            const auto max_entry =
+                args[2].value("maxEntryBytes", uint64_t{0});
+            const uint64_t job = startArchiveJob(
+                [this, from, to, max_total,
+                 max_entry](const auto &on_progress) {
+                    return extract_archive(
+                        _workers, from, to,
+                        {max_total, max_entry, on_progress});
+                });
+            return json({{"status", "success"},
+                         {"message", "Started extracting archive"},
+                         {"data", {{"job", job}}}});
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+}
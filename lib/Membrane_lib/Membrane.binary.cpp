@@ -0,0 +1,221 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "Membrane.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+// --------------------------------
+// Binary Channel
+// --------------------------------
+
+namespace {
+// handles are short and URL-safe, so one is a single path segment
+bool valid_handle(const std::string_view handle) {
+    return !handle.empty() && handle.size() <= 64 &&
+           std::ranges::all_of(handle, [](const char c) {
+               return std::isalnum(static_cast<unsigned char>(c)) ||
+                      c == '-' || c == '_';
+           });
+}
+
+#ifdef DEV_MODE
+// scheme, host and port of url
+std::string origin_of(const std::string_view url) {
+    const size_t host = url.find("://");
+    if (host == std::string_view::npos) return std::string(url);
+    return std::string(url.substr(0, url.find('/', host + 3)));
+}
+#endif
+}  // namespace
+
+void Membrane::mountBinaryChannel() {
+    _binary_origins = {"http://localhost:" + std::to_string(_port)};
+#ifdef DEV_MODE
+    // in dev mode the page comes from the dev server
+    _binary_origins.push_back(origin_of(VITE_DEV_SERVER_URL));
+#endif
+    _server.register_prefix_route(
+        std::string(BINARY_CHANNEL_PREFIX),
+        [this](const std::string &method, const std::string_view handle,
+               const std::unordered_map<std::string, std::string> &headers,
+               std::string &body, HttpServer::RawResponse &response) {
+            response.headers = {{"Cache-Control", "no-store"}};
+            // pages from other origins may neither read nor fill slots;
+            // requests without an Origin come from the app's own page or
+            // from outside a browser
+            if (const auto origin = headers.find("origin");
+                origin != headers.end()) {
+                if (std::ranges::find(_binary_origins, origin->second) ==
+                    _binary_origins.end()) {
+                    response.status = 403;
+                    return;
+                }
+                response.headers["Access-Control-Allow-Origin"] =
+                    origin->second;
+                response.headers["Vary"] = "Origin";
+            }
+            if (method == "OPTIONS") {
+                response.status = 204;
+                response.headers["Access-Control-Allow-Methods"] = "GET, PUT";
+                response.headers["Access-Control-Allow-Headers"] =
+                    "Content-Type";
+                return;
+            }
+            if (!valid_handle(handle)) {
+                response.status = 404;
+                return;
+            }
+
+            const auto now = std::chrono::steady_clock::now();
+            if (method == "GET") {
+                std::lock_guard lock(_binary_mutex);
+                const auto slot = _binary_slots.find(std::string(handle));
+                if (slot == _binary_slots.end() || slot->second.uploaded ||
+                    slot->second.expires < now) {
+                    response.status = 404;
+                    return;
+                }
+                // sent once, straight from the published bytes
+                _binary_held -= slot->second.data.size();
+                response.body = std::move(slot->second.data);
+                _binary_slots.erase(slot);
+                response.headers["Content-Type"] = "application/octet-stream";
+            } else if (method == "PUT") {
+                std::lock_guard lock(_binary_mutex);
+                // the server already refused bodies over the route's limit
+                if (body.size() > _binary_upload_limit) {
+                    response.status = 413;
+                    return;
+                }
+                dropExpiredBinary(now);
+                if (_binary_held + body.size() > _binary_capacity) {
+                    response.status = 503;
+                    return;
+                }
+                if (_binary_slots.contains(std::string(handle))) {
+                    response.status = 403;
+                    return;
+                }
+                // the request body becomes the bytes without a copy
+                const auto owner =
+                    std::make_shared<const std::string>(std::move(body));
+                Buffer data(
+                    reinterpret_cast<const unsigned char *>(owner->data()),
+                    owner->size(), owner);
+                _binary_held += data.size();
+                _binary_slots.try_emplace(std::string(handle),
+                                          BinarySlot{std::move(data), true,
+                                                     now + BINARY_CHANNEL_TTL});
+                response.status = 204;
+            } else {
+                response.status = 405;
+                response.headers["Allow"] = "GET, PUT, OPTIONS";
+            }
+        },
+        _binary_upload_limit);
+}
+
+void Membrane::setBinaryChannelLimits(const size_t max_upload,
+                                      const size_t capacity) {
+    {
+        std::lock_guard lock(_binary_mutex);
+        _binary_upload_limit = max_upload;
+        _binary_capacity = capacity;
+    }
+    // only the channel's requests; the server's own limit stays
+    _server.set_max_body_size(std::string(BINARY_CHANNEL_PREFIX), max_upload);
+}
+
+void Membrane::dropExpiredBinary(
+    const std::chrono::steady_clock::time_point now) {
+    std::erase_if(_binary_slots, [this, now](const auto &slot) {
+        if (slot.second.expires >= now) return false;
+        _binary_held -= slot.second.data.size();
+        return true;
+    });
+}
+
+std::string Membrane::publishBinary(Buffer data) {
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock(_binary_mutex);
+    dropExpiredBinary(now);
+    std::string handle;
+    do {
+        // 128 bits, four draws of 32
+        char hex[33];
+        std::snprintf(hex, sizeof(hex), "%08x%08x%08x%08x", _binary_handles(),
+                      _binary_handles(), _binary_handles(), _binary_handles());
+        handle = hex;
+    } while (_binary_slots.contains(handle));
+    // bytes from C++ are always kept; they only count against uploads
+    _binary_held += data.size();
+    _binary_slots.try_emplace(
+        handle, BinarySlot{std::move(data), false, now + BINARY_CHANNEL_TTL});
+    return handle;
+}
+
+std::optional<Buffer> Membrane::takeBinary(const std::string &handle) {
+    std::lock_guard lock(_binary_mutex);
+    const auto slot = _binary_slots.find(handle);
+    if (slot == _binary_slots.end() || !slot->second.uploaded ||
+        slot->second.expires < std::chrono::steady_clock::now()) {
+        return std::nullopt;
+    }
+    _binary_held -= slot->second.data.size();
+    Buffer data = std::move(slot->second.data);
+    _binary_slots.erase(slot);
+    return data;
+}
+
+json Membrane::binaryRet(std::vector<uint8_t> data,
+                         const std::string &message) {
+    const size_t size = data.size();
+    return json({{"status", "success"},
+                 {"message", message},
+                 {"data",
+                  {{"binary", publishBinary(Buffer(std::move(data)))},
+                   {"size", size}}}});
+}
+
+void Membrane::setBinaryTools() {
+    // an absolute URL, as a dev server page has another origin
+    const std::string base = "http://localhost:" + std::to_string(_port) +
+                             std::string(BINARY_CHANNEL_PREFIX);
+    _window.eval("window.membrane = window.membrane || {};\n"
+                 "window.membrane.binary = (() => {\n"
+                 "    const base = " +
+                 json(base).dump() + ";\n" + R"script(
+    const newHandle = () => {
+        const bytes = new Uint8Array(16);
+        crypto.getRandomValues(bytes);
+        return Array.from(bytes, b => b.toString(16).padStart(2, '0')).join('');
+    };
+    // the bytes published under handle, as an ArrayBuffer
+    const get = async (handle) => {
+        const response = await fetch(base + handle);
+        if (!response.ok) throw new Error('Binary data not found: ' + handle);
+        return response.arrayBuffer();
+    };
+    // uploads an ArrayBuffer, typed array or Blob; returns its handle
+    const put = async (data) => {
+        const handle = newHandle();
+        const response = await fetch(base + handle, { method: 'PUT', body: data });
+        if (!response.ok) throw new Error('Failed to send binary data');
+        return handle;
+    };
+    // calls window[name], replacing binary data in its result by an
+    // ArrayBuffer
+    const call = async (name, ...args) => {
+        const result = await window[name](...args);
+        if (result && result.data && typeof result.data.binary === 'string') {
+            result.data = await get(result.data.binary);
+        }
+        return result;
+    };
+    return { get, put, call };
+})();
+)script");
+}
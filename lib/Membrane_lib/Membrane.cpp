@@ -3,9 +3,11 @@
 // Copyright (c) 2025 Maxime Le Besnerais
 
 #include "Membrane.hpp"
-#include <miniz.h>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <ranges>
+#include <stdexcept>
 #include "webview/webview.h"
 
 #ifdef DEV_MODE
@@ -23,6 +25,7 @@ Membrane::Membrane(const std::string &title, const std::string &entry,
                    const webview_hint_t hints, bool debug)
     : _window(debug, nullptr), _server(findAvailablePort()), _entry(entry) {
     _server.mount_vfs("/", &_vfs);
+    mountBinaryChannel();
     if (!_server.start()) {
         std::cerr << "Failed to start HTTP server" << std::endl;
         _running = false;
@@ -107,6 +110,17 @@ void Membrane::add_vfs(const std::string &path, const unsigned char *data,
     _vfs.add_file(path, data, len);
 }
 
+void Membrane::add_static_vfs(const std::string &path,
+                              const unsigned char *data,
+                              const unsigned int len) {
+    _vfs.add_static_file(path, data, len);
+}
+
+void Membrane::add_resource_pack(const ResourcePack &pack) {
+    _server.mount_resource_pack("/", &pack);
+    _resource_packs.push_back(&pack);
+}
+
 void Membrane::add_custom_vfs(const std::string &name) {
     if (_custom_vfs.contains(name)) {
         std::cerr << "Custom VFS with name " << name << " already exists"
@@ -115,12 +129,17 @@ void Membrane::add_custom_vfs(const std::string &name) {
         return;
     }
     auto vfs = std::make_unique<VirtualFileSystem>();
+    if (_content_store) {
+        vfs->use_content_store(_content_store);
+    }
     _server.mount_vfs("/" + name, vfs.get());
     _custom_vfs[name] = std::move(vfs);
 }
 
 void Membrane::add_persistent_vfs(const std::string &name,
-                                  const std::string &path) {
+                                  const std::string &path,
+                                  const std::chrono::milliseconds debounce,
+                                  const bool write_ahead_log) {
     if (_custom_vfs.contains(name)) {
         std::cerr << "Custom VFS with name " << name << " already exists"
                   << std::endl;
@@ -132,10 +151,62 @@ void Membrane::add_persistent_vfs(const std::string &name,
         std::cerr << "Failed to load files from disk" << std::endl;
         throw std::runtime_error("Failed to load files from disk");
     }
+    if (write_ahead_log && !vfs->enable_write_ahead_log()) {
+        throw std::runtime_error("Failed to open the write-ahead log");
+    }
+    if (_content_store) {
+        vfs->use_content_store(_content_store);
+    }
+    if (debounce.count() > 0) {
+        vfs->start_background_persistence(debounce);
+    }
+    _server.mount_vfs("/" + name, vfs.get());
+    _custom_vfs[name] = std::move(vfs);
+}
+
+void Membrane::clone_custom_vfs(const std::string &source,
+                                const std::string &name) {
+    if (_custom_vfs.contains(name)) {
+        std::cerr << "Custom VFS with name " << name << " already exists"
+                  << std::endl;
+        throw std::runtime_error("VFS already exists");
+    }
+    auto vfs = getCustomVFS(source).clone();
     _server.mount_vfs("/" + name, vfs.get());
     _custom_vfs[name] = std::move(vfs);
 }
 
+void Membrane::snapshot_custom_vfs(const std::string &vfs_name,
+                                   const std::string &snapshot_name) {
+    _vfs_snapshots.insert_or_assign({vfs_name, snapshot_name},
+                                    getCustomVFS(vfs_name).snapshot());
+}
+
+size_t Membrane::restore_custom_vfs(const std::string &vfs_name,
+                                    const std::string &snapshot_name) {
+    const auto found = _vfs_snapshots.find({vfs_name, snapshot_name});
+    if (found == _vfs_snapshots.end()) {
+        throw std::runtime_error("Snapshot not found: " + snapshot_name);
+    }
+    return getCustomVFS(vfs_name).restore(found->second);
+}
+
+bool Membrane::drop_vfs_snapshot(const std::string &vfs_name,
+                                 const std::string &snapshot_name) {
+    return _vfs_snapshots.erase({vfs_name, snapshot_name}) != 0;
+}
+
+void Membrane::enable_content_dedup() {
+    if (_content_store) {
+        return;
+    }
+    _content_store = std::make_shared<ContentStore>();
+    _vfs.use_content_store(_content_store);
+    for (const auto &vfs : _custom_vfs | std::views::values) {
+        vfs->use_content_store(_content_store);
+    }
+}
+
 void Membrane::add_to_custom_vfs(const std::string &vfs_name,
                                  const std::string &path,
                                  const unsigned char *data, unsigned int len) {
@@ -155,14 +226,22 @@ bool Membrane::save_vfs_to_disk(const std::string &vfs_name) {
                   << std::endl;
         return false;
     }
+    if (vfs->second->has_background_persistence()) {
+        vfs->second->request_save();
+        return true;
+    }
     return vfs->second->save_to_disk();
 }
 
-bool Membrane::save_all_vfs_to_disk() {
+bool Membrane::save_all_vfs_to_disk(const bool wait) {
     bool all_success = true;
     std::vector<std::string> failed_vfs;
     for (const auto &[name, vfs] : _custom_vfs) {
         if (!vfs->is_persistent()) continue;
+        if (!wait && vfs->has_background_persistence()) {
+            vfs->request_save();
+            continue;
+        }
         if (!vfs->save_to_disk()) {
             all_success = false;
             failed_vfs.push_back(name);
@@ -178,71 +257,53 @@ bool Membrane::save_all_vfs_to_disk() {
     return all_success;
 }
 
-// --------------------------------
-// Data Management and Compression
-// --------------------------------
-
-void Membrane::UnzipData(const std::string &zip_path,
-                         const VirtualFileSystem::FileEntry &file_entry) {
-    mz_zip_archive zip;
-    memset(&zip, 0, sizeof(zip));
-
-    if (!mz_zip_reader_init_mem(&zip, file_entry.data.data(),
-                                file_entry.data.size(), 0)) {
-        std::cerr << "Failed to open ZIP archive: " << zip_path << std::endl;
-        return;
-    }
-
-    int file_count = mz_zip_reader_get_num_files(&zip);
-
-    for (int i = 0; i < file_count; i++) {
-        mz_zip_archive_file_stat file_stat;
-        if (!mz_zip_reader_file_stat(&zip, i, &file_stat)) {
-            std::cerr << "Failed to get file stat for entry " << i << std::endl;
-            continue;
-        }
-
-        size_t file_size = file_stat.m_uncomp_size;
-        std::vector<unsigned char> extracted_data(file_size);
-
-        if (!mz_zip_reader_extract_to_mem(&zip, i, extracted_data.data(),
-                                          file_size, 0)) {
-            std::cerr << "Failed to extract file: " << file_stat.m_filename
-                      << std::endl;
-            continue;
-        }
-        std::string path = file_stat.m_filename;
-        path = path.substr(path.find_first_of('/') + 1);
-        _vfs.add_file(path, extracted_data.data(), extracted_data.size());
-    }
-
-    mz_zip_reader_end(&zip);
-}
-
-void Membrane::checkAndUnzip() {
-    auto file_list = _vfs.get_files();
-    for (const auto &[path, entry] : file_list) {
-        if (entry.mime_type == "application/zip") UnzipData(path, entry);
-    }
-}
-
 // --------------------------------
 // Function Registry and JavaScript Bridge
 // --------------------------------
 
-void Membrane::registerFunction(const std::string &name,
-                                const std::function<json(const json &)> &func) {
-    _functionRegistry.registerFunction(name, func);
+FunctionRegistry::FunctionId Membrane::registerFunction(
+    const std::string &name, const std::function<json(const json &)> &func) {
+    const auto id = _functionRegistry.registerFunction(name, func);
+    {
+        std::lock_guard lock(_async_mutex);
+        _async_limiters.erase(id);
+    }
 
-    _window.bind(name, [this, name](const std::string &args) {
+    // webview binds by name; the binding dispatches by id, so calls from
+    // JavaScript skip the name lookup
+    _window.bind(name, [this, id](const std::string &args) {
         try {
             const json jArgs = json::parse(args);
-            const json result = _functionRegistry.callFunction(name, jArgs);
+            const json result = _functionRegistry.callFunction(id, jArgs);
             return result.dump();
         } catch (const std::exception &e) {
             return retObj("error", e.what()).dump();
         }
     });
+    return id;
+}
+
+FunctionRegistry::FunctionId Membrane::registerAsyncFunction(
+    const std::string &name, const std::function<json(const json &)> &func,
+    const size_t max_concurrent) {
+    const auto id = _functionRegistry.registerFunction(name, func);
+    {
+        std::lock_guard lock(_async_mutex);
+        _async_limiters[id] =
+            std::make_shared<ConcurrencyLimiter>(_workers, max_concurrent);
+    }
+    _window.bind(
+        name,
+        [this, function = id](const std::string &id, const std::string &args,
+                              void *) {
+            // resolve hands the result over to the UI thread itself
+            callFunctionAsync(function, args,
+                              [this, id](const std::string &result) {
+                                  _window.resolve(id, 0, result);
+                              });
+        },
+        nullptr);
+    return id;
 }
 
 template <typename... Args>
@@ -257,6 +318,157 @@ json Membrane::callFunction(const std::string &name, const json &args) {
     return _functionRegistry.callFunction(name, args);
 }
 
+json Membrane::callFunction(const FunctionRegistry::FunctionId id,
+                            const json &args) {
+    return _functionRegistry.callFunction(id, args);
+}
+
+std::shared_ptr<ConcurrencyLimiter> Membrane::asyncLimiter(
+    const FunctionRegistry::FunctionId id) {
+    std::lock_guard lock(_async_mutex);
+    const auto found = _async_limiters.find(id);
+    return found != _async_limiters.end() ? found->second : nullptr;
+}
+
+void Membrane::callFunctionAsync(
+    const FunctionRegistry::FunctionId id, std::string args,
+    std::function<void(const std::string &)> done) {
+    const auto limiter = asyncLimiter(id);
+    // parsing the arguments and serializing the result are left to the
+    // worker too
+    auto call = [this, id, args = std::move(args), done = std::move(done)] {
+        std::string result;
+        try {
+            result = _functionRegistry.callFunction(id, json::parse(args))
+                         .dump();
+        } catch (const std::exception &e) {
+            result = retObj("error", e.what()).dump();
+        }
+        done(result);
+    };
+    if (limiter) {
+        limiter->post(std::move(call));
+    } else {
+        call();
+    }
+}
+
+struct Membrane::BatchRun {
+    json calls;
+    bool parallel = false;
+    std::function<void(json)> done;
+    std::vector<json> results;
+    std::mutex mutex;
+    // the walk over the calls, plus the parallel calls still running
+    size_t pending = 1;
+};
+
+namespace {
+// whatever the function throws becomes its result, so a batch always
+// completes
+template <typename Key>
+json callCatchingAll(FunctionRegistry &registry, const Key &key,
+                     const json &args) {
+    try {
+        return registry.callFunction(key, args);
+    } catch (const std::exception &e) {
+        return retObj("error", e.what());
+    } catch (...) {
+        return retObj("error", "Function threw a non-standard exception");
+    }
+}
+}  // namespace
+
+void Membrane::callBatch(const json &calls, const bool parallel,
+                         std::function<void(json)> done) {
+    if (!calls.is_array()) {
+        throw std::invalid_argument(
+            "Invalid batch: expected an array of calls");
+    }
+    auto run = std::make_shared<BatchRun>();
+    run->calls = calls;
+    run->parallel = parallel;
+    run->done = std::move(done);
+    run->results.resize(calls.size());
+    continueBatch(run, 0);
+}
+
+void Membrane::continueBatch(const std::shared_ptr<BatchRun> &run,
+                             const size_t from) {
+    for (size_t i = from; i < run->calls.size(); ++i) {
+        const json &entry = run->calls[i];
+        const bool by_id = entry.is_object() && entry.contains("id") &&
+                           entry["id"].is_number_unsigned();
+        if (!by_id && (!entry.is_object() || !entry.contains("name") ||
+                       !entry["name"].is_string())) {
+            run->results[i] = retObj(
+                "error", "Invalid batch call: expected {name or id, args}");
+            continue;
+        }
+        json args = entry.value("args", json::array());
+        if (!args.is_array()) {
+            run->results[i] =
+                retObj("error", "Invalid batch call: args must be an array");
+            continue;
+        }
+        // ids past the registry's type would otherwise wrap onto others
+        const uint64_t raw_id = by_id ? entry["id"].get<uint64_t>() : 0;
+        if (raw_id >
+            std::numeric_limits<FunctionRegistry::FunctionId>::max()) {
+            run->results[i] = retObj(
+                "error", "Unknown function id: " + std::to_string(raw_id));
+            continue;
+        }
+        const std::string name = by_id ? "" : entry["name"].get<std::string>();
+        const auto id =
+            by_id ? static_cast<FunctionRegistry::FunctionId>(raw_id)
+                  : _functionRegistry.functionId(name);
+        if (!id) {
+            run->results[i] = callCatchingAll(_functionRegistry, name, args);
+            continue;
+        }
+        // only functions registered as thread-safe leave this thread
+        const auto limiter = asyncLimiter(*id);
+        if (!limiter) {
+            run->results[i] = callCatchingAll(_functionRegistry, *id, args);
+            continue;
+        }
+        if (!run->parallel) {
+            // the rest of the batch goes back to the pool once the call is
+            // done, which frees the function's slot
+            limiter->post([this, run, i, function = *id,
+                           args = std::move(args)] {
+                run->results[i] =
+                    callCatchingAll(_functionRegistry, function, args);
+                (void)_workers.submit(
+                    [this, run, i] { continueBatch(run, i + 1); });
+            });
+            return;
+        }
+        {
+            std::lock_guard lock(run->mutex);
+            ++run->pending;
+        }
+        limiter->post([this, run, i, function = *id, args = std::move(args)] {
+            json result = callCatchingAll(_functionRegistry, function, args);
+            {
+                std::lock_guard lock(run->mutex);
+                run->results[i] = std::move(result);
+            }
+            finishBatchPart(run);
+        });
+    }
+    finishBatchPart(run);
+}
+
+void Membrane::finishBatchPart(const std::shared_ptr<BatchRun> &run) {
+    {
+        std::lock_guard lock(run->mutex);
+        if (--run->pending != 0) return;
+    }
+    run->done(json(std::move(run->results)));
+}
+
 // --------------------------------
 // Private Helper Methods
 // --------------------------------
@@ -1,8 +1,16 @@
 #ifndef MEMBRANE_HPP
 #define MEMBRANE_HPP
 #include <webview/webview.h>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string_view>
 #include "FunctionRegistry.hpp"
 #include "HttpServer.hpp"
+#include "ThreadPool.hpp"
 #include "nlohmann/json.hpp"
 #include "vfs.hpp"
 #include "zlib.h"
@@ -14,6 +22,40 @@ json retObj(std::string status, std::string message,
 
 using json = nlohmann::json;
 
+// progress of an archive being extracted or created
+struct ArchiveProgress {
+    // uncompressed bytes done so far, and in all as the archive declares
+    // them or the sources add up to
+    uint64_t bytes_done = 0;
+    uint64_t total_bytes = 0;
+    size_t files_done = 0;
+    size_t file_count = 0;
+};
+// limits and progress reporting for extracting a ZIP archive
+struct UnzipOptions {
+    // limits on the uncompressed bytes, checked against the bytes
+    // actually inflated rather than the sizes the archive declares;
+    // 0 is no limit
+    uint64_t max_total_bytes = 0;
+    uint64_t max_entry_bytes = 0;
+    // called from the extracting threads, one call at a time, after
+    // each chunk
+    std::function<void(const ArchiveProgress &)> on_progress;
+};
+// settings for creating a ZIP archive
+struct ArchiveOptions {
+    // deflate level of the entries, from 0 (stored) to 10
+    int level = 6;
+    // called once per entry written, one call at a time
+    std::function<void(const ArchiveProgress &)> on_progress;
+};
+// where an archive operation reads or writes: a path on disk, or with vfs
+// set, a path in that custom VFS, naming an entry or a prefix of entries
+struct ArchiveLocation {
+    std::string vfs;
+    std::string path;
+};
+
 /**
  * @brief The main class of the Membrane library
  * @brief Membrane is a high-level C++ wrapper around the webview library
@@ -42,6 +84,10 @@ public:
     // HTTP Server Management
     // --------------------------------
     int findAvailablePort();
+    // the port the HTTP server listens on
+    int getPort() const {
+        return _port;
+    }
 
     void register_endpoint_handler(
         const std::string &endpoint_path,
@@ -51,56 +97,184 @@ public:
                  const std::string &, std::string &,
                  std::unordered_map<std::string, std::string> &)> &handler);
 
+    // --------------------------------
+    // Binary Channel
+    // --------------------------------
+    // raw bytes cross to and from JavaScript as the bodies of HTTP GET and
+    // PUT requests to BINARY_CHANNEL_PREFIX followed by a handle, instead
+    // of as base64 inside JSON. Bytes nobody claims are dropped after
+    // BINARY_CHANNEL_TTL. Only the app's own origin, and the dev server's
+    // in dev mode, may use the channel from a page.
+    static constexpr std::string_view BINARY_CHANNEL_PREFIX =
+        "/__membrane/binary/";
+    static constexpr std::chrono::seconds BINARY_CHANNEL_TTL{60};
+    // an upload larger than BINARY_UPLOAD_LIMIT is refused unread, and so
+    // is one that would make the channel hold more than
+    // BINARY_CHANNEL_CAPACITY bytes
+    static constexpr size_t BINARY_UPLOAD_LIMIT = 256 * 1024 * 1024;
+    static constexpr size_t BINARY_CHANNEL_CAPACITY = 1024 * 1024 * 1024;
+    void setBinaryChannelLimits(size_t max_upload, size_t capacity);
+
+    // keeps data for JavaScript to GET once; returns its handle
+    std::string publishBinary(Buffer data);
+    // removes and returns the bytes JavaScript PUT under handle, or
+    // nullopt if there are none
+    std::optional<Buffer> takeBinary(const std::string &handle);
+    // a success result sending data through the channel as
+    // {binary: handle, size}; membrane.binary.call() resolves it to an
+    // ArrayBuffer
+    json binaryRet(std::vector<uint8_t> data,
+                   const std::string &message = "Binary data ready");
+
     // --------------------------------
     // VFS (Virtual File System) Management
     // --------------------------------
     void add_vfs(const std::string &path, const unsigned char *data,
                  unsigned int len);
 
+    // like add_vfs, but the entry points at data instead of copying it;
+    // meant for compiled-in resources that live for the whole program
+    void add_static_vfs(const std::string &path, const unsigned char *data,
+                        unsigned int len);
+
+    // serves the compiled-in assets of pack at the root, ahead of the main
+    // VFS; pack must have static storage duration
+    void add_resource_pack(const ResourcePack &pack);
+
     void add_custom_vfs(const std::string &name);
 
-    void add_persistent_vfs(const std::string &name, const std::string &path);
+    // a non-zero debounce persists changes from a background thread; the
+    // write-ahead log makes every change durable before it is saved, within
+    // VirtualFileSystem::DEFAULT_WAL_SYNC_INTERVAL and off the calling
+    // thread
+    void add_persistent_vfs(
+        const std::string &name, const std::string &path,
+        std::chrono::milliseconds debounce = std::chrono::milliseconds(0),
+        bool write_ahead_log = false);
+
+    // an in-memory copy of the custom VFS source, served under /name. The
+    // two share their contents until either one changes them.
+    void clone_custom_vfs(const std::string &source, const std::string &name);
+
+    // point-in-time copies of a custom VFS, kept under snapshot_name until
+    // dropped; each costs only what the VFS changed since it was taken
+    void snapshot_custom_vfs(const std::string &vfs_name,
+                             const std::string &snapshot_name);
+    // returns how many entries the restore changed
+    size_t restore_custom_vfs(const std::string &vfs_name,
+                              const std::string &snapshot_name);
+    bool drop_vfs_snapshot(const std::string &vfs_name,
+                           const std::string &snapshot_name);
 
     void add_to_custom_vfs(const std::string &vfs_name, const std::string &path,
                            const unsigned char *data, unsigned int len);
 
     bool save_vfs_to_disk(const std::string &vfs_name);
 
-    bool save_all_vfs_to_disk();
+    // with wait set to false, VFS instances that persist in the background
+    // are only asked to save, so the caller never blocks on their disk I/O
+    bool save_all_vfs_to_disk(bool wait = true);
 
     void setDefaultVfsPath(const std::string &path) {
         _default_vfs_path = get_app_data_directory(path);
     }
 
-    std::map<std::string, VirtualFileSystem::FileEntry> get_files(
-        std::string vfs_name) {
-        auto &vfs = _custom_vfs[vfs_name];
-        return vfs->get_allFiles();
+    // handles only: the contents stay shared with the VFS
+    std::map<std::string, VirtualFileSystem::FileHandle> get_files(
+        const std::string &vfs_name) {
+        return getCustomVFS(vfs_name).get_files();
     };
 
-    VirtualFileSystem::FileEntry get_file(std::string vfs_name,
-                                          std::string path) {
-        auto &vfs = _custom_vfs[vfs_name];
-        return vfs->getFile(path);
+    // nullptr if there is no such entry
+    VirtualFileSystem::FileHandle get_file(const std::string &vfs_name,
+                                           const std::string_view path) {
+        return getCustomVFS(vfs_name).get_file(path);
     };
 
+    VirtualFileSystem::ListPage list_files(const std::string &vfs_name,
+                                           const std::string_view prefix,
+                                           const std::string_view after = {},
+                                           const size_t limit = SIZE_MAX) {
+        return getCustomVFS(vfs_name).list(prefix, after, limit);
+    }
+
     const VirtualFileSystem& getVFS() const {
         return _vfs;
     }
 
+    // stores identical contents once across the main VFS and every custom
+    // VFS, including the ones created later
+    void enable_content_dedup();
+    // all zero until enable_content_dedup() is called
+    [[nodiscard]] ContentStore::Stats content_dedup_stats() const {
+        return _content_store ? _content_store->stats()
+                              : ContentStore::Stats{};
+    }
+
+    // gives access to the storage options of a custom VFS, e.g. packed
+    // storage or the write-ahead log
+    VirtualFileSystem &getCustomVFS(const std::string &vfs_name) {
+        const auto found = _custom_vfs.find(vfs_name);
+        if (found == _custom_vfs.end()) {
+            throw std::runtime_error("VFS not found: " + vfs_name);
+        }
+        return *found->second;
+    }
+
     // --------------------------------
     // Data Management and Compression
     // --------------------------------
-    void UnzipData(const std::string &zip_path,
-                   const VirtualFileSystem::FileEntry &file_entry);
+    // extracts the ZIP held by file_entry into the main VFS, streaming each
+    // entry in fixed-size chunks. Returns false if the archive cannot be
+    // read, an entry is corrupt or a limit is hit; a limit stops the
+    // extraction, and the entries finished by then are kept.
+    bool UnzipData(const std::string &zip_path,
+                   const VirtualFileSystem::FileEntry &file_entry,
+                   const UnzipOptions &options = {});
+    // the same for the ZIP file at zip_path, into the directory destination.
+    // Entries go from disk to disk chunk by chunk, so memory use does not
+    // grow with the archive. Entries whose path leads outside destination
+    // are skipped.
+    bool UnzipToDirectory(const std::string &zip_path,
+                          const std::filesystem::path &destination,
+                          const UnzipOptions &options = {});
 
-    void checkAndUnzip();
+    // zips the files under source, a directory or a VFS prefix, into the
+    // archive at destination. Entries are deflated in parallel on the
+    // worker pool, a few at a time, and written as soon as they are ready,
+    // so a file destination never holds the archive in memory. Names are
+    // relative to source.
+    bool CreateArchive(const ArchiveLocation &source,
+                       const ArchiveLocation &destination,
+                       const ArchiveOptions &options = {});
+    // extracts the archive at source, a ZIP file or VFS entry, below
+    // destination, a directory or a VFS prefix; names are kept whole
+    bool ExtractArchive(const ArchiveLocation &source,
+                        const ArchiveLocation &destination,
+                        const UnzipOptions &options = {});
+
+    // extracts every ZIP in the main VFS and the resource packs into the
+    // main VFS. With in_place, the archives are indexed instead: their
+    // entries are served from the archive bytes and inflated when read.
+    void checkAndUnzip(bool in_place = false,
+                       const UnzipOptions &options = {});
 
     // --------------------------------
     // Function Registry and JavaScript Bridge
     // --------------------------------
-    void registerFunction(const std::string &name,
-                          const std::function<json(const json &args)> &func);
+    // returns the function's id, which callFunction and batches also take
+    FunctionRegistry::FunctionId registerFunction(
+        const std::string &name,
+        const std::function<json(const json &args)> &func);
+    // like registerFunction, but each call runs on the worker pool and
+    // resolves its JavaScript promise when done, so a slow function never
+    // blocks rendering; the UI thread only queues the call. At most
+    // max_concurrent calls of the function run at once, 0 being no limit
+    // beyond the pool's size. func must be safe to call from any thread.
+    FunctionRegistry::FunctionId registerAsyncFunction(
+        const std::string &name,
+        const std::function<json(const json &args)> &func,
+        size_t max_concurrent = 0);
 
     template <typename... Args>
     void registerSimpleFunction(const std::string &name,
@@ -110,12 +284,32 @@ public:
     }
 
     json callFunction(const std::string &name, const json &args);
+    json callFunction(FunctionRegistry::FunctionId id, const json &args);
+    // the path a JavaScript call takes: args is the JSON text of the
+    // argument array, and done gets the JSON text of the result. A function
+    // registered with registerAsyncFunction runs on the worker pool within
+    // its limit, done being called there; any other runs before this
+    // returns.
+    void callFunctionAsync(FunctionRegistry::FunctionId id, std::string args,
+                           std::function<void(const std::string &)> done);
+    // runs every {name or id, args} call of the array and hands their
+    // results to done in the same order, so JavaScript crosses the bridge
+    // once for all of them. Calls of functions registered with
+    // registerAsyncFunction run on the worker pool within their limits, one
+    // after another or, with parallel, all at once; the others run in order
+    // on the thread the batch is on, which after an async call is a worker.
+    // Nothing waits: done is called on whichever thread finishes last.
+    // Throws std::invalid_argument if calls is not an array.
+    void callBatch(const json &calls, bool parallel,
+                   std::function<void(json results)> done);
 
     // --------------------------------
     // Miscellaneous
     // --------------------------------
     void setTools();
     void registerFileSystemFunctions();
+    void registerArchiveFunctions();
+    void setBinaryTools();
 
 private:
     // --------------------------------
@@ -130,6 +324,29 @@ private:
     static json callWithJsonArgs(std::function<json(Args...)> func,
                                  const json &args);
 
+    // limiter of a function registered with registerAsyncFunction, or null
+    std::shared_ptr<ConcurrencyLimiter> asyncLimiter(
+        FunctionRegistry::FunctionId id);
+
+    // a batch in flight, shared by the calls still running
+    struct BatchRun;
+    // runs the batch's calls from the given one on until one has to wait
+    // for a worker, which then carries on
+    void continueBatch(const std::shared_ptr<BatchRun> &run, size_t from);
+    // settles one running part of the batch; the last one calls done
+    static void finishBatchPart(const std::shared_ptr<BatchRun> &run);
+
+    // routes the binary channel's requests; called before the server starts
+    void mountBinaryChannel();
+    // drops the expired slots; _binary_mutex must be held
+    void dropExpiredBinary(std::chrono::steady_clock::time_point now);
+
+    // runs job on the worker pool and reports its progress and result to
+    // JavaScript as membrane-archive events; returns the job's id
+    using ArchiveJob = std::function<bool(
+        const std::function<void(const ArchiveProgress &)> &on_progress)>;
+    uint64_t startArchiveJob(ArchiveJob job);
+
     // --------------------------------
     // Member Variables
     // --------------------------------
@@ -141,8 +358,40 @@ private:
     VirtualFileSystem _vfs;
     std::unordered_map<std::string, std::unique_ptr<VirtualFileSystem>>
         _custom_vfs;
+    // keyed by VFS name, then snapshot name
+    std::map<std::pair<std::string, std::string>, VirtualFileSystem::Snapshot>
+        _vfs_snapshots;
+    std::vector<const ResourcePack *> _resource_packs;
+    std::shared_ptr<ContentStore> _content_store;
     bool _running = false;
     FunctionRegistry _functionRegistry;
+    // limiters of the functions registered with registerAsyncFunction
+    std::mutex _async_mutex;
+    std::unordered_map<FunctionRegistry::FunctionId,
+                       std::shared_ptr<ConcurrencyLimiter>>
+        _async_limiters;
+    // bytes in the binary channel, by handle; uploaded ones came from
+    // JavaScript and are only taken, the others are only sent
+    struct BinarySlot {
+        Buffer data;
+        bool uploaded = false;
+        std::chrono::steady_clock::time_point expires;
+    };
+    std::mutex _binary_mutex;
+    std::unordered_map<std::string, BinarySlot> _binary_slots;
+    // bytes in _binary_slots, and the limits on uploads
+    size_t _binary_held = 0;
+    size_t _binary_upload_limit = BINARY_UPLOAD_LIMIT;
+    size_t _binary_capacity = BINARY_CHANNEL_CAPACITY;
+    // origins whose pages may use the binary channel
+    std::vector<std::string> _binary_origins;
+    // handles come straight from the system's entropy, as they are all
+    // that guards a slot
+    std::random_device _binary_handles;
+    // ids of the archive jobs started from JavaScript
+    std::atomic<uint64_t> _archive_jobs{0};
+    // background work that must not run on the UI thread, e.g. unzipping
+    ThreadPool _workers{std::max(1u, std::thread::hardware_concurrency())};
     std::string _entry;
 };
 #endif  // MEMBRANE_HPP
@@ -4,108 +4,6 @@ json retObj(std::string status, std::string message, const std::string &data) {
     return json({{"status", status}, {"message", message}, {"data", data}});
 }
 
-std::string base64Encode(const uint8_t* data, size_t length) {
-    static const std::string base64_chars = 
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-        "abcdefghijklmnopqrstuvwxyz"
-        "0123456789+/";
-    
-    std::string encoded;
-    int i = 0;
-    int j = 0;
-    uint8_t char_array_3[3];
-    uint8_t char_array_4[4];
-    
-    while (length--) {
-        char_array_3[i++] = *(data++);
-        if (i == 3) {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
-            
-            for (i = 0; i < 4; i++) {
-                encoded += base64_chars[char_array_4[i]];
-            }
-            i = 0;
-        }
-    }
-    
-    if (i) {
-        for (j = i; j < 3; j++) {
-            char_array_3[j] = '\0';
-        }
-        
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-        char_array_4[3] = char_array_3[2] & 0x3f;
-        
-        for (j = 0; j < i + 1; j++) {
-            encoded += base64_chars[char_array_4[j]];
-        }
-        
-        while (i++ < 3) {
-            encoded += '=';
-        }
-    }
-    
-    return encoded;
-}
-
-std::vector<uint8_t> base64Decode(const std::string& encoded) {
-    static const std::string base64_chars = 
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-        "abcdefghijklmnopqrstuvwxyz"
-        "0123456789+/";
-    
-    int in_len = encoded.size();
-    int i = 0;
-    int j = 0;
-    int in_ = 0;
-    uint8_t char_array_4[4], char_array_3[3];
-    std::vector<uint8_t> decoded;
-    
-    while (in_len-- && (encoded[in_] != '=') && 
-           (isalnum(encoded[in_]) || (encoded[in_] == '+') || (encoded[in_] == '/'))) {
-        char_array_4[i++] = encoded[in_]; in_++;
-        if (i == 4) {
-            for (i = 0; i < 4; i++) {
-                char_array_4[i] = base64_chars.find(char_array_4[i]);
-            }
-            
-            char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-            char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-            
-            for (i = 0; i < 3; i++) {
-                decoded.push_back(char_array_3[i]);
-            }
-            i = 0;
-        }
-    }
-    
-    if (i) {
-        for (j = i; j < 4; j++) {
-            char_array_4[j] = 0;
-        }
-        
-        for (j = 0; j < 4; j++) {
-            char_array_4[j] = base64_chars.find(char_array_4[j]);
-        }
-        
-        char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-        char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-        char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-        
-        for (j = 0; j < i - 1; j++) {
-            decoded.push_back(char_array_3[j]);
-        }
-    }
-    
-    return decoded;
-}
-
 void Membrane::registerFileSystemFunctions() {
     // File System Operations
     registerFunction("membrane_fs_save", [this](const json &args) {
@@ -325,6 +223,41 @@ void Membrane::registerFileSystemFunctions() {
         }
     });
     
+    // like readBinary and writeBinary, but the bytes go through the binary
+    // channel instead of base64
+    registerFunction("membrane_fs_readBytes", [this](const json &args) {
+        if (args.size() != 1) {
+            return retObj("error", "Invalid number of arguments. Expected 1: path");
+        }
+
+        try {
+            return binaryRet(readBinaryFile(args[0].get<std::string>()),
+                             "Binary file read successfully");
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+
+    registerFunction("membrane_fs_writeBytes", [this](const json &args) {
+        if (args.size() != 2) {
+            return retObj("error", "Invalid number of arguments. Expected 2: path, handle");
+        }
+
+        const std::string path = args[0].get<std::string>();
+        const std::string handle = args[1].get<std::string>();
+
+        try {
+            const std::optional<Buffer> data = takeBinary(handle);
+            if (!data) {
+                return retObj("error", "No binary data for handle: " + handle);
+            }
+            writeBinaryFile(path, data->span());
+            return retObj("success", "Binary file written successfully");
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+    
     registerFunction("membrane_fs_createTemp", [this](const json &args) {
         std::string prefix = "membrane";
         std::string extension = ".tmp";
@@ -371,20 +304,27 @@ void Membrane::setTools() {
 
     // File system operations
     registerFileSystemFunctions();
+    registerArchiveFunctions();
+    setBinaryTools();
 
     // VFS Operations
     registerFunction("membrane_vfs_create", [this](const json &args) {
-        if (args.size() != 1 && args.size() != 2)
+        if (args.empty() || args.size() > 4)
             return retObj("error",
-                          "Invalid number of arguments. Expected 1 or 2 "
+                          "Invalid number of arguments. Expected 1 to 4 "
                           "arguments: vfs_name, "
-                          "[persistence_dir]");
+                          "[persistence_dir], [debounce_ms], [write_ahead_log]");
 
         const std::string vfs_name = args[0].get<std::string>();
         try {
-            if (args.size() == 2) {
+            if (args.size() >= 2) {
                 const std::string persistence_dir = args[1].get<std::string>();
-                add_persistent_vfs(vfs_name, persistence_dir);
+                const auto debounce = std::chrono::milliseconds(
+                    args.size() >= 3 ? args[2].get<int>() : 0);
+                const bool write_ahead_log =
+                    args.size() == 4 && args[3].get<bool>();
+                add_persistent_vfs(vfs_name, persistence_dir, debounce,
+                                   write_ahead_log);
             } else {
                 add_custom_vfs(vfs_name);
             }
@@ -415,6 +355,179 @@ void Membrane::setTools() {
         }
     });
 
+    registerFunction("membrane_vfs_appendFile", [this](const json &args) {
+        if (args.size() != 3 || !args[0].is_string() || !args[1].is_string() ||
+            !args[2].is_string()) {
+            return retObj("error",
+                          "Invalid arguments. Expected 3 arguments: "
+                          "vfs_name, path, content");
+        }
+
+        const std::string vfs_name = args[0].get<std::string>();
+        const std::string path = args[1].get<std::string>();
+        const std::string &content = args[2].get_ref<const std::string &>();
+        try {
+            getCustomVFS(vfs_name).append_file(
+                path, reinterpret_cast<const unsigned char *>(content.data()),
+                content.size());
+            return retObj("success",
+                          "Appended to file in VFS: " + vfs_name + "/" + path);
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+
+    registerFunction("membrane_vfs_writeFile", [this](const json &args) {
+        if (args.size() != 4 || !args[0].is_string() || !args[1].is_string() ||
+            !args[2].is_number_unsigned() || !args[3].is_string()) {
+            return retObj("error",
+                          "Invalid arguments. Expected 4 arguments: "
+                          "vfs_name, path, offset, content");
+        }
+
+        const std::string vfs_name = args[0].get<std::string>();
+        const std::string path = args[1].get<std::string>();
+        const std::string &content = args[3].get_ref<const std::string &>();
+        try {
+            getCustomVFS(vfs_name).write_file(
+                path, args[2].get<uint64_t>(),
+                reinterpret_cast<const unsigned char *>(content.data()),
+                content.size());
+            return retObj("success",
+                          "Wrote to file in VFS: " + vfs_name + "/" + path);
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+
+    registerFunction("membrane_vfs_listFiles", [this](const json &args) {
+        if (args.empty() || args.size() > 4 || !args[0].is_string()) {
+            return retObj("error",
+                          "Invalid arguments. Expected 1 to 4 arguments: "
+                          "vfs_name, [prefix], [after], [limit]");
+        }
+
+        try {
+            const std::string prefix =
+                args.size() >= 2 ? args[1].get<std::string>() : "";
+            const std::string after =
+                args.size() >= 3 ? args[2].get<std::string>() : "";
+            const size_t limit =
+                args.size() == 4 ? args[3].get<size_t>() : SIZE_MAX;
+            const VirtualFileSystem::ListPage page = list_files(
+                args[0].get<std::string>(), prefix, after, limit);
+            // metadata only; contents are read one file at a time
+            json entries = json::array();
+            for (const auto &[path, entry] : page.entries) {
+                entries.push_back({{"path", path},
+                                   {"size", entry->size()},
+                                   {"mimeType", entry->mime_type}});
+            }
+            return json({{"status", "success"},
+                         {"message", "Listed VFS entries"},
+                         {"data",
+                          {{"entries", std::move(entries)},
+                           {"nextAfter", page.next_after}}}});
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+
+    registerFunction("membrane_vfs_list", [this](const json &args) {
+        if (args.empty() || args.size() > 2 || !args[0].is_string()) {
+            return retObj("error",
+                          "Invalid arguments. Expected 1 or 2 arguments: "
+                          "vfs_name, [directory]");
+        }
+
+        try {
+            const std::string dir =
+                args.size() == 2 ? args[1].get<std::string>() : "";
+            json children = json::array();
+            for (const DirectoryIndex::Child &child :
+                 getCustomVFS(args[0].get<std::string>()).list_directory(dir)) {
+                children.push_back({{"name", child.name},
+                                    {"isDirectory", child.is_directory},
+                                    {"size", child.size},
+                                    {"fileCount", child.file_count}});
+            }
+            return json({{"status", "success"},
+                         {"message", "Listed VFS directory"},
+                         {"data", std::move(children)}});
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+
+    registerFunction("membrane_vfs_stat", [this](const json &args) {
+        if (args.size() != 2 || !args[0].is_string() || !args[1].is_string()) {
+            return retObj("error",
+                          "Invalid arguments. Expected 2 arguments: "
+                          "vfs_name, path");
+        }
+
+        try {
+            const std::string path = args[1].get<std::string>();
+            const DirectoryIndex::Stat stat =
+                getCustomVFS(args[0].get<std::string>()).stat(path);
+            if (!stat.exists) {
+                return retObj("error", "No such VFS path: " + path);
+            }
+            return json({{"status", "success"},
+                         {"message", "VFS path information"},
+                         {"data",
+                          {{"isDirectory", stat.is_directory},
+                           {"size", stat.size},
+                           {"fileCount", stat.file_count}}}});
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+
+    registerFunction("membrane_vfs_remove", [this](const json &args) {
+        if (args.size() != 2 || !args[0].is_string() || !args[1].is_string()) {
+            return retObj("error",
+                          "Invalid arguments. Expected 2 arguments: "
+                          "vfs_name, path");
+        }
+
+        try {
+            const std::string path = args[1].get<std::string>();
+            const size_t removed =
+                getCustomVFS(args[0].get<std::string>()).remove_tree(path);
+            if (removed == 0) {
+                return retObj("error", "No such VFS path: " + path);
+            }
+            return retObj("success", "Removed " + std::to_string(removed) +
+                                         " entries under " + path);
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+
+    registerFunction("membrane_vfs_move", [this](const json &args) {
+        if (args.size() != 3 || !args[0].is_string() || !args[1].is_string() ||
+            !args[2].is_string()) {
+            return retObj("error",
+                          "Invalid arguments. Expected 3 arguments: "
+                          "vfs_name, from, to");
+        }
+
+        try {
+            const std::string from = args[1].get<std::string>();
+            const std::string to = args[2].get<std::string>();
+            const size_t moved =
+                getCustomVFS(args[0].get<std::string>()).move(from, to);
+            if (moved == 0) {
+                return retObj("error", "No such VFS path: " + from);
+            }
+            return retObj("success", "Moved " + std::to_string(moved) +
+                                         " entries to " + to);
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+
     registerFunction("membrane_vfs_save", [this](const json &args) {
         if (args.size() != 1) {
             return retObj("error", 
@@ -435,7 +548,7 @@ void Membrane::setTools() {
 
     registerFunction("membrane_vfs_saveAll", [this](const json &) {
         try {
-            if (save_all_vfs_to_disk()) {
+            if (save_all_vfs_to_disk(false)) {
                 return retObj("success", "Saved all VFS instances to disk");
             }
             return retObj("error", "Failed to save some VFS instances to disk");
@@ -444,6 +557,146 @@ void Membrane::setTools() {
         }
     });
 
+    registerFunction("membrane_vfs_clone", [this](const json &args) {
+        if (args.size() != 2 || !args[0].is_string() || !args[1].is_string()) {
+            return retObj("error",
+                          "Invalid arguments. Expected 2 arguments: "
+                          "source_vfs_name, vfs_name");
+        }
+
+        const std::string vfs_name = args[1].get<std::string>();
+        try {
+            clone_custom_vfs(args[0].get<std::string>(), vfs_name);
+            return retObj("success", "Created custom VFS: " + vfs_name);
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+
+    registerFunction("membrane_vfs_snapshot", [this](const json &args) {
+        if (args.size() != 2 || !args[0].is_string() || !args[1].is_string()) {
+            return retObj("error",
+                          "Invalid arguments. Expected 2 arguments: "
+                          "vfs_name, snapshot_name");
+        }
+
+        const std::string snapshot_name = args[1].get<std::string>();
+        try {
+            snapshot_custom_vfs(args[0].get<std::string>(), snapshot_name);
+            return retObj("success", "Took snapshot: " + snapshot_name);
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+
+    registerFunction("membrane_vfs_restore", [this](const json &args) {
+        if (args.size() != 2 || !args[0].is_string() || !args[1].is_string()) {
+            return retObj("error",
+                          "Invalid arguments. Expected 2 arguments: "
+                          "vfs_name, snapshot_name");
+        }
+
+        const std::string snapshot_name = args[1].get<std::string>();
+        try {
+            const size_t changed =
+                restore_custom_vfs(args[0].get<std::string>(), snapshot_name);
+            return json({{"status", "success"},
+                         {"message", "Restored snapshot: " + snapshot_name},
+                         {"data", {{"changed", changed}}}});
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+
+    registerFunction("membrane_vfs_dropSnapshot", [this](const json &args) {
+        if (args.size() != 2 || !args[0].is_string() || !args[1].is_string()) {
+            return retObj("error",
+                          "Invalid arguments. Expected 2 arguments: "
+                          "vfs_name, snapshot_name");
+        }
+
+        const std::string snapshot_name = args[1].get<std::string>();
+        if (drop_vfs_snapshot(args[0].get<std::string>(), snapshot_name)) {
+            return retObj("success", "Dropped snapshot: " + snapshot_name);
+        }
+        return retObj("error", "Snapshot not found: " + snapshot_name);
+    });
+
+    registerFunction("membrane_vfs_enableDedup", [this](const json &) {
+        enable_content_dedup();
+        return retObj("success", "Content deduplication enabled");
+    });
+
+    registerFunction("membrane_vfs_dedupStats", [this](const json &) {
+        const ContentStore::Stats stats = content_dedup_stats();
+        return json({{"status", "success"},
+                     {"message", "Content deduplication statistics"},
+                     {"data",
+                      {{"blobs", stats.blobs},
+                       {"references", stats.references},
+                       {"storedBytes", stats.stored_bytes},
+                       {"referencedBytes", stats.referenced_bytes},
+                       {"savedBytes", stats.saved_bytes()}}}});
+    });
+
+    registerFunction("membrane_vfs_setMemoryBudget", [this](const json &args) {
+        if (args.size() != 2 || !args[0].is_string() ||
+            !args[1].is_number_unsigned()) {
+            return retObj("error",
+                          "Invalid arguments. Expected 2 arguments: "
+                          "vfs_name, budget_bytes (0 disables the budget)");
+        }
+
+        const std::string vfs_name = args[0].get<std::string>();
+        try {
+            getCustomVFS(vfs_name).set_memory_budget(args[1].get<uint64_t>());
+            return retObj("success", "Memory budget set for VFS: " + vfs_name);
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+
+    registerFunction("membrane_vfs_memoryStats", [this](const json &args) {
+        if (args.size() != 1 || !args[0].is_string()) {
+            return retObj("error",
+                "Invalid number of arguments. Expected 1 argument: vfs_name");
+        }
+
+        try {
+            const VirtualFileSystem::MemoryStats stats =
+                getCustomVFS(args[0].get<std::string>()).memory_stats();
+            return json({{"status", "success"},
+                         {"message", "VFS memory statistics"},
+                         {"data",
+                          {{"budget", stats.budget},
+                           {"residentBytes", stats.resident_bytes},
+                           {"spilledBytes", stats.spilled_bytes},
+                           {"hits", stats.hits},
+                           {"misses", stats.misses},
+                           {"hitRate", stats.hit_rate()},
+                           {"evictions", stats.evictions}}}});
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+
+    registerFunction("membrane_vfs_setCompression", [this](const json &args) {
+        if (args.size() != 2 || !args[0].is_string() ||
+            !args[1].is_boolean()) {
+            return retObj("error",
+                          "Invalid arguments. Expected 2 arguments: "
+                          "vfs_name, enabled");
+        }
+
+        const std::string vfs_name = args[0].get<std::string>();
+        try {
+            getCustomVFS(vfs_name).use_compression(args[1].get<bool>());
+            return retObj("success", "Compression set for VFS: " + vfs_name);
+        } catch (const std::exception &e) {
+            return retObj("error", e.what());
+        }
+    });
+
     // Clipboard Operations
     registerFunction("membrane_clipboard_write", [](const json &args) {
         if (args.size() != 1 || !args[0].is_string()) {
@@ -477,6 +730,48 @@ void Membrane::setTools() {
         });
     });
     
+    // ids JavaScript can put in batches instead of names
+    registerFunction("membrane_util_functionIds", [this](const json &) {
+        return json({
+            {"status", "success"},
+            {"message", "Function ids"},
+            {"data", _functionRegistry.getFunctionIds()},
+        });
+    });
+
+    // runs many calls in one bridge crossing; the UI thread only queues the
+    // batch, which resolves its promise when done. See callBatch
+    _window.bind(
+        "membrane_batch",
+        [this](const std::string &id, const std::string &args, void *) {
+            (void)_workers.submit([this, id, args] {
+                const auto resolve = [this, id](const json &result) {
+                    _window.resolve(id, 0, result.dump());
+                };
+                try {
+                    const json jArgs = json::parse(args);
+                    if (jArgs.empty() || jArgs.size() > 2) {
+                        resolve(retObj("error",
+                                       "Invalid number of arguments. "
+                                       "Expected 1 or 2 arguments: calls, "
+                                       "[options]"));
+                        return;
+                    }
+                    const bool parallel =
+                        jArgs.size() == 2 && jArgs[1].is_object() &&
+                        jArgs[1].value("parallel", false);
+                    callBatch(jArgs[0], parallel, [resolve](json results) {
+                        resolve({{"status", "success"},
+                                 {"message", "Batch completed"},
+                                 {"data", std::move(results)}});
+                    });
+                } catch (const std::exception &e) {
+                    resolve(retObj("error", e.what()));
+                }
+            });
+        },
+        nullptr);
+
     // Initialize JavaScript bridge with updated function names
     _window.eval(R"script(
         window.membrane = window.membrane || {};
@@ -494,21 +789,90 @@ void Membrane::setTools() {
             watch: async (path, eventName) => window.membrane_fs_watch(path, eventName),
             readBinary: async (path) => window.membrane_fs_readBinary(path),
             writeBinary: async (path, data) => window.membrane_fs_writeBinary(path, data),
+            readBytes: async (path) => window.membrane.binary.call('membrane_fs_readBytes', path),
+            writeBytes: async (path, data) =>
+                window.membrane_fs_writeBytes(path, await window.membrane.binary.put(data)),
             createTemp: async (prefix, ext) => window.membrane_fs_createTemp(prefix, ext)
         };
         
         // VFS API
         window.membrane.vfs = {
-            create: async (name, persistenceDir = null) => {
-                return persistenceDir ? 
-                    window.membrane_vfs_create(name, persistenceDir) : 
-                    window.membrane_vfs_create(name);
+            create: async (name, persistenceDir = null, debounceMs = 0, writeAheadLog = false) => {
+                if (!persistenceDir) return window.membrane_vfs_create(name);
+                return window.membrane_vfs_create(name, persistenceDir, debounceMs, writeAheadLog);
             },
             addFile: async (vfsName, path, content) => window.membrane_vfs_addFile(vfsName, path, content),
+            appendFile: async (vfsName, path, content) => window.membrane_vfs_appendFile(vfsName, path, content),
+            writeFile: async (vfsName, path, offset, content) => window.membrane_vfs_writeFile(vfsName, path, offset, content),
+            list: async (vfsName, prefix = '') => window.membrane_vfs_list(vfsName, prefix),
+            stat: async (vfsName, path) => window.membrane_vfs_stat(vfsName, path),
+            remove: async (vfsName, path) => window.membrane_vfs_remove(vfsName, path),
+            move: async (vfsName, from, to) => window.membrane_vfs_move(vfsName, from, to),
+            listFiles: async (vfsName, prefix = '', after = '', limit = null) => {
+                if (limit === null) return window.membrane_vfs_listFiles(vfsName, prefix, after);
+                return window.membrane_vfs_listFiles(vfsName, prefix, after, limit);
+            },
+            clone: async (sourceName, vfsName) => window.membrane_vfs_clone(sourceName, vfsName),
+            snapshot: async (vfsName, snapshotName) => window.membrane_vfs_snapshot(vfsName, snapshotName),
+            restore: async (vfsName, snapshotName) => window.membrane_vfs_restore(vfsName, snapshotName),
+            dropSnapshot: async (vfsName, snapshotName) => window.membrane_vfs_dropSnapshot(vfsName, snapshotName),
             save: async (vfsName) => window.membrane_vfs_save(vfsName),
-            saveAll: async () => window.membrane_vfs_saveAll()
+            saveAll: async () => window.membrane_vfs_saveAll(),
+            enableDedup: async () => window.membrane_vfs_enableDedup(),
+            dedupStats: async () => window.membrane_vfs_dedupStats(),
+            setMemoryBudget: async (vfsName, bytes) => window.membrane_vfs_setMemoryBudget(vfsName, bytes),
+            memoryStats: async (vfsName) => window.membrane_vfs_memoryStats(vfsName),
+            setCompression: async (vfsName, enabled) => window.membrane_vfs_setCompression(vfsName, enabled)
         };
         
+        // Archive API: jobs run in the background and report through
+        // membrane-archive events; options.onProgress receives the progress
+        // ones, and the promise settles with the final one
+        window.membrane.archive = (() => {
+            const jobs = new Map();
+            const finished = new Map();
+            const settle = (job, detail) => job.resolve({
+                status: detail.type === 'done' ? 'success' : 'error',
+                message: detail.message || 'Archive operation finished',
+                data: detail
+            });
+            window.addEventListener('membrane-archive', (event) => {
+                const detail = event.detail;
+                const job = jobs.get(detail.job);
+                if (detail.type === 'progress') {
+                    if (job && job.onProgress) job.onProgress(detail);
+                    return;
+                }
+                if (!job) {
+                    finished.set(detail.job, detail);
+                    return;
+                }
+                jobs.delete(detail.job);
+                settle(job, detail);
+            });
+            const run = async (start, source, destination, options = {}) => {
+                const { onProgress, ...settings } = options;
+                const started = await start(source, destination, settings);
+                if (started.status !== 'success') return started;
+                const id = started.data.job;
+                return new Promise((resolve) => {
+                    if (finished.has(id)) {
+                        settle({ resolve }, finished.get(id));
+                        finished.delete(id);
+                    } else {
+                        jobs.set(id, { resolve, onProgress });
+                    }
+                });
+            };
+            return {
+                // source and destination are disk paths or { vfs, path }
+                create: async (source, destination, options) =>
+                    run(window.membrane_archive_create, source, destination, options),
+                extract: async (source, destination, options) =>
+                    run(window.membrane_archive_extract, source, destination, options)
+            };
+        })();
+
         // System API
         window.membrane.system = {
             openUrl: async (url) => window.membrane_system_openUrl(url)
@@ -522,7 +886,21 @@ void Membrane::setTools() {
         
         // Utility API
         window.membrane.util = {
-            listFunctions: async () => window.membrane_util_listFunctions()
+            listFunctions: async () => window.membrane_util_listFunctions(),
+            functionIds: async () => window.membrane_util_functionIds()
+        };
+
+        // Batch API: runs many calls in one crossing and resolves with
+        // their results, in order. A call is { name, args }, { id, args }
+        // or [name, ...args], ids coming from util.functionIds(); the batch
+        // runs off the UI thread, and options.parallel runs the calls of
+        // async functions at once.
+        window.membrane.batch = async (calls, options = {}) => {
+            const result = await window.membrane_batch(
+                calls.map(call => Array.isArray(call) ? { name: call[0], args: call.slice(1) } : call),
+                options);
+            if (result.status !== 'success') throw new Error(result.message);
+            return result.data;
         };
     )script");
 }
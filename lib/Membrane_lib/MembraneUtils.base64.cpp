@@ -0,0 +1,438 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "MembraneUtils.hpp"
+#include <array>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MEMBRANE_BASE64_X86
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define MEMBRANE_BASE64_NEON
+#include <arm_neon.h>
+#endif
+
+// The vector kernels only handle whole blocks of valid input; the scalar
+// code finishes what they leave, so the padding and the stop at the first
+// character outside the alphabet are handled in one place.
+
+namespace {
+constexpr char ENCODE_TABLE[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+constexpr uint8_t INVALID = 0xff;
+// the 6-bit value of every byte, INVALID outside the alphabet
+constexpr std::array<uint8_t, 256> DECODE_TABLE = [] {
+    std::array<uint8_t, 256> table{};
+    table.fill(INVALID);
+    for (uint8_t i = 0; i < 64; ++i) {
+        table[static_cast<unsigned char>(ENCODE_TABLE[i])] = i;
+    }
+    return table;
+}();
+
+// each kernel consumes whole blocks from the start of its input and
+// returns how many bytes or characters it consumed
+using EncodeKernel = size_t (*)(const uint8_t *in, size_t length, char *out);
+// out must have room for out_capacity bytes
+using DecodeKernel = size_t (*)(const char *in, size_t length, uint8_t *out,
+                                size_t out_capacity);
+
+size_t encode_none(const uint8_t *, size_t, char *) {
+    return 0;
+}
+
+size_t decode_none(const char *, size_t, uint8_t *, size_t) {
+    return 0;
+}
+
+// encodes in[0, length), padding the last group with '='
+void encode_scalar(const uint8_t *in, const size_t length, char *out) {
+    size_t i = 0;
+    for (; i + 3 <= length; i += 3, out += 4) {
+        const uint32_t group = in[i] << 16 | in[i + 1] << 8 | in[i + 2];
+        out[0] = ENCODE_TABLE[group >> 18];
+        out[1] = ENCODE_TABLE[group >> 12 & 0x3f];
+        out[2] = ENCODE_TABLE[group >> 6 & 0x3f];
+        out[3] = ENCODE_TABLE[group & 0x3f];
+    }
+    if (i == length) return;
+    const bool two = length - i == 2;
+    const uint32_t group = in[i] << 16 | (two ? in[i + 1] << 8 : 0);
+    out[0] = ENCODE_TABLE[group >> 18];
+    out[1] = ENCODE_TABLE[group >> 12 & 0x3f];
+    out[2] = two ? ENCODE_TABLE[group >> 6 & 0x3f] : '=';
+    out[3] = '=';
+}
+
+// decodes in[0, length) up to its first character outside the alphabet;
+// returns the number of bytes written
+size_t decode_scalar(const char *in, const size_t length, uint8_t *out) {
+    const auto *chars = reinterpret_cast<const unsigned char *>(in);
+    uint8_t *const start = out;
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4, out += 3) {
+        const uint8_t a = DECODE_TABLE[chars[i]];
+        const uint8_t b = DECODE_TABLE[chars[i + 1]];
+        const uint8_t c = DECODE_TABLE[chars[i + 2]];
+        const uint8_t d = DECODE_TABLE[chars[i + 3]];
+        if ((a | b | c | d) & 0xc0) break;
+        out[0] = static_cast<uint8_t>(a << 2 | b >> 4);
+        out[1] = static_cast<uint8_t>(b << 4 | c >> 2);
+        out[2] = static_cast<uint8_t>(c << 6 | d);
+    }
+    // fewer than four characters are left before the end or the first
+    // invalid one; they make one byte less than their count
+    std::array<uint8_t, 4> rest{};
+    size_t count = 0;
+    while (i < length && count < 3 && DECODE_TABLE[chars[i]] != INVALID) {
+        rest[count++] = DECODE_TABLE[chars[i++]];
+    }
+    if (count >= 2) *out++ = static_cast<uint8_t>(rest[0] << 2 | rest[1] >> 4);
+    if (count == 3) *out++ = static_cast<uint8_t>(rest[1] << 4 | rest[2] >> 2);
+    return out - start;
+}
+
+#ifdef MEMBRANE_BASE64_X86
+// Vector kernels after Muła and Lemire, "Faster Base64 Encoding and
+// Decoding Using AVX2 Instructions" (2018). Each lane of 16 bytes is
+// handled alike, so the AVX2 kernels repeat the SSSE3 constants in both
+// lanes.
+
+// the 6-bit values in each group of three bytes spread to one byte each
+__attribute__((target("ssse3"))) __m128i encode_indices(const __m128i in) {
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+// the ASCII character of each 6-bit value, as an offset picked by range
+__attribute__((target("ssse3"))) __m128i encode_chars(const __m128i indices) {
+    __m128i offset = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    offset = _mm_or_si128(offset, _mm_and_si128(less, _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, offset), indices);
+}
+
+__attribute__((target("ssse3"))) size_t encode_ssse3(const uint8_t *in,
+                                                     const size_t length,
+                                                     char *out) {
+    const __m128i spread =
+        _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    size_t i = 0;
+    // 12 bytes are used of the 16 loaded
+    for (; i + 16 <= length; i += 12, out += 16) {
+        const __m128i block = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)),
+            spread);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                         encode_chars(encode_indices(block)));
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) size_t encode_avx2(const uint8_t *in,
+                                                   const size_t length,
+                                                   char *out) {
+    const __m256i spread = _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3,
+        5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i offsets = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    size_t i = 0;
+    // each lane takes 12 bytes; the second load ends 4 bytes past them
+    for (; i + 28 <= length; i += 24, out += 32) {
+        const __m128i low =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        const __m128i high =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 12));
+        const __m256i block = _mm256_shuffle_epi8(
+            _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1),
+            spread);
+        const __m256i t0 =
+            _mm256_and_si256(block, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 =
+            _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 =
+            _mm256_and_si256(block, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 =
+            _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        const __m256i indices = _mm256_or_si256(t1, t3);
+        __m256i offset = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        offset = _mm256_or_si256(
+            offset, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(out),
+            _mm256_add_epi8(_mm256_shuffle_epi8(offsets, offset), indices));
+    }
+    return i;
+}
+
+// A character is valid when the bits its low and high nibbles select in
+// these tables do not overlap; the roll table turns a valid character into
+// its 6-bit value by its high nibble, '/' being set apart.
+#define MEMBRANE_BASE64_LUT_LO                                             \
+    0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, \
+        0x1b, 0x1b, 0x1b, 0x1a
+#define MEMBRANE_BASE64_LUT_HI                                             \
+    0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, \
+        0x10, 0x10, 0x10, 0x10
+#define MEMBRANE_BASE64_LUT_ROLL \
+    0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+// the three bytes of each group of four, in order, and four unused bytes
+#define MEMBRANE_BASE64_PACK \
+    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+
+__attribute__((target("ssse3"))) size_t decode_ssse3(
+    const char *in, const size_t length, uint8_t *out,
+    const size_t out_capacity) {
+    const __m128i lut_lo = _mm_setr_epi8(MEMBRANE_BASE64_LUT_LO);
+    const __m128i lut_hi = _mm_setr_epi8(MEMBRANE_BASE64_LUT_HI);
+    const __m128i lut_roll = _mm_setr_epi8(MEMBRANE_BASE64_LUT_ROLL);
+    const __m128i pack = _mm_setr_epi8(MEMBRANE_BASE64_PACK);
+    const __m128i mask_2f = _mm_set1_epi8(0x2f);
+    size_t i = 0;
+    size_t written = 0;
+    // 16 bytes are stored for the 12 decoded
+    for (; i + 16 <= length && written + 16 <= out_capacity;
+         i += 16, written += 12) {
+        __m128i block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        const __m128i hi_nibbles =
+            _mm_and_si128(_mm_srli_epi32(block, 4), mask_2f);
+        const __m128i lo_nibbles = _mm_and_si128(block, mask_2f);
+        const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+        if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi),
+                                             _mm_setzero_si128())) != 0) {
+            break;
+        }
+        const __m128i eq_2f = _mm_cmpeq_epi8(block, mask_2f);
+        const __m128i roll =
+            _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+        block = _mm_add_epi8(block, roll);
+        const __m128i pairs =
+            _mm_maddubs_epi16(block, _mm_set1_epi32(0x01400140));
+        block = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + written),
+                         _mm_shuffle_epi8(block, pack));
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) size_t decode_avx2(
+    const char *in, const size_t length, uint8_t *out,
+    const size_t out_capacity) {
+    const __m256i lut_lo =
+        _mm256_setr_epi8(MEMBRANE_BASE64_LUT_LO, MEMBRANE_BASE64_LUT_LO);
+    const __m256i lut_hi =
+        _mm256_setr_epi8(MEMBRANE_BASE64_LUT_HI, MEMBRANE_BASE64_LUT_HI);
+    const __m256i lut_roll =
+        _mm256_setr_epi8(MEMBRANE_BASE64_LUT_ROLL, MEMBRANE_BASE64_LUT_ROLL);
+    const __m256i pack =
+        _mm256_setr_epi8(MEMBRANE_BASE64_PACK, MEMBRANE_BASE64_PACK);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+    size_t i = 0;
+    size_t written = 0;
+    // 32 bytes are stored for the 24 decoded
+    for (; i + 32 <= length && written + 32 <= out_capacity;
+         i += 32, written += 24) {
+        __m256i block =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        const __m256i hi_nibbles =
+            _mm256_and_si256(_mm256_srli_epi32(block, 4), mask_2f);
+        const __m256i lo_nibbles = _mm256_and_si256(block, mask_2f);
+        const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        if (!_mm256_testz_si256(lo, hi)) break;
+        const __m256i eq_2f = _mm256_cmpeq_epi8(block, mask_2f);
+        const __m256i roll =
+            _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+        block = _mm256_add_epi8(block, roll);
+        const __m256i pairs =
+            _mm256_maddubs_epi16(block, _mm256_set1_epi32(0x01400140));
+        block = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+        block = _mm256_shuffle_epi8(block, pack);
+        // the 12 bytes of each lane next to each other
+        block = _mm256_permutevar8x32_epi32(
+            block, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + written),
+                            block);
+    }
+    return i;
+}
+#undef MEMBRANE_BASE64_LUT_LO
+#undef MEMBRANE_BASE64_LUT_HI
+#undef MEMBRANE_BASE64_LUT_ROLL
+#undef MEMBRANE_BASE64_PACK
+#endif  // MEMBRANE_BASE64_X86
+
+#ifdef MEMBRANE_BASE64_NEON
+// 48 bytes become 64 characters: vld3 splits the groups of three bytes
+// and vst4 interleaves the four characters of each group
+size_t encode_neon(const uint8_t *in, const size_t length, char *out) {
+    const uint8x16x4_t table = {
+        vld1q_u8(reinterpret_cast<const uint8_t *>(ENCODE_TABLE)),
+        vld1q_u8(reinterpret_cast<const uint8_t *>(ENCODE_TABLE) + 16),
+        vld1q_u8(reinterpret_cast<const uint8_t *>(ENCODE_TABLE) + 32),
+        vld1q_u8(reinterpret_cast<const uint8_t *>(ENCODE_TABLE) + 48)};
+    const uint8x16_t low6 = vdupq_n_u8(0x3f);
+    size_t i = 0;
+    for (; i + 48 <= length; i += 48, out += 64) {
+        const uint8x16x3_t bytes = vld3q_u8(in + i);
+        uint8x16x4_t chars;
+        chars.val[0] = vshrq_n_u8(bytes.val[0], 2);
+        chars.val[1] = vandq_u8(
+            vorrq_u8(vshlq_n_u8(bytes.val[0], 4), vshrq_n_u8(bytes.val[1], 4)),
+            low6);
+        chars.val[2] = vandq_u8(
+            vorrq_u8(vshlq_n_u8(bytes.val[1], 2), vshrq_n_u8(bytes.val[2], 6)),
+            low6);
+        chars.val[3] = vandq_u8(bytes.val[2], low6);
+        for (auto &c : chars.val) c = vqtbl4q_u8(table, c);
+        vst4q_u8(reinterpret_cast<uint8_t *>(out), chars);
+    }
+    return i;
+}
+
+size_t decode_neon(const char *in, const size_t length, uint8_t *out,
+                   size_t) {
+    // DECODE_TABLE's first half; bytes from 128 on are all invalid
+    const uint8x16x4_t low = {
+        vld1q_u8(DECODE_TABLE.data()), vld1q_u8(DECODE_TABLE.data() + 16),
+        vld1q_u8(DECODE_TABLE.data() + 32), vld1q_u8(DECODE_TABLE.data() + 48)};
+    const uint8x16x4_t high = {
+        vld1q_u8(DECODE_TABLE.data() + 64), vld1q_u8(DECODE_TABLE.data() + 80),
+        vld1q_u8(DECODE_TABLE.data() + 96),
+        vld1q_u8(DECODE_TABLE.data() + 112)};
+    size_t i = 0;
+    for (; i + 64 <= length; i += 64, out += 48) {
+        uint8x16x4_t values =
+            vld4q_u8(reinterpret_cast<const uint8_t *>(in + i));
+        uint8x16_t invalid = vdupq_n_u8(0);
+        for (auto &v : values.val) {
+            const uint8x16_t c = v;
+            v = vqtbx4q_u8(vqtbl4q_u8(low, c), high,
+                           vsubq_u8(c, vdupq_n_u8(64)));
+            v = vorrq_u8(v, vcgeq_u8(c, vdupq_n_u8(128)));
+            invalid = vorrq_u8(invalid, v);
+        }
+        if (vmaxvq_u8(invalid) > 63) break;
+        uint8x16x3_t bytes;
+        bytes.val[0] = vorrq_u8(vshlq_n_u8(values.val[0], 2),
+                                vshrq_n_u8(values.val[1], 4));
+        bytes.val[1] = vorrq_u8(vshlq_n_u8(values.val[1], 4),
+                                vshrq_n_u8(values.val[2], 2));
+        bytes.val[2] =
+            vorrq_u8(vshlq_n_u8(values.val[2], 6), values.val[3]);
+        vst3q_u8(out, bytes);
+    }
+    return i;
+}
+#endif  // MEMBRANE_BASE64_NEON
+
+struct Kernels {
+    EncodeKernel encode;
+    DecodeKernel decode;
+};
+
+bool is_supported(const Base64Kernel kernel) {
+    switch (kernel) {
+        case Base64Kernel::Scalar:
+            return true;
+#ifdef MEMBRANE_BASE64_X86
+        case Base64Kernel::SSSE3:
+            return __builtin_cpu_supports("ssse3");
+        case Base64Kernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+#ifdef MEMBRANE_BASE64_NEON
+        case Base64Kernel::NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+Kernels kernels_of(const Base64Kernel kernel) {
+    if (!is_supported(kernel)) {
+        throw std::invalid_argument("Base64 kernel not supported on this CPU");
+    }
+    switch (kernel) {
+#ifdef MEMBRANE_BASE64_X86
+        case Base64Kernel::SSSE3:
+            return {encode_ssse3, decode_ssse3};
+        case Base64Kernel::AVX2:
+            return {encode_avx2, decode_avx2};
+#endif
+#ifdef MEMBRANE_BASE64_NEON
+        case Base64Kernel::NEON:
+            return {encode_neon, decode_neon};
+#endif
+        default:
+            return {encode_none, decode_none};
+    }
+}
+
+Base64Kernel fastest_kernel() {
+    static const Base64Kernel fastest = [] {
+        for (const Base64Kernel kernel :
+             {Base64Kernel::AVX2, Base64Kernel::NEON, Base64Kernel::SSSE3}) {
+            if (is_supported(kernel)) return kernel;
+        }
+        return Base64Kernel::Scalar;
+    }();
+    return fastest;
+}
+}  // namespace
+
+std::vector<Base64Kernel> supportedBase64Kernels() {
+    std::vector<Base64Kernel> kernels;
+    for (const Base64Kernel kernel :
+         {Base64Kernel::Scalar, Base64Kernel::SSSE3, Base64Kernel::AVX2,
+          Base64Kernel::NEON}) {
+        if (is_supported(kernel)) kernels.push_back(kernel);
+    }
+    return kernels;
+}
+
+std::string base64Encode(const uint8_t *data, const size_t length) {
+    return base64Encode(data, length, fastest_kernel());
+}
+
+std::string base64Encode(const uint8_t *data, const size_t length,
+                         const Base64Kernel kernel) {
+    std::string encoded((length + 2) / 3 * 4, '\0');
+    const size_t done = kernels_of(kernel).encode(data, length, encoded.data());
+    encode_scalar(data + done, length - done, encoded.data() + done / 3 * 4);
+    return encoded;
+}
+
+std::vector<uint8_t> base64Decode(const std::string &encoded) {
+    return base64Decode(encoded, fastest_kernel());
+}
+
+std::vector<uint8_t> base64Decode(const std::string_view encoded,
+                                  const Base64Kernel kernel) {
+    // sized for the whole input, and cut to what was decoded
+    std::vector<uint8_t> decoded(encoded.size() / 4 * 3 + 3);
+    const size_t done = kernels_of(kernel).decode(
+        encoded.data(), encoded.size(), decoded.data(), decoded.size());
+    const size_t written =
+        done / 4 * 3 + decode_scalar(encoded.data() + done,
+                                     encoded.size() - done,
+                                     decoded.data() + done / 4 * 3);
+    decoded.resize(written);
+    return decoded;
+}
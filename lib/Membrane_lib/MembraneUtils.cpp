@@ -240,7 +240,7 @@ std::vector<uint8_t> readBinaryFile(const std::string &path) {
     return content;
 }
 
-void writeBinaryFile(const std::string &path, const std::vector<uint8_t> &data) {
+void writeBinaryFile(const std::string &path, std::span<const uint8_t> data) {
     std::ofstream file(path, std::ios::out | std::ios::binary);
     if (!file.is_open()) {
         throw std::runtime_error("Failed to open file for writing: " + path);
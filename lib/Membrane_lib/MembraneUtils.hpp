@@ -5,9 +5,11 @@
 #ifndef MEMBRANE_UTILS_HPP
 #define MEMBRANE_UTILS_HPP
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <iostream>
 #include <cstdio>
+#include <span>
 #include <vector>
 #include <thread>
 #include <filesystem>
@@ -48,14 +50,21 @@ int watchFileOrDirectory(const std::string &path, std::function<void(const std::
 
 // Binary data
 std::vector<uint8_t> readBinaryFile(const std::string &path);
-void writeBinaryFile(const std::string &path, const std::vector<uint8_t> &data);
+void writeBinaryFile(const std::string &path, std::span<const uint8_t> data);
 
 // Temporary files
 std::string createTempFile(const std::string &prefix, const std::string &extension);
 
 // Helper functions
+// Base64 kernels; the ones the CPU lacks throw std::invalid_argument
+enum class Base64Kernel { Scalar, SSSE3, AVX2, NEON };
+std::vector<Base64Kernel> supportedBase64Kernels();
+// without a kernel, the fastest supported one is used
 std::string base64Encode(const uint8_t* data, size_t length);
+std::string base64Encode(const uint8_t* data, size_t length, Base64Kernel kernel);
+// decoding stops at the first character outside the alphabet, '=' included
 std::vector<uint8_t> base64Decode(const std::string& encoded);
+std::vector<uint8_t> base64Decode(std::string_view encoded, Base64Kernel kernel);
 
 // Registration function
 void registerFileSystemFunctions();
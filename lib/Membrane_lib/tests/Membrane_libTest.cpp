@@ -1,51 +1,18 @@
 #include <gtest/gtest.h>
-#include <gmock/gmock.h>
 #include "Membrane.hpp"
+#include <miniz.h>
+#include <curl/curl.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <filesystem>
 #include <fstream>
+#include <future>
+#include <mutex>
+#include <random>
+#include <set>
 #include <thread>
 
-// Mock classes for dependencies
-class MockHttpServer : public HttpServer {
-public:
-    explicit MockHttpServer(int port) : HttpServer(port) {}
-    
-    MOCK_METHOD(bool, start, (), (override));
-    MOCK_METHOD(void, stop, (), (override));
-    MOCK_METHOD(bool, is_running, (), (const, override));
-    MOCK_METHOD(void, mount_vfs, (const std::string&, const VirtualFileSystem*), (override));
-    MOCK_METHOD(void, register_route, (const std::string&, const std::function<void(const std::string&, const std::unordered_map<std::string, std::string>&, const std::string&, std::string&, std::unordered_map<std::string, std::string>&)>&), (override));
-};
-
-class MockVFS : public VirtualFileSystem {
-public:
-    MockVFS() : VirtualFileSystem() {}
-    explicit MockVFS(const std::string& path) : VirtualFileSystem(path) {}
-    
-    MOCK_METHOD(void, add_file, (const std::string&, const unsigned char*, unsigned int), (override));
-    MOCK_METHOD(bool, exists, (const std::string&), (const, override));
-    MOCK_METHOD(const FileEntry*, get_file, (const std::string&), (const, override));
-    MOCK_METHOD(bool, save_to_disk, (), (override));
-    MOCK_METHOD(bool, load_from_disk, (), (override));
-    MOCK_METHOD(bool, is_persistent, (), (const, override));
-    
-    // Helper to provide test data
-    void add_test_file(const std::string& path, const std::string& content, const std::string& mime_type) {
-        FileEntry entry;
-        entry.data = std::vector<unsigned char>(content.begin(), content.end());
-        entry.mime_type = mime_type;
-        files[path] = entry;
-    }
-    
-    // Expose the internal files map
-    const std::map<std::string, FileEntry>& get_files() const override {
-        return files;
-    }
-
-private:
-    std::map<std::string, FileEntry> files;
-};
-
 // Test fixture
 class MembraneTest : public ::testing::Test {
 protected:
@@ -107,6 +74,199 @@ TEST_F(MembraneTest, FunctionRegistration) {
     EXPECT_EQ(result["result"].get<int>(), 8);
 }
 
+// Async functions share the registry, so they can be called from C++ and other threads
+TEST_F(MembraneTest, AsyncFunctionRegistration) {
+    Membrane app("Test App");
+    std::atomic<int> running{0};
+    std::atomic<int> most_running{0};
+    const auto id = app.registerAsyncFunction("asyncFunc", [&](const json& args) -> json {
+        const int now = ++running;
+        int most = most_running;
+        while (now > most && !most_running.compare_exchange_weak(most, now)) {}
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        running--;
+        if (args[0].get<int>() < 0) throw std::runtime_error("negative");
+        return {{"result", args[0].get<int>() * 2}};
+    }, 2);
+
+    const auto names = app.getRegisteredFunctions();
+    EXPECT_NE(std::find(names.begin(), names.end(), "asyncFunc"), names.end());
+
+    // the calls go through the limiter to the workers, as JavaScript's do
+    std::mutex mutex;
+    std::condition_variable all_done;
+    std::map<int, json> results;
+    std::set<std::thread::id> threads;
+    for (int i = -1; i < 8; i++) {
+        app.callFunctionAsync(id, json::array({i}).dump(), [&, i](const std::string& result) {
+            std::lock_guard lock(mutex);
+            results[i] = json::parse(result);
+            threads.insert(std::this_thread::get_id());
+            all_done.notify_one();
+        });
+    }
+    {
+        std::unique_lock lock(mutex);
+        ASSERT_TRUE(all_done.wait_for(lock, std::chrono::seconds(10), [&] { return results.size() == 9; }));
+        EXPECT_FALSE(threads.contains(std::this_thread::get_id()));
+    }
+    for (int i = 0; i < 8; i++) EXPECT_EQ(results[i]["result"].get<int>(), i * 2);
+    EXPECT_EQ(results[-1]["status"].get<std::string>(), "error");
+    EXPECT_LE(most_running, 2);
+
+    // a function registered synchronously answers before the call returns
+    const auto sync = app.registerFunction("syncFunc", [](const json&) -> json { return 1; });
+    std::string answer;
+    app.callFunctionAsync(sync, "[]", [&](const std::string& result) { answer = result; });
+    EXPECT_EQ(answer, "1");
+    app.callFunctionAsync(sync, "not json", [&](const std::string& result) { answer = result; });
+    EXPECT_EQ(json::parse(answer)["status"].get<std::string>(), "error");
+}
+
+// A batch returns one result per call, in order, run one by one or in parallel;
+// async functions always run on workers and nothing waits for them
+TEST_F(MembraneTest, BatchCallsKeepTheirOrder) {
+    Membrane app("Test App");
+    const auto run_batch = [&app](const json& calls, bool parallel = false) {
+        auto promise = std::make_shared<std::promise<json>>();
+        auto results = promise->get_future();
+        app.callBatch(calls, parallel, [promise](json done) { promise->set_value(std::move(done)); });
+        EXPECT_EQ(results.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+        return results.get();
+    };
+    std::atomic<int> calls{0};
+    std::atomic<bool> square_left_thread{false};
+    const auto caller = std::this_thread::get_id();
+    const auto square = app.registerFunction("square", [&](const json& args) -> json {
+        calls++;
+        if (std::this_thread::get_id() != caller) square_left_thread = true;
+        return {{"result", args[0].get<int>() * args[0].get<int>()}};
+    });
+    std::atomic<int> cubes_on_workers{0};
+    app.registerAsyncFunction("cube", [&](const json& args) -> json {
+        calls++;
+        if (std::this_thread::get_id() != caller) cubes_on_workers++;
+        return {{"result", args[0].get<int>() * args[0].get<int>() * args[0].get<int>()}};
+    }, 4);
+
+    json batch = json::array();
+    for (int i = 0; i < 100; i++) batch.push_back({{"name", i % 2 ? "cube" : "square"}, {"args", {i}}});
+    batch.push_back({{"name", "missing"}});
+    batch.push_back(42);
+    for (const bool parallel : {true, false}) {
+        const json results = run_batch(batch, parallel);
+        ASSERT_EQ(results.size(), 102);
+        for (int i = 0; i < 100; i++) EXPECT_EQ(results[i]["result"].get<int>(), i % 2 ? i * i * i : i * i);
+        EXPECT_EQ(results[100]["message"].get<std::string>(), "Function not found: missing");
+        EXPECT_EQ(results[101]["status"].get<std::string>(), "error");
+        // in parallel the batch only hands the cubes over; one by one, it
+        // carries on from the worker that ran the last cube
+        EXPECT_EQ(square_left_thread, !parallel);
+    }
+    EXPECT_EQ(calls, 200);
+    EXPECT_EQ(cubes_on_workers, 100);
+    EXPECT_THROW(app.callBatch(json::object(), false, [](json) {}), std::invalid_argument);
+
+    // calls by id skip the name lookup; ids past the registry's type do not
+    // wrap onto registered functions
+    EXPECT_EQ(app.callFunction(square, {5})["result"].get<int>(), 25);
+    const uint64_t wrapped = (uint64_t{1} << 32) + square;
+    const json by_id = run_batch(json::array({{{"id", square}, {"args", {6}}}, {{"id", wrapped}, {"args", {6}}}}));
+    EXPECT_EQ(by_id[0]["result"].get<int>(), 36);
+    EXPECT_EQ(by_id[1]["message"].get<std::string>(), "Unknown function id: " + std::to_string(wrapped));
+    // JavaScript learns the ids from the bridge
+    const json ids = app.callFunction("membrane_util_functionIds", json::array());
+    EXPECT_EQ(ids["data"]["square"].get<FunctionRegistry::FunctionId>(), square);
+
+    // a function throwing something other than an exception still settles
+    // the batch, run one by one or in parallel
+    app.registerAsyncFunction("throwsInt", [](const json&) -> json { throw 42; });
+    const json throwing = json::array({{{"name", "throwsInt"}}, {{"name", "square"}, {"args", {2}}}});
+    for (const bool parallel : {true, false}) {
+        const json results = run_batch(throwing, parallel);
+        EXPECT_EQ(results[0]["status"].get<std::string>(), "error");
+        EXPECT_EQ(results[1]["result"].get<int>(), 4);
+    }
+}
+
+// Bytes cross the binary channel as raw HTTP bodies, once each way
+TEST_F(MembraneTest, BinaryChannelMovesRawBytes) {
+    Membrane app("Test App");
+    std::vector<uint8_t> bytes(256 * 1024);
+    for (size_t i = 0; i < bytes.size(); i++) bytes[i] = static_cast<uint8_t>(i * 31);
+
+    const auto transfer = [](const std::string& url, const std::string& method, const std::vector<uint8_t>& data,
+                             const std::string& origin = "") {
+        CURL* curl = curl_easy_init();
+        std::string body;
+        long status = 0;
+        curl_slist* headers = nullptr;
+        if (!origin.empty()) headers = curl_slist_append(headers, ("Origin: " + origin).c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method.c_str());
+        if (method == "PUT") {
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.data());
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(data.size()));
+        }
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, +[](char* ptr, size_t size, size_t count, std::string* out) {
+            out->append(ptr, size * count);
+            return size * count;
+        });
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+        curl_easy_perform(curl);
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+        curl_easy_cleanup(curl);
+        curl_slist_free_all(headers);
+        return std::make_pair(status, std::vector<uint8_t>(body.begin(), body.end()));
+    };
+    const std::string base = "http://localhost:" + std::to_string(app.getPort()) +
+                             std::string(Membrane::BINARY_CHANNEL_PREFIX);
+
+    const json result = app.binaryRet(bytes);
+    EXPECT_EQ(result["status"], "success");
+    EXPECT_EQ(result["data"]["size"].get<size_t>(), bytes.size());
+    const std::string handle = result["data"]["binary"].get<std::string>();
+    EXPECT_EQ(handle.size(), 32);
+    auto [status, received] = transfer(base + handle, "GET", {});
+    EXPECT_EQ(status, 200);
+    EXPECT_EQ(received, bytes);
+    EXPECT_EQ(transfer(base + handle, "GET", {}).first, 404);
+    EXPECT_FALSE(app.takeBinary(handle));
+
+    EXPECT_EQ(transfer(base + "upload-1", "PUT", bytes).first, 204);
+    EXPECT_EQ(transfer(base + "upload-1", "PUT", bytes).first, 403);
+    EXPECT_EQ(transfer(base + "upload-1", "GET", {}).first, 404);
+    const std::optional<Buffer> uploaded = app.takeBinary("upload-1");
+    ASSERT_TRUE(uploaded);
+    EXPECT_TRUE(std::equal(uploaded->begin(), uploaded->end(), bytes.begin(), bytes.end()));
+    EXPECT_FALSE(app.takeBinary("upload-1"));
+    EXPECT_EQ(transfer(base + "not/a/handle", "PUT", bytes).first, 404);
+
+    // pages from other origins can neither read nor fill slots
+    const std::string own_origin = "http://localhost:" + std::to_string(app.getPort());
+    const std::string other_origin = "http://example.com";
+    EXPECT_EQ(transfer(base + "upload-2", "OPTIONS", {}, other_origin).first, 403);
+    EXPECT_EQ(transfer(base + "upload-2", "PUT", bytes, other_origin).first, 403);
+    EXPECT_FALSE(app.takeBinary("upload-2"));
+    const std::string published = app.binaryRet(bytes)["data"]["binary"].get<std::string>();
+    EXPECT_EQ(transfer(base + published, "GET", {}, other_origin).first, 403);
+    EXPECT_EQ(transfer(base + published, "GET", {}, own_origin).first, 200);
+    EXPECT_EQ(transfer(base + "upload-2", "OPTIONS", {}, own_origin).first, 204);
+    EXPECT_EQ(transfer(base + "upload-2", "PUT", bytes, own_origin).first, 204);
+    EXPECT_TRUE(app.takeBinary("upload-2"));
+
+    // uploads are bounded one by one and in total
+    app.setBinaryChannelLimits(300 * 1024, 400 * 1024);
+    EXPECT_EQ(transfer(base + "upload-3", "PUT", std::vector<uint8_t>(301 * 1024), own_origin).first, 413);
+    // only the channel's uploads: the rest of the server keeps its limit
+    EXPECT_EQ(transfer(own_origin + "/elsewhere", "PUT", std::vector<uint8_t>(301 * 1024)).first, 404);
+    EXPECT_EQ(transfer(base + "upload-3", "PUT", bytes).first, 204);
+    EXPECT_EQ(transfer(base + "upload-4", "PUT", bytes).first, 503);
+    EXPECT_TRUE(app.takeBinary("upload-3"));
+    EXPECT_EQ(transfer(base + "upload-4", "PUT", bytes).first, 204);
+}
+
 // Test VFS operations
 TEST_F(MembraneTest, VFSOperations) {
     Membrane app("Test App");
@@ -172,17 +332,209 @@ TEST_F(MembraneTest, ZipExtraction) {
     app.UnzipData("test.zip", zip_entry);
 }
 
+// Entries are extracted in parallel, with the leading directory stripped
+TEST_F(MembraneTest, ZipExtractionAddsEveryEntry) {
+    Membrane app("Test App");
+
+    mz_zip_archive writer;
+    memset(&writer, 0, sizeof(writer));
+    ASSERT_TRUE(mz_zip_writer_init_heap(&writer, 0, 0));
+    for (int i = 0; i < 64; i++) {
+        const std::string name = "dist/assets/file" + std::to_string(i) + ".js";
+        const std::string content(1000 + i, static_cast<char>('a' + i % 26));
+        ASSERT_TRUE(mz_zip_writer_add_mem(&writer, name.c_str(), content.data(), content.size(),
+                                          i % 2 ? MZ_DEFAULT_LEVEL : MZ_NO_COMPRESSION));
+    }
+    void* archive = nullptr;
+    size_t archive_size = 0;
+    ASSERT_TRUE(mz_zip_writer_finalize_heap_archive(&writer, &archive, &archive_size));
+    mz_zip_writer_end(&writer);
+
+    VirtualFileSystem::FileEntry zip_entry;
+    zip_entry.data = std::vector<unsigned char>(static_cast<unsigned char*>(archive),
+                                                static_cast<unsigned char*>(archive) + archive_size);
+    zip_entry.mime_type = "application/zip";
+    mz_free(archive);
+    app.UnzipData("dist.zip", zip_entry);
+
+    for (int i = 0; i < 64; i++) {
+        const auto file = app.getVFS().get_file("assets/file" + std::to_string(i) + ".js");
+        ASSERT_NE(file, nullptr) << i;
+        EXPECT_EQ(file->data.size(), 1000u + i);
+        EXPECT_EQ(file->data[0], static_cast<unsigned char>('a' + i % 26));
+        EXPECT_EQ(file->mime_type, "application/javascript");
+    }
+}
+
+// Limits are enforced while streaming, and progress covers every byte
+TEST_F(MembraneTest, ZipExtractionStreamsWithinLimits) {
+    Membrane app("Test App");
+
+    mz_zip_archive writer;
+    memset(&writer, 0, sizeof(writer));
+    ASSERT_TRUE(mz_zip_writer_init_heap(&writer, 0, 0));
+    const std::string big(300 * 1024, 'b');
+    const std::string small(100, 's');
+    ASSERT_TRUE(mz_zip_writer_add_mem(&writer, "dist/big.txt", big.data(), big.size(), MZ_DEFAULT_LEVEL));
+    ASSERT_TRUE(mz_zip_writer_add_mem(&writer, "dist/small.txt", small.data(), small.size(), MZ_DEFAULT_LEVEL));
+    void* archive = nullptr;
+    size_t archive_size = 0;
+    ASSERT_TRUE(mz_zip_writer_finalize_heap_archive(&writer, &archive, &archive_size));
+    mz_zip_writer_end(&writer);
+    VirtualFileSystem::FileEntry zip_entry;
+    zip_entry.data = std::vector<unsigned char>(static_cast<unsigned char*>(archive),
+                                                static_cast<unsigned char*>(archive) + archive_size);
+    zip_entry.mime_type = "application/zip";
+    mz_free(archive);
+
+    UnzipOptions limited;
+    limited.max_entry_bytes = 64 * 1024;
+    EXPECT_FALSE(app.UnzipData("dist.zip", zip_entry, limited));
+    EXPECT_EQ(app.getVFS().get_file("big.txt"), nullptr);
+
+    std::mutex progress_mutex;
+    ArchiveProgress last;
+    int reports = 0;
+    UnzipOptions options;
+    options.max_total_bytes = big.size() + small.size();
+    options.on_progress = [&](const ArchiveProgress& progress) {
+        std::lock_guard lock(progress_mutex);
+        EXPECT_GE(progress.bytes_done, last.bytes_done);
+        last = progress;
+        reports++;
+    };
+    EXPECT_TRUE(app.UnzipData("dist.zip", zip_entry, options));
+    EXPECT_GT(reports, 2);
+    EXPECT_EQ(last.bytes_done, big.size() + small.size());
+    EXPECT_EQ(last.total_bytes, big.size() + small.size());
+    EXPECT_EQ(last.file_count, 2u);
+    const auto file = app.getVFS().get_file("big.txt");
+    ASSERT_NE(file, nullptr);
+    EXPECT_EQ(file->data.size(), big.size());
+}
+
+// Entries are inflated into a buffer of their declared size, so one whose
+// contents do not match that size is refused instead of overflowing it
+TEST_F(MembraneTest, ZipExtractionRejectsMisdeclaredSizes) {
+    Membrane app("Test App");
+
+    mz_zip_archive writer;
+    memset(&writer, 0, sizeof(writer));
+    ASSERT_TRUE(mz_zip_writer_init_heap(&writer, 0, 0));
+    const std::string content(100 * 1024, 'c');
+    ASSERT_TRUE(mz_zip_writer_add_mem(&writer, "dist/c.txt", content.data(), content.size(), MZ_DEFAULT_LEVEL));
+    void* archive = nullptr;
+    size_t archive_size = 0;
+    ASSERT_TRUE(mz_zip_writer_finalize_heap_archive(&writer, &archive, &archive_size));
+    mz_zip_writer_end(&writer);
+    const std::vector<unsigned char> bytes(static_cast<unsigned char*>(archive),
+                                           static_cast<unsigned char*>(archive) + archive_size);
+    mz_free(archive);
+    // the uncompressed size sits 24 bytes into the central directory header
+    const unsigned char central[] = {0x50, 0x4b, 0x01, 0x02};
+    const auto header = std::search(bytes.begin(), bytes.end(), std::begin(central), std::end(central));
+    ASSERT_NE(header, bytes.end());
+    const size_t size_at = (header - bytes.begin()) + 24;
+
+    for (const uint32_t declared : {uint32_t{50 * 1024}, uint32_t{200 * 1024}}) {
+        std::vector<unsigned char> patched = bytes;
+        for (int i = 0; i < 4; i++) patched[size_at + i] = static_cast<unsigned char>(declared >> (8 * i));
+        VirtualFileSystem::FileEntry zip_entry;
+        zip_entry.data = std::move(patched);
+        zip_entry.mime_type = "application/zip";
+        EXPECT_FALSE(app.UnzipData("dist.zip", zip_entry)) << declared;
+        EXPECT_EQ(app.getVFS().get_file("c.txt"), nullptr) << declared;
+    }
+    VirtualFileSystem::FileEntry zip_entry;
+    zip_entry.data = bytes;
+    zip_entry.mime_type = "application/zip";
+    EXPECT_TRUE(app.UnzipData("dist.zip", zip_entry));
+    const auto file = app.getVFS().get_file("c.txt");
+    ASSERT_NE(file, nullptr);
+    EXPECT_EQ(std::string(file->data.begin(), file->data.end()), content);
+}
+
+// A VFS prefix survives being archived into one VFS and extracted into another
+TEST_F(MembraneTest, ArchiveRoundTripsVFSPrefix) {
+    Membrane app("Test App");
+    app.add_custom_vfs("archive-source");
+    app.add_custom_vfs("archive-out");
+    app.add_custom_vfs("archive-copy");
+    auto& source = app.getCustomVFS("archive-source");
+    for (int i = 0; i < 40; i++) {
+        std::vector<unsigned char> content(5000 + i * 97, static_cast<unsigned char>('a' + i % 26));
+        // some entries do not deflate and are stored
+        if (i % 3 == 0) {
+            for (size_t j = 0; j < content.size(); j++) content[j] = static_cast<unsigned char>(j * 7919 >> 3);
+        }
+        source.add_file("site/file" + std::to_string(i) + ".txt", content);
+    }
+    source.add_file("other/skipped.txt", std::vector<unsigned char>{1, 2, 3});
+
+    std::mutex progress_mutex;
+    ArchiveProgress last;
+    ArchiveOptions options;
+    options.on_progress = [&](const ArchiveProgress& progress) {
+        std::lock_guard lock(progress_mutex);
+        last = progress;
+    };
+    ASSERT_TRUE(app.CreateArchive({"archive-source", "site"}, {"archive-out", "site.zip"}, options));
+    EXPECT_EQ(last.files_done, 40u);
+    EXPECT_EQ(last.bytes_done, last.total_bytes);
+
+    ASSERT_TRUE(app.ExtractArchive({"archive-out", "site.zip"}, {"archive-copy", "copy"}));
+    auto& copy = app.getCustomVFS("archive-copy");
+    for (int i = 0; i < 40; i++) {
+        const auto original = source.get_file("site/file" + std::to_string(i) + ".txt");
+        const auto extracted = copy.get_file("copy/file" + std::to_string(i) + ".txt");
+        ASSERT_NE(extracted, nullptr) << i;
+        EXPECT_TRUE(std::equal(original->data.begin(), original->data.end(),
+                               extracted->data.begin(), extracted->data.end())) << i;
+    }
+    EXPECT_EQ(copy.get_file("copy/skipped.txt"), nullptr);
+    EXPECT_FALSE(app.ExtractArchive({"", "does-not-exist.zip"}, {"archive-copy", "missing"}));
+}
+
 // Test utility functions
 TEST_F(MembraneTest, UtilityFunctions) {
     // Test file saving
     std::string test_path = test_dir + "/test_save.txt";
     std::string test_content = "Test content for saving";
     
-    Membrane::saveFile(test_path, test_content);
+    saveFile(test_path, test_content);
     EXPECT_TRUE(file_exists(test_path));
     EXPECT_EQ(read_file_content(test_path), test_content);
 }
 
+// Every base64 kernel matches the scalar one, across the vector block
+// sizes and past the first invalid character
+TEST_F(MembraneTest, Base64KernelsAgree) {
+    EXPECT_EQ(base64Encode(reinterpret_cast<const uint8_t*>("Membrane"), 8), "TWVtYnJhbmU=");
+    const std::vector<uint8_t> expected = {'M', 'e', 'm', 'b', 'r', 'a', 'n', 'e'};
+    EXPECT_EQ(base64Decode(std::string("TWVtYnJhbmU=")), expected);
+    // a trailing group of n characters gives n - 1 bytes
+    EXPECT_EQ(base64Decode(std::string("TWVtYnJhbm")).size(), 7);
+    EXPECT_THROW(base64Encode(nullptr, 0, static_cast<Base64Kernel>(99)), std::invalid_argument);
+
+    std::mt19937 random(7);
+    std::vector<uint8_t> data(1 << 16);
+    for (auto &byte : data) byte = static_cast<uint8_t>(random());
+    for (const size_t size : {size_t{0}, size_t{1}, size_t{2}, size_t{3}, size_t{47},
+                              size_t{48}, size_t{100}, size_t{1000}, data.size()}) {
+        const std::string scalar = base64Encode(data.data(), size, Base64Kernel::Scalar);
+        std::string broken = scalar;
+        if (!broken.empty()) broken[broken.size() / 2] = '*';
+        for (const Base64Kernel kernel : supportedBase64Kernels()) {
+            SCOPED_TRACE(static_cast<int>(kernel));
+            EXPECT_EQ(base64Encode(data.data(), size, kernel), scalar);
+            EXPECT_EQ(base64Decode(scalar, kernel),
+                      std::vector<uint8_t>(data.begin(), data.begin() + size));
+            EXPECT_EQ(base64Decode(broken, kernel),
+                      base64Decode(broken, Base64Kernel::Scalar));
+        }
+    }
+}
+
 // Test app data directory function
 TEST_F(MembraneTest, AppDataDirectory) {
     std::string app_name = "MembraneTestApp";
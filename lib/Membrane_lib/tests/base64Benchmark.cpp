@@ -0,0 +1,165 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "MembraneUtils.hpp"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+
+// Throughput of every base64 kernel this CPU supports, next to the code
+// they replaced, for inputs from 1 KB to 100 MB.
+
+namespace {
+// the original implementation, kept as the baseline
+namespace legacy {
+const std::string base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                 "abcdefghijklmnopqrstuvwxyz"
+                                 "0123456789+/";
+
+std::string base64Encode(const uint8_t *data, size_t length) {
+    std::string encoded;
+    int i = 0;
+    uint8_t char_array_3[3];
+    uint8_t char_array_4[4];
+    while (length--) {
+        char_array_3[i++] = *(data++);
+        if (i == 3) {
+            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) +
+                              ((char_array_3[1] & 0xf0) >> 4);
+            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) +
+                              ((char_array_3[2] & 0xc0) >> 6);
+            char_array_4[3] = char_array_3[2] & 0x3f;
+            for (i = 0; i < 4; i++) encoded += base64_chars[char_array_4[i]];
+            i = 0;
+        }
+    }
+    if (i) {
+        for (int j = i; j < 3; j++) char_array_3[j] = '\0';
+        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) +
+                          ((char_array_3[1] & 0xf0) >> 4);
+        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) +
+                          ((char_array_3[2] & 0xc0) >> 6);
+        for (int j = 0; j < i + 1; j++) {
+            encoded += base64_chars[char_array_4[j]];
+        }
+        while (i++ < 3) encoded += '=';
+    }
+    return encoded;
+}
+
+std::vector<uint8_t> base64Decode(const std::string &encoded) {
+    int in_len = encoded.size();
+    int i = 0;
+    int in_ = 0;
+    uint8_t char_array_4[4], char_array_3[3];
+    std::vector<uint8_t> decoded;
+    while (in_len-- && (encoded[in_] != '=') &&
+           (isalnum(encoded[in_]) || (encoded[in_] == '+') ||
+            (encoded[in_] == '/'))) {
+        char_array_4[i++] = encoded[in_];
+        in_++;
+        if (i == 4) {
+            for (i = 0; i < 4; i++) {
+                char_array_4[i] = base64_chars.find(char_array_4[i]);
+            }
+            char_array_3[0] =
+                (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) +
+                              ((char_array_4[2] & 0x3c) >> 2);
+            char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+            for (i = 0; i < 3; i++) decoded.push_back(char_array_3[i]);
+            i = 0;
+        }
+    }
+    if (i) {
+        for (int j = i; j < 4; j++) char_array_4[j] = 0;
+        for (int j = 0; j < 4; j++) {
+            char_array_4[j] = base64_chars.find(char_array_4[j]);
+        }
+        char_array_3[0] =
+            (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+        char_array_3[1] =
+            ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+        for (int j = 0; j < i - 1; j++) decoded.push_back(char_array_3[j]);
+    }
+    return decoded;
+}
+}  // namespace legacy
+
+const char *name_of(const Base64Kernel kernel) {
+    switch (kernel) {
+        case Base64Kernel::Scalar:
+            return "scalar";
+        case Base64Kernel::SSSE3:
+            return "ssse3";
+        case Base64Kernel::AVX2:
+            return "avx2";
+        case Base64Kernel::NEON:
+            return "neon";
+    }
+    return "?";
+}
+
+// MB/s of the input of run, repeated over about 256 MB
+double throughput(const size_t size, const std::function<size_t()> &run) {
+    const size_t rounds = std::max<size_t>(1, (256u << 20) / size);
+    size_t sink = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; ++i) sink += run();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    // keeps the calls from being optimized away
+    if (sink == 0) std::puts("");
+    return static_cast<double>(size) * rounds / elapsed.count() / 1e6;
+}
+}  // namespace
+
+int main() {
+    std::mt19937 random(42);
+    std::printf("%-10s %-8s %14s %14s\n", "size", "kernel", "encode MB/s",
+                "decode MB/s");
+    for (const size_t size :
+         {size_t{1} << 10, size_t{64} << 10, size_t{1} << 20,
+          size_t{16} << 20, size_t{100} << 20}) {
+        std::vector<uint8_t> data(size);
+        for (auto &byte : data) byte = static_cast<uint8_t>(random());
+        const std::string encoded = base64Encode(data.data(), data.size());
+        const std::string label = size >= (1u << 20)
+                                      ? std::to_string(size >> 20) + " MB"
+                                      : std::to_string(size >> 10) + " KB";
+
+        std::printf("%-10s %-8s %14.0f %14.0f\n", label.c_str(), "legacy",
+                    throughput(size,
+                               [&] {
+                                   return legacy::base64Encode(data.data(),
+                                                               data.size())
+                                       .size();
+                               }),
+                    throughput(size, [&] {
+                        return legacy::base64Decode(encoded).size();
+                    }));
+        for (const Base64Kernel kernel : supportedBase64Kernels()) {
+            if (base64Decode(encoded, kernel) != data) {
+                std::fprintf(stderr, "%s does not round-trip\n",
+                             name_of(kernel));
+                return 1;
+            }
+            std::printf(
+                "%-10s %-8s %14.0f %14.0f\n", label.c_str(), name_of(kernel),
+                throughput(size,
+                           [&] {
+                               return base64Encode(data.data(), data.size(),
+                                                   kernel)
+                                   .size();
+                           }),
+                throughput(size, [&] {
+                    return base64Decode(encoded, kernel).size();
+                }));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,203 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A fixed set of worker threads running queued tasks in FIFO order
+ * @brief parallel_for() spreads a loop over the workers and the calling
+ * thread. The caller takes part and never waits on a queued task, so a
+ * task may itself call parallel_for() on the same pool without
+ * deadlocking. Destroying the pool runs the tasks still queued, then joins
+ * the workers.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t workers) {
+        workers = std::max<size_t>(workers, 1);
+        threads.reserve(workers);
+        for (size_t i = 0; i < workers; ++i) {
+            threads.emplace_back([this] { work(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &thread : threads) thread.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    [[nodiscard]] size_t size() const {
+        return threads.size();
+    }
+
+    // queues task; the future holds its result or the exception it threw
+    template <typename Task>
+    auto submit(Task &&task) -> std::future<std::invoke_result_t<Task>> {
+        using Result = std::invoke_result_t<Task>;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(
+            std::forward<Task>(task));
+        std::future<Result> result = packaged->get_future();
+        {
+            std::lock_guard lock(mutex);
+            queue.emplace_back([packaged] { (*packaged)(); });
+        }
+        wake.notify_one();
+        return result;
+    }
+
+    // calls body(i) for every i in [0, count), at most size() at a time,
+    // and returns once all calls are done. The first exception thrown by
+    // a call is rethrown here; the remaining indices still run.
+    template <typename Body>
+    void parallel_for(const size_t count, Body &&body) {
+        if (count == 0) return;
+        // helpers that start after the caller claimed the last index leave
+        // without touching body, so the caller never waits on a queued task
+        struct Loop {
+            std::atomic<size_t> next{0};
+            std::mutex mutex;
+            std::condition_variable idle;
+            size_t active = 0;
+            std::exception_ptr error;
+        };
+        const auto loop = std::make_shared<Loop>();
+        auto *const target = &body;
+        const auto drain = [count, target](Loop &state) {
+            for (size_t i = state.next++; i < count; i = state.next++) {
+                try {
+                    (*target)(i);
+                } catch (...) {
+                    std::lock_guard lock(state.mutex);
+                    if (!state.error) state.error = std::current_exception();
+                }
+            }
+        };
+        // the caller is one of the threads working on the loop
+        const size_t helpers = std::min(size(), count) - 1;
+        for (size_t i = 0; i < helpers; ++i) {
+            (void)submit([loop, drain, count] {
+                {
+                    std::lock_guard lock(loop->mutex);
+                    if (loop->next >= count) return;
+                    ++loop->active;
+                }
+                drain(*loop);
+                std::lock_guard lock(loop->mutex);
+                if (--loop->active == 0) loop->idle.notify_all();
+            });
+        }
+        drain(*loop);
+        std::unique_lock lock(loop->mutex);
+        loop->idle.wait(lock, [&loop] { return loop->active == 0; });
+        if (loop->error) std::rethrow_exception(loop->error);
+    }
+
+private:
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> queue;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void work() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(mutex);
+                wake.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;
+                task = std::move(queue.front());
+                queue.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+/**
+ * @brief Runs tasks on a ThreadPool, at most a given number at a time
+ * @brief Tasks over the limit wait here in FIFO order instead of in the
+ * pool's queue, so they never hold a worker. A limit of 0 only bounds
+ * them by the pool's size. The limiter may be destroyed with tasks still
+ * waiting; they run anyway.
+ */
+class ConcurrencyLimiter {
+public:
+    ConcurrencyLimiter(ThreadPool &pool, const size_t limit)
+        : state(std::make_shared<State>(pool, limit)) {
+    }
+
+    // runs task on the pool now, or once a running task finishes;
+    // exceptions thrown by task are dropped
+    void post(std::function<void()> task) {
+        {
+            std::lock_guard lock(state->mutex);
+            if (state->limit != 0 && state->running >= state->limit) {
+                state->waiting.push_back(std::move(task));
+                return;
+            }
+            ++state->running;
+        }
+        start(state, std::move(task));
+    }
+
+private:
+    struct State {
+        State(ThreadPool &pool, const size_t limit)
+            : pool(pool), limit(limit) {
+        }
+        ThreadPool &pool;
+        const size_t limit;
+        std::mutex mutex;
+        std::deque<std::function<void()>> waiting;
+        size_t running = 0;
+    };
+    std::shared_ptr<State> state;
+
+    static void start(const std::shared_ptr<State> &state,
+                      std::function<void()> task) {
+        (void)state->pool.submit([state, task = std::move(task)] {
+            try {
+                task();
+            } catch (...) {
+            }
+            // the next task goes to the back of the pool's queue, so a
+            // busy limiter does not starve other work
+            std::function<void()> next;
+            {
+                std::lock_guard lock(state->mutex);
+                if (state->waiting.empty()) {
+                    --state->running;
+                    return;
+                }
+                next = std::move(state->waiting.front());
+                state->waiting.pop_front();
+            }
+            start(state, std::move(next));
+        });
+    }
+};
+#endif  // THREADPOOL_HPP
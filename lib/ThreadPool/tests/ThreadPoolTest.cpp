@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include "ThreadPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(ThreadPoolTest, SubmitReturnsResults) {
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4u);
+
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 100; i++) {
+        results.push_back(pool.submit([i] { return i * i; }));
+    }
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(results[i].get(), i * i);
+    }
+}
+
+TEST(ThreadPoolTest, SubmitPropagatesExceptions) {
+    ThreadPool pool(2);
+    auto result = pool.submit([]() -> int { throw std::runtime_error("boom"); });
+    EXPECT_THROW(result.get(), std::runtime_error);
+    // the worker survives the exception
+    EXPECT_EQ(pool.submit([] { return 7; }).get(), 7);
+}
+
+TEST(ThreadPoolTest, ParallelForVisitsEveryIndexOnce) {
+    ThreadPool pool(8);
+    std::vector<std::atomic<int>> visits(10000);
+    pool.parallel_for(visits.size(), [&](size_t i) { visits[i]++; });
+    for (const auto& count : visits) {
+        EXPECT_EQ(count, 1);
+    }
+    pool.parallel_for(0, [](size_t) { FAIL(); });
+}
+
+TEST(ThreadPoolTest, ParallelForRunsConcurrently) {
+    ThreadPool pool(4);
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    pool.parallel_for(16, [&](size_t) {
+        const int now = ++running;
+        for (int seen = peak; now > seen && !peak.compare_exchange_weak(seen, now);) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        --running;
+    });
+    EXPECT_GT(peak, 1);
+    EXPECT_LE(peak, 4);
+}
+
+TEST(ThreadPoolTest, ParallelForFinishesAllIndicesAndRethrows) {
+    ThreadPool pool(4);
+    std::atomic<int> visited{0};
+    EXPECT_THROW(pool.parallel_for(1000,
+                                   [&](size_t i) {
+                                       visited++;
+                                       if (i % 100 == 0) throw std::runtime_error("bad index");
+                                   }),
+                 std::runtime_error);
+    EXPECT_EQ(visited, 1000);
+}
+
+TEST(ThreadPoolTest, NestedParallelForDoesNotDeadlock) {
+    ThreadPool pool(2);
+    std::atomic<int> total{0};
+    pool.parallel_for(8, [&](size_t) {
+        pool.parallel_for(8, [&](size_t) { total++; });
+    });
+    EXPECT_EQ(total, 64);
+}
+
+TEST(ThreadPoolTest, DestructorRunsQueuedTasks) {
+    std::atomic<int> done{0};
+    {
+        ThreadPool pool(1);
+        for (int i = 0; i < 50; i++) {
+            (void)pool.submit([&] { done++; });
+        }
+    }
+    EXPECT_EQ(done, 50);
+}
+
+TEST(ThreadPoolTest, ConcurrencyLimiterBoundsRunningTasks) {
+    ThreadPool pool(8);
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    std::atomic<int> done{0};
+    {
+        ConcurrencyLimiter limiter(pool, 2);
+        for (int i = 0; i < 20; i++) {
+            limiter.post([&] {
+                const int now = ++running;
+                int seen = peak;
+                while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                --running;
+                done++;
+                if (done % 5 == 0) throw std::runtime_error("dropped");
+            });
+        }
+        // the waiting tasks outlive the limiter
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (done < 20 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(done, 20);
+    EXPECT_EQ(peak, 2);
+    // the pool itself is free for other work
+    EXPECT_EQ(pool.submit([] { return 3; }).get(), 3);
+}
@@ -0,0 +1,85 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#ifndef BUFFER_HPP
+#define BUFFER_HPP
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Immutable byte range used as the contents of a VFS entry
+ * @brief The bytes either belong to a shared owner (a heap vector, a mapped
+ * file...) that stays alive as long as any copy of the buffer, or are
+ * borrowed from memory that outlives the program's use of it, such as
+ * compiled-in resource arrays. Copies never duplicate the bytes.
+ */
+class Buffer {
+public:
+    using value_type = unsigned char;
+    using const_iterator = const unsigned char *;
+
+    Buffer() = default;
+    // takes over the vector's storage; implicit so entries can still be
+    // filled from a vector
+    Buffer(std::vector<unsigned char> bytes) {
+        if (bytes.empty()) return;
+        auto storage =
+            std::make_shared<const std::vector<unsigned char>>(std::move(bytes));
+        bytes_ = storage->data();
+        size_ = storage->size();
+        owner_ = std::move(storage);
+    }
+    // view of bytes kept alive by owner
+    Buffer(const unsigned char *data, const size_t size,
+           std::shared_ptr<const void> owner)
+        : bytes_(data), size_(size), owner_(std::move(owner)) {}
+
+    // view of bytes that must stay valid for the lifetime of every copy,
+    // e.g. static arrays in .rodata; nothing is allocated or copied
+    static Buffer borrow(const unsigned char *data, const size_t size) {
+        return {data, size, nullptr};
+    }
+
+    [[nodiscard]] const unsigned char *data() const {
+        return bytes_;
+    }
+    [[nodiscard]] size_t size() const {
+        return size_;
+    }
+    [[nodiscard]] bool empty() const {
+        return size_ == 0;
+    }
+    [[nodiscard]] const_iterator begin() const {
+        return bytes_;
+    }
+    [[nodiscard]] const_iterator end() const {
+        return bytes_ + size_;
+    }
+    [[nodiscard]] unsigned char front() const {
+        return bytes_[0];
+    }
+    [[nodiscard]] unsigned char operator[](const size_t i) const {
+        return bytes_[i];
+    }
+    [[nodiscard]] std::span<const unsigned char> span() const {
+        return {bytes_, size_};
+    }
+    // view of length bytes from offset, sharing the same owner
+    [[nodiscard]] Buffer slice(const size_t offset, const size_t length) const {
+        return {bytes_ + offset, length, owner_};
+    }
+    // false for borrowed bytes
+    [[nodiscard]] bool is_owned() const {
+        return owner_ != nullptr;
+    }
+
+private:
+    const unsigned char *bytes_ = nullptr;
+    size_t size_ = 0;
+    std::shared_ptr<const void> owner_;
+};
+#endif  // BUFFER_HPP
@@ -0,0 +1,103 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "ContentStore.hpp"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+struct Blob {
+    Buffer data;
+    uint64_t hash;
+    // interned buffers referring to this blob, guarded by State::mutex
+    size_t refs = 0;
+};
+
+uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+}  // namespace
+
+// Shared with the release callbacks of the buffers handed out, so a buffer
+// may outlive the store that interned it.
+struct ContentStore::State {
+    std::mutex mutex;
+    std::unordered_map<uint64_t, std::vector<Blob *>> blobs;
+    Stats stats;
+
+    void release(Blob *blob) {
+        std::lock_guard lock(mutex);
+        stats.references--;
+        stats.referenced_bytes -= blob->data.size();
+        if (--blob->refs > 0) return;
+        auto &candidates = blobs[blob->hash];
+        std::erase(candidates, blob);
+        if (candidates.empty()) blobs.erase(blob->hash);
+        stats.blobs--;
+        stats.stored_bytes -= blob->data.size();
+        delete blob;
+    }
+};
+
+ContentStore::ContentStore() : state(std::make_shared<State>()) {}
+
+uint64_t ContentStore::hash(const unsigned char *data, const size_t len) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = mix(h ^ word) + 0x9E3779B97F4A7C15ull;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, len - i);
+    return mix(h ^ tail);
+}
+
+Buffer ContentStore::intern(Buffer data) {
+    if (data.empty()) return data;
+    const uint64_t content_hash = hash(data.data(), data.size());
+    Blob *blob = nullptr;
+    {
+        std::lock_guard lock(state->mutex);
+        auto &candidates = state->blobs[content_hash];
+        for (Blob *candidate : candidates) {
+            if (candidate->data.size() == data.size() &&
+                std::memcmp(candidate->data.data(), data.data(),
+                            data.size()) == 0) {
+                blob = candidate;
+                break;
+            }
+        }
+        if (blob == nullptr) {
+            blob = new Blob{std::move(data), content_hash};
+            candidates.push_back(blob);
+            state->stats.blobs++;
+            state->stats.stored_bytes += blob->data.size();
+        }
+        blob->refs++;
+        state->stats.references++;
+        state->stats.referenced_bytes += blob->data.size();
+    }
+    // each interned buffer counts as one reference, however often it is
+    // copied afterwards
+    std::shared_ptr<const void> reference(
+        blob, [state = state](const void *released) {
+            state->release(static_cast<Blob *>(const_cast<void *>(released)));
+        });
+    return {blob->data.data(), blob->data.size(), std::move(reference)};
+}
+
+ContentStore::Stats ContentStore::stats() const {
+    std::lock_guard lock(state->mutex);
+    return state->stats;
+}
@@ -0,0 +1,47 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#ifndef CONTENT_STORE_HPP
+#define CONTENT_STORE_HPP
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "Buffer.hpp"
+
+/**
+ * @brief Content-addressed, reference-counted storage for entry contents
+ * @brief Buffers with identical bytes are interned to one copy, shared by
+ * every VirtualFileSystem attached to the store. A copy is released when
+ * the last entry referring to it goes away.
+ */
+class ContentStore {
+public:
+    struct Stats {
+        // distinct contents held, and their total size
+        uint64_t blobs = 0;
+        uint64_t stored_bytes = 0;
+        // interned buffers alive, and the size they would take undeduplicated
+        uint64_t references = 0;
+        uint64_t referenced_bytes = 0;
+
+        [[nodiscard]] uint64_t saved_bytes() const {
+            return referenced_bytes - stored_bytes;
+        }
+    };
+
+    ContentStore();
+
+    // returns a buffer over the stored copy of data's bytes, adding data as
+    // that copy if no identical content is stored yet
+    [[nodiscard]] Buffer intern(Buffer data);
+    [[nodiscard]] Stats stats() const;
+
+    // 64-bit content hash; equal hashes still need a byte comparison
+    static uint64_t hash(const unsigned char *data, size_t len);
+
+private:
+    struct State;
+    std::shared_ptr<State> state;
+};
+#endif  // CONTENT_STORE_HPP
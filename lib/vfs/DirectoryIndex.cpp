@@ -0,0 +1,185 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "DirectoryIndex.hpp"
+#include <atomic>
+#include <ranges>
+#include <utility>
+
+namespace {
+// splits "a/b/c" into the directory part "a/b" and the name "c"
+std::pair<std::string_view, std::string_view> split_last(
+    const std::string_view path) {
+    const size_t slash = path.rfind('/');
+    if (slash == std::string_view::npos) return {{}, path};
+    return {path.substr(0, slash), path.substr(slash + 1)};
+}
+
+// calls visit(component) for each '/'-separated part of dir
+template <typename Visit>
+bool for_each_component(std::string_view dir, Visit &&visit) {
+    if (dir.empty()) return true;
+    while (true) {
+        const size_t slash = dir.find('/');
+        if (!visit(dir.substr(0, slash))) return false;
+        if (slash == std::string_view::npos) return true;
+        dir.remove_prefix(slash + 1);
+    }
+}
+
+// "dir/" and "dir" name the same directory
+std::string_view trim_dir(std::string_view dir) {
+    if (dir.ends_with('/')) dir.remove_suffix(1);
+    return dir;
+}
+}  // namespace
+
+DirectoryIndex::Node &DirectoryIndex::own(std::shared_ptr<Node> &link) {
+    if (link.use_count() != 1) {
+        link = std::make_shared<Node>(*link);
+    } else {
+        // pairs with the release done by the copy that let go of it
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *link;
+}
+
+void DirectoryIndex::insert(const std::string_view path, const uint64_t size) {
+    const auto [dir, name] = split_last(path);
+    std::vector<Node *> chain{&own(root)};
+    for_each_component(dir, [&chain](const std::string_view component) {
+        auto &children = chain.back()->dirs;
+        auto child = children.find(component);
+        if (child == children.end()) {
+            child = children
+                        .emplace(std::string(component),
+                                 std::make_shared<Node>())
+                        .first;
+        }
+        chain.push_back(&own(child->second));
+        return true;
+    });
+    auto &files = chain.back()->files;
+    uint64_t previous = 0;
+    bool added = false;
+    if (auto file = files.find(name); file != files.end()) {
+        previous = file->second;
+        file->second = size;
+    } else {
+        files.emplace(std::string(name), size);
+        added = true;
+    }
+    for (Node *node : chain) {
+        node->size = node->size - previous + size;
+        if (added) node->file_count++;
+    }
+}
+
+void DirectoryIndex::erase(const std::string_view path) {
+    const auto [dir, name] = split_last(path);
+    // a miss must not copy shared directories
+    const Node *containing = root.get();
+    const bool found = for_each_component(
+        dir, [&containing](const std::string_view component) {
+            const auto child = containing->dirs.find(component);
+            if (child == containing->dirs.end()) return false;
+            containing = child->second.get();
+            return true;
+        });
+    if (!found || !containing->files.contains(name)) return;
+    std::vector<Node *> chain{&own(root)};
+    for_each_component(dir, [&chain](const std::string_view component) {
+        chain.push_back(&own(chain.back()->dirs.find(component)->second));
+        return true;
+    });
+    auto &files = chain.back()->files;
+    const auto file = files.find(name);
+    const uint64_t size = file->second;
+    files.erase(file);
+    for (Node *node : chain) {
+        node->size -= size;
+        node->file_count--;
+    }
+    // prune the directories this left empty, deepest first
+    std::string_view remaining = dir;
+    for (size_t depth = chain.size() - 1; depth > 0; --depth) {
+        if (chain[depth]->file_count != 0) break;
+        const auto [parent, component] = split_last(remaining);
+        chain[depth - 1]->dirs.erase(chain[depth - 1]->dirs.find(component));
+        remaining = parent;
+    }
+}
+
+void DirectoryIndex::clear() {
+    root = std::make_shared<Node>();
+}
+
+const DirectoryIndex::Node *DirectoryIndex::find_dir(
+    const std::string_view dir) const {
+    const Node *node = root.get();
+    const bool found = for_each_component(
+        trim_dir(dir), [&node](const std::string_view component) {
+            const auto child = node->dirs.find(component);
+            if (child == node->dirs.end()) return false;
+            node = child->second.get();
+            return true;
+        });
+    return found ? node : nullptr;
+}
+
+DirectoryIndex::Stat DirectoryIndex::stat(const std::string_view path) const {
+    if (const Node *node = find_dir(path)) {
+        return {true, true, node->size, node->file_count};
+    }
+    const auto [dir, name] = split_last(path);
+    if (const Node *parent = find_dir(dir)) {
+        if (const auto file = parent->files.find(name);
+            file != parent->files.end()) {
+            return {true, false, file->second, 1};
+        }
+    }
+    return {};
+}
+
+std::vector<DirectoryIndex::Child> DirectoryIndex::list(
+    const std::string_view dir) const {
+    std::vector<Child> children;
+    const Node *node = find_dir(dir);
+    if (node == nullptr) return children;
+    children.reserve(node->dirs.size() + node->files.size());
+    for (const auto &[name, child] : node->dirs) {
+        children.push_back({name, true, child->size, child->file_count});
+    }
+    for (const auto &[name, size] : node->files) {
+        children.push_back({name, false, size, 1});
+    }
+    return children;
+}
+
+std::vector<std::string> DirectoryIndex::files_under(
+    const std::string_view dir) const {
+    std::vector<std::string> paths;
+    const std::string_view trimmed = trim_dir(dir);
+    if (const Node *node = find_dir(trimmed)) {
+        paths.reserve(node->file_count);
+        std::string prefix(trimmed);
+        if (!prefix.empty()) prefix += '/';
+        collect(*node, prefix, paths);
+    }
+    return paths;
+}
+
+void DirectoryIndex::collect(const Node &node, std::string &prefix,
+                             std::vector<std::string> &paths) {
+    for (const auto &name : node.files | std::views::keys) {
+        paths.push_back(prefix + name);
+    }
+    for (const auto &[name, child] : node.dirs) {
+        const size_t length = prefix.size();
+        prefix += name;
+        prefix += '/';
+        collect(*child, prefix, paths);
+        prefix.resize(length);
+    }
+}
@@ -0,0 +1,73 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#ifndef DIRECTORY_INDEX_HPP
+#define DIRECTORY_INDEX_HPP
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Directory trie over a set of slash-separated paths
+ * @brief Each directory keeps its children in name order together with the
+ * total size and number of files below it, so listing a directory costs
+ * its depth plus its children, and a subtree is found without scanning
+ * unrelated paths. Paths are split on '/' exactly as given; directories
+ * exist only while they contain files.
+ * @brief Copies share their directories: copying is O(1), and a write
+ * copies the directories on its path that another copy still uses.
+ */
+class DirectoryIndex {
+public:
+    struct Stat {
+        bool exists = false;
+        bool is_directory = false;
+        // size of the file, or of every file below the directory
+        uint64_t size = 0;
+        // 1 for a file, the files below it for a directory
+        uint64_t file_count = 0;
+    };
+    struct Child {
+        std::string name;
+        bool is_directory = false;
+        // as in Stat
+        uint64_t size = 0;
+        uint64_t file_count = 0;
+    };
+
+    // adds path, or updates its size
+    void insert(std::string_view path, uint64_t size);
+    // removes path; empty directories above it go away with it
+    void erase(std::string_view path);
+    void clear();
+
+    // a path naming both a file and a directory reports the directory
+    [[nodiscard]] Stat stat(std::string_view path) const;
+    // the directories, then the files, directly in dir, each by name; ""
+    // is the root
+    [[nodiscard]] std::vector<Child> list(std::string_view dir) const;
+    // the full path of every file below dir
+    [[nodiscard]] std::vector<std::string> files_under(
+        std::string_view dir) const;
+
+private:
+    struct Node {
+        std::map<std::string, std::shared_ptr<Node>, std::less<>> dirs;
+        std::map<std::string, uint64_t, std::less<>> files;
+        uint64_t size = 0;
+        uint64_t file_count = 0;
+    };
+    std::shared_ptr<Node> root = std::make_shared<Node>();
+
+    [[nodiscard]] const Node *find_dir(std::string_view dir) const;
+    // the node behind link, copied first if another index shares it
+    static Node &own(std::shared_ptr<Node> &link);
+    static void collect(const Node &node, std::string &prefix,
+                        std::vector<std::string> &paths);
+};
+#endif  // DIRECTORY_INDEX_HPP
@@ -0,0 +1,418 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "PackArchive.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <ranges>
+#include <vector>
+#include "ContentStore.hpp"
+
+// Index layout (host byte order):
+//   magic | u64 generation | u64 data_end | u64 garbage | u64 count
+//   count x (u32 path_len | u64 offset | u64 length | path)
+// sorted by path. The data file .membrane.pack.<generation> holds the raw
+// entry contents; records with identical contents share an extent.
+
+namespace {
+constexpr std::string_view PACK_PREFIX = ".membrane.pack.";
+constexpr std::string_view INDEX_NAME = ".membrane.pack.idx";
+constexpr std::array<char, 8> INDEX_MAGIC = {'M', 'V', 'F', 'S',
+                                             'I', 'D', 'X', '1'};
+
+bool pwrite_all(const int fd, const unsigned char *data, size_t len,
+                uint64_t offset) {
+    while (len > 0) {
+        const ssize_t n = ::pwrite(fd, data, len, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+template <typename T>
+void put(std::string &out, const T value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+bool get(const std::vector<char> &in, size_t &pos, T &value) {
+    if (pos + sizeof(value) > in.size()) return false;
+    std::memcpy(&value, in.data() + pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+}
+}  // namespace
+
+struct PackArchive::Mapping {
+    void *address = nullptr;
+    size_t length = 0;
+
+    ~Mapping() {
+        if (address != nullptr) ::munmap(address, length);
+    }
+    [[nodiscard]] const unsigned char *bytes() const {
+        return static_cast<const unsigned char *>(address);
+    }
+};
+
+PackArchive::PackArchive(std::string dir) : dir(std::move(dir)) {}
+
+PackArchive::~PackArchive() {
+    if (data_fd >= 0) ::close(data_fd);
+}
+
+bool PackArchive::exists(const std::string &dir) {
+    return std::filesystem::exists(dir + "/" + std::string(INDEX_NAME));
+}
+
+std::string PackArchive::data_path(const uint64_t gen) const {
+    return dir + "/" + std::string(PACK_PREFIX) + std::to_string(gen);
+}
+
+std::string PackArchive::index_path() const {
+    return dir + "/" + std::string(INDEX_NAME);
+}
+
+bool PackArchive::open() {
+    if (std::filesystem::exists(index_path())) {
+        std::ifstream in(index_path(), std::ios::binary);
+        const std::vector<char> raw((std::istreambuf_iterator<char>(in)),
+                                    std::istreambuf_iterator<char>());
+        size_t pos = INDEX_MAGIC.size();
+        uint64_t count = 0;
+        if (raw.size() < pos ||
+            !std::equal(INDEX_MAGIC.begin(), INDEX_MAGIC.end(), raw.begin()) ||
+            !get(raw, pos, generation) || !get(raw, pos, data_end) ||
+            !get(raw, pos, garbage) || !get(raw, pos, count)) {
+            std::cerr << "Invalid pack index " << index_path() << std::endl;
+            return false;
+        }
+        for (uint64_t i = 0; i < count; i++) {
+            uint32_t path_len;
+            Extent extent{};
+            if (!get(raw, pos, path_len) || !get(raw, pos, extent.offset) ||
+                !get(raw, pos, extent.length) || pos + path_len > raw.size()) {
+                std::cerr << "Truncated pack index " << index_path()
+                          << std::endl;
+                return false;
+            }
+            // every extent is read through the mapping of [0, data_end)
+            if (extent.offset > data_end ||
+                extent.length > data_end - extent.offset) {
+                std::cerr << "Corrupt pack index " << index_path()
+                          << std::endl;
+                return false;
+            }
+            index.emplace_hint(index.end(),
+                               std::string(raw.data() + pos, path_len),
+                               extent);
+            pos += path_len;
+        }
+    }
+    data_fd = ::open(data_path(generation).c_str(), O_RDWR | O_CREAT, 0644);
+    if (data_fd < 0) {
+        std::cerr << "Failed to open pack " << data_path(generation)
+                  << std::endl;
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(data_fd, &st) != 0) {
+        std::cerr << "Failed to stat pack " << data_path(generation)
+                  << std::endl;
+        return false;
+    }
+    // mapping a data file shorter than the index says would fault on read
+    if (static_cast<uint64_t>(st.st_size) < data_end) {
+        std::cerr << "Truncated pack " << data_path(generation) << std::endl;
+        return false;
+    }
+    // bytes past the committed end were appended but never indexed
+    if (static_cast<uint64_t>(st.st_size) > data_end &&
+        ::ftruncate(data_fd, static_cast<off_t>(data_end)) != 0) {
+        std::cerr << "Failed to trim pack " << data_path(generation)
+                  << std::endl;
+    }
+    remove_stale_generations();
+    rebuild_extents();
+    return remap();
+}
+
+void PackArchive::rebuild_extents() {
+    extents.clear();
+    extents_by_hash.clear();
+    hashes_indexed = false;
+    for (const Extent &extent : index | std::views::values) {
+        if (extent.length == 0) continue;
+        ExtentInfo &info = extents[extent.offset];
+        info.length = extent.length;
+        info.refs++;
+    }
+}
+
+// Hashes the extents already in the data file, so appends can match them.
+bool PackArchive::index_hashes() {
+    if (hashes_indexed) return true;
+    if (mapping->length < data_end && !remap()) return false;
+    for (auto &[offset, info] : extents) {
+        info.hash = ContentStore::hash(mapping->bytes() + offset, info.length);
+        info.hashed = true;
+        extents_by_hash.emplace(info.hash, offset);
+    }
+    hashes_indexed = true;
+    return true;
+}
+
+std::optional<uint64_t> PackArchive::find_extent(const unsigned char *data,
+                                                 const size_t len,
+                                                 const uint64_t hash) {
+    const auto [first, last] = extents_by_hash.equal_range(hash);
+    for (auto it = first; it != last; ++it) {
+        const uint64_t offset = it->second;
+        if (extents.at(offset).length != len) continue;
+        if (offset + len > mapping->length && !remap()) return std::nullopt;
+        if (std::memcmp(mapping->bytes() + offset, data, len) == 0) {
+            return offset;
+        }
+    }
+    return std::nullopt;
+}
+
+void PackArchive::release(const Extent &extent) {
+    if (extent.length == 0) return;
+    const auto it = extents.find(extent.offset);
+    if (it == extents.end() || --it->second.refs > 0) return;
+    garbage += extent.length;
+    if (it->second.hashed) {
+        const auto [first, last] = extents_by_hash.equal_range(it->second.hash);
+        for (auto entry = first; entry != last; ++entry) {
+            if (entry->second == extent.offset) {
+                extents_by_hash.erase(entry);
+                break;
+            }
+        }
+    }
+    extents.erase(it);
+}
+
+bool PackArchive::remap() {
+    auto next = std::make_shared<Mapping>();
+    if (data_end > 0) {
+        void *address = ::mmap(nullptr, data_end, PROT_READ, MAP_SHARED,
+                               data_fd, 0);
+        if (address == MAP_FAILED) {
+            std::cerr << "Failed to map pack " << data_path(generation)
+                      << std::endl;
+            return false;
+        }
+        next->address = address;
+        next->length = data_end;
+    }
+    mapping = std::move(next);
+    return true;
+}
+
+std::optional<std::span<const unsigned char>> PackArchive::find(
+    const std::string &path) {
+    const auto it = index.find(path);
+    if (it == index.end()) return std::nullopt;
+    const Extent &extent = it->second;
+    if (extent.offset + extent.length > mapping->length && !remap()) {
+        return std::nullopt;
+    }
+    return std::span(mapping->bytes() + extent.offset, extent.length);
+}
+
+void PackArchive::for_each(
+    const std::function<void(const std::string &,
+                             std::span<const unsigned char>,
+                             const std::shared_ptr<const void> &)> &callback) {
+    if (mapping->length < data_end && !remap()) return;
+    const std::shared_ptr<const void> owner = mapping;
+    for (const auto &[path, extent] : index) {
+        callback(path,
+                 std::span(mapping->bytes() + extent.offset, extent.length),
+                 owner);
+    }
+}
+
+bool PackArchive::append(const std::string &path, const unsigned char *data,
+                         const size_t len) {
+    Extent extent{data_end, len};
+    if (len > 0) {
+        const uint64_t hash = ContentStore::hash(data, len);
+        std::optional<uint64_t> existing;
+        if (index_hashes()) {
+            existing = find_extent(data, len, hash);
+        }
+        if (existing) {
+            extent.offset = *existing;
+            extents[*existing].refs++;
+            deduplicated += len;
+        } else {
+            if (!pwrite_all(data_fd, data, len, data_end)) {
+                std::cerr << "Failed to append " << path << " to pack: "
+                          << strerror(errno) << std::endl;
+                return false;
+            }
+            data_end += len;
+            extents[extent.offset] = {len, 1, hash, hashes_indexed};
+            if (hashes_indexed) extents_by_hash.emplace(hash, extent.offset);
+        }
+    }
+    if (const auto [it, inserted] = index.try_emplace(path, extent);
+        !inserted) {
+        release(it->second);
+        it->second = extent;
+    }
+    return true;
+}
+
+bool PackArchive::remove(const std::string &path) {
+    const auto it = index.find(path);
+    if (it == index.end()) return false;
+    release(it->second);
+    index.erase(it);
+    return true;
+}
+
+bool PackArchive::commit(const bool durable) {
+    if (durable && ::fdatasync(data_fd) != 0) {
+        std::cerr << "Failed to sync pack " << data_path(generation)
+                  << std::endl;
+        return false;
+    }
+    return write_index(durable);
+}
+
+bool PackArchive::write_index(const bool durable) {
+    std::string out(INDEX_MAGIC.begin(), INDEX_MAGIC.end());
+    put(out, generation);
+    put(out, data_end);
+    put(out, garbage);
+    put(out, static_cast<uint64_t>(index.size()));
+    for (const auto &[path, extent] : index) {
+        put(out, static_cast<uint32_t>(path.size()));
+        put(out, extent.offset);
+        put(out, extent.length);
+        out += path;
+    }
+
+    const std::string temp_path = index_path() + ".tmp";
+    const int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                          0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << temp_path << std::endl;
+        return false;
+    }
+    const bool ok =
+        pwrite_all(fd, reinterpret_cast<const unsigned char *>(out.data()),
+                   out.size(), 0) &&
+        (!durable || ::fsync(fd) == 0);
+    ::close(fd);
+    if (!ok || ::rename(temp_path.c_str(), index_path().c_str()) != 0) {
+        std::cerr << "Failed to write pack index " << index_path()
+                  << std::endl;
+        ::unlink(temp_path.c_str());
+        return false;
+    }
+    if (durable) {
+        if (const int dir_fd = ::open(dir.c_str(), O_RDONLY); dir_fd >= 0) {
+            ::fsync(dir_fd);
+            ::close(dir_fd);
+        }
+    }
+    return true;
+}
+
+bool PackArchive::compact() {
+    if (mapping->length < data_end && !remap()) return false;
+    const uint64_t next_generation = generation + 1;
+    const int next_fd = ::open(data_path(next_generation).c_str(),
+                               O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (next_fd < 0) {
+        std::cerr << "Failed to open pack " << data_path(next_generation)
+                  << std::endl;
+        return false;
+    }
+    std::map<std::string, Extent, std::less<>> next_index;
+    // shared extents are copied once
+    std::unordered_map<uint64_t, uint64_t> moved;
+    uint64_t offset = 0;
+    for (const auto &[path, extent] : index) {
+        if (extent.length == 0) {
+            next_index.emplace_hint(next_index.end(), path, Extent{0, 0});
+            continue;
+        }
+        const auto [it, first_use] = moved.try_emplace(extent.offset, offset);
+        if (first_use) {
+            if (!pwrite_all(next_fd, mapping->bytes() + extent.offset,
+                            extent.length, offset)) {
+                ::close(next_fd);
+                ::unlink(data_path(next_generation).c_str());
+                return false;
+            }
+            offset += extent.length;
+        }
+        next_index.emplace_hint(next_index.end(), path,
+                                Extent{it->second, extent.length});
+    }
+    if (::fdatasync(next_fd) != 0) {
+        ::close(next_fd);
+        ::unlink(data_path(next_generation).c_str());
+        return false;
+    }
+
+    const uint64_t previous_generation = generation;
+    const int previous_fd = data_fd;
+    auto previous_index = std::move(index);
+    const uint64_t previous_end = data_end;
+    const uint64_t previous_garbage = garbage;
+    generation = next_generation;
+    index = std::move(next_index);
+    data_end = offset;
+    garbage = 0;
+    data_fd = next_fd;
+    if (!write_index(true)) {
+        generation = previous_generation;
+        index = std::move(previous_index);
+        data_end = previous_end;
+        garbage = previous_garbage;
+        data_fd = previous_fd;
+        ::close(next_fd);
+        ::unlink(data_path(next_generation).c_str());
+        return false;
+    }
+    // mappings of the previous generation stay valid for their holders
+    ::close(previous_fd);
+    ::unlink(data_path(previous_generation).c_str());
+    rebuild_extents();
+    return remap();
+}
+
+void PackArchive::remove_stale_generations() const {
+    std::error_code ec;
+    const std::string current =
+        std::filesystem::path(data_path(generation)).filename().string();
+    for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.starts_with(PACK_PREFIX) && name != INDEX_NAME &&
+            name != current && !name.ends_with(".tmp")) {
+            std::filesystem::remove(entry.path(), ec);
+        }
+    }
+}
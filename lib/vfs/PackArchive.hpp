@@ -0,0 +1,110 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#ifndef PACK_ARCHIVE_HPP
+#define PACK_ARCHIVE_HPP
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief Single-file storage for a persistent VirtualFileSystem
+ * @brief Entry contents are appended back to back to one data file and
+ * located through a sorted index file; the index is the commit point, so a
+ * crash before commit() only leaves unreferenced bytes behind
+ * @brief Entries with identical contents share one extent of the data file.
+ * Contents no entry refers to any more are garbage until compact()
+ * rewrites the live extents under a new generation
+ */
+class PackArchive {
+public:
+    struct Extent {
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    explicit PackArchive(std::string dir);
+    ~PackArchive();
+    PackArchive(const PackArchive &) = delete;
+    PackArchive &operator=(const PackArchive &) = delete;
+
+    // true if dir holds a committed pack index
+    static bool exists(const std::string &dir);
+
+    // reads the index and maps the data file, creating an empty archive if
+    // there is none yet
+    [[nodiscard]] bool open();
+    [[nodiscard]] std::optional<std::span<const unsigned char>> find(
+        const std::string &path);
+    // calls callback with each entry's bytes in the mapped data file and
+    // the owner that keeps the mapping alive, even past compact() or the
+    // archive's destruction
+    void for_each(const std::function<
+                  void(const std::string &, std::span<const unsigned char>,
+                       const std::shared_ptr<const void> &owner)> &callback);
+
+    // appends to the end of the data file, or points path at an extent
+    // already holding the same bytes; visible to find() at once, on disk
+    // after the next commit()
+    bool append(const std::string &path, const unsigned char *data,
+                size_t len);
+    bool remove(const std::string &path);
+    bool commit(bool durable);
+    // rewrites the data file with only the live entries
+    bool compact();
+
+    [[nodiscard]] size_t size() const {
+        return index.size();
+    }
+    [[nodiscard]] uint64_t live_bytes() const {
+        return data_end - garbage;
+    }
+    [[nodiscard]] uint64_t garbage_bytes() const {
+        return garbage;
+    }
+    // bytes not written because an identical extent was reused
+    [[nodiscard]] uint64_t deduplicated_bytes() const {
+        return deduplicated;
+    }
+
+private:
+    struct Mapping;
+    struct ExtentInfo {
+        uint64_t length = 0;
+        uint32_t refs = 0;
+        uint64_t hash = 0;
+        bool hashed = false;
+    };
+
+    std::string dir;
+    std::map<std::string, Extent, std::less<>> index;
+    uint64_t generation = 1;
+    uint64_t data_end = 0;
+    uint64_t garbage = 0;
+    int data_fd = -1;
+    std::shared_ptr<const Mapping> mapping;
+    // non-empty live extents by offset, with the number of paths using them
+    std::unordered_map<uint64_t, ExtentInfo> extents;
+    // content hash to extent offset, built by the first append
+    std::unordered_multimap<uint64_t, uint64_t> extents_by_hash;
+    bool hashes_indexed = false;
+    uint64_t deduplicated = 0;
+
+    [[nodiscard]] std::string data_path(uint64_t gen) const;
+    [[nodiscard]] std::string index_path() const;
+    bool remap();
+    void rebuild_extents();
+    bool index_hashes();
+    [[nodiscard]] std::optional<uint64_t> find_extent(
+        const unsigned char *data, size_t len, uint64_t hash);
+    void release(const Extent &extent);
+    bool write_index(bool durable);
+    void remove_stale_generations() const;
+};
+#endif  // PACK_ARCHIVE_HPP
@@ -0,0 +1,119 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#ifndef RESOURCE_PACK_HPP
+#define RESOURCE_PACK_HPP
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+// One compiled-in asset: a slice of the resource blob plus the headers it
+// is served with
+struct ResourceRecord {
+    std::string_view path;
+    uint64_t offset;
+    uint64_t length;
+    std::string_view mime_type;
+    std::string_view etag;
+};
+
+namespace resource_pack_detail {
+constexpr uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+}
+
+// FNV-1a over the path's bytes, then mixed; the resource compiler (Gen.sh,
+// Gen.ps1) computes the same values
+constexpr uint64_t hash(const std::string_view key) {
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (const char c : key) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001B3ull;
+    }
+    return mix(h);
+}
+
+// Hash and displace: a key goes to bucket hash(key) % n, and the bucket's
+// displacement d picks its slot, either mix(hash(key) + d * golden) % n
+// for d > 0 or slot -d - 1 for d < 0. One bucket read, one slot read and
+// one string compare per lookup.
+constexpr const ResourceRecord *lookup(
+    const std::span<const ResourceRecord> slots,
+    const std::span<const int64_t> displacements, const std::string_view key) {
+    if (slots.empty()) return nullptr;
+    const size_t n = slots.size();
+    const uint64_t h = hash(key);
+    const int64_t d = displacements[h % n];
+    const size_t slot =
+        d < 0 ? static_cast<size_t>(-d - 1)
+              : mix(h + static_cast<uint64_t>(d) * 0x9E3779B97F4A7C15ull) % n;
+    return slots[slot].path == key ? &slots[slot] : nullptr;
+}
+}  // namespace resource_pack_detail
+
+/**
+ * @brief Minimal perfect hash over the records of a resource pack
+ * @brief The resource compiler searches the displacements and emits both
+ * tables as constants, records in slot order, and rejects duplicate paths;
+ * the compiler only evaluates lookups
+ */
+template <size_t N>
+struct ResourcePackIndex {
+    std::array<ResourceRecord, N> slots;
+    std::array<int64_t, N> displacements;
+
+    [[nodiscard]] constexpr const ResourceRecord *find(
+        const std::string_view path) const {
+        return resource_pack_detail::lookup(slots, displacements, path);
+    }
+};
+
+/**
+ * @brief Compiled-in assets: one contiguous blob plus its perfect-hash index
+ * @brief Lookups allocate nothing and contents are served straight from the
+ * blob; the blob and the index must have static storage duration
+ */
+class ResourcePack {
+public:
+    template <size_t N>
+    constexpr ResourcePack(const unsigned char *blob, const size_t blob_size,
+                           const ResourcePackIndex<N> &index)
+        : blob(blob),
+          blob_size(blob_size),
+          slots(index.slots),
+          displacements(index.displacements) {}
+
+    [[nodiscard]] constexpr const ResourceRecord *find(
+        const std::string_view path) const {
+        return resource_pack_detail::lookup(slots, displacements, path);
+    }
+    // nothing is returned for a record that does not fit in the blob
+    [[nodiscard]] std::span<const unsigned char> contents(
+        const ResourceRecord &record) const {
+        if (record.offset > blob_size ||
+            record.length > blob_size - record.offset) {
+            return {};
+        }
+        return {blob + record.offset, static_cast<size_t>(record.length)};
+    }
+    // in slot order, not path order
+    [[nodiscard]] std::span<const ResourceRecord> records() const {
+        return slots;
+    }
+    [[nodiscard]] size_t size() const {
+        return slots.size();
+    }
+
+private:
+    const unsigned char *blob;
+    size_t blob_size;
+    std::span<const ResourceRecord> slots;
+    std::span<const int64_t> displacements;
+};
+#endif  // RESOURCE_PACK_HPP
@@ -0,0 +1,113 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "Rope.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace {
+// a new block doubles the rope, within these bounds
+constexpr uint64_t MIN_BLOCK_SIZE = 4 * 1024;
+constexpr uint64_t MAX_BLOCK_SIZE = 4 * 1024 * 1024;
+}  // namespace
+
+// Bytes below `used` belong to some rope and never change; the first rope
+// to move `used` past the end of its last chunk owns the bytes it claims.
+struct Rope::Block {
+    explicit Block(const uint64_t size)
+        : bytes(std::make_unique_for_overwrite<unsigned char[]>(size)),
+          capacity(size) {}
+
+    std::unique_ptr<unsigned char[]> bytes;
+    const uint64_t capacity;
+    std::atomic<uint64_t> used{0};
+};
+
+Rope::Rope(Buffer contents) : size_(contents.size()) {
+    if (!contents.empty()) chunks_.push_back(std::move(contents));
+}
+
+Rope Rope::write(const uint64_t offset,
+                 const std::span<const unsigned char> data) const {
+    Rope result = *this;
+    if (offset >= size_) {
+        result.append(nullptr, offset - size_);
+        result.append(data.data(), data.size());
+        return result;
+    }
+
+    // the overwritten range becomes one new chunk between what is left of
+    // the chunks around it
+    const uint64_t overlap = std::min<uint64_t>(data.size(), size_ - offset);
+    const uint64_t overlap_end = offset + overlap;
+    std::vector<Buffer> chunks;
+    chunks.reserve(chunks_.size() + 2);
+    uint64_t start = 0;
+    bool patched = false;
+    for (const Buffer &chunk : chunks_) {
+        const uint64_t end = start + chunk.size();
+        if (end <= offset || start >= overlap_end) {
+            chunks.push_back(chunk);
+        } else {
+            if (start < offset) {
+                chunks.push_back(chunk.slice(0, offset - start));
+            }
+            if (!patched) {
+                chunks.emplace_back(std::vector<unsigned char>(
+                    data.begin(), data.begin() + overlap));
+                patched = true;
+            }
+            if (end > overlap_end) {
+                chunks.push_back(
+                    chunk.slice(overlap_end - start, end - overlap_end));
+            }
+        }
+        start = end;
+    }
+    result.chunks_ = std::move(chunks);
+    // the last chunk is no longer a view into the tail block
+    if (overlap_end == size_) result.tail_.reset();
+    result.append(data.data() + overlap, data.size() - overlap);
+    return result;
+}
+
+void Rope::append(const unsigned char *data, uint64_t length) {
+    while (length > 0) {
+        if (tail_) {
+            const Buffer &last = chunks_.back();
+            const uint64_t end = last.data() + last.size() - tail_->bytes.get();
+            const uint64_t take = std::min(tail_->capacity - end, length);
+            uint64_t expected = end;
+            if (take > 0 && tail_->used.compare_exchange_strong(
+                                expected, end + take)) {
+                unsigned char *target = tail_->bytes.get() + end;
+                if (data != nullptr) {
+                    std::memcpy(target, data, take);
+                    data += take;
+                } else {
+                    std::memset(target, 0, take);
+                }
+                chunks_.back() = Buffer(last.data(), last.size() + take, tail_);
+                size_ += take;
+                length -= take;
+                continue;
+            }
+        }
+        const uint64_t capacity = std::max(
+            std::clamp(size_, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE), length);
+        tail_ = std::make_shared<Block>(capacity);
+        chunks_.emplace_back(tail_->bytes.get(), 0, tail_);
+    }
+}
+
+Buffer Rope::flatten() const {
+    if (chunks_.size() == 1) return chunks_.front();
+    std::vector<unsigned char> contents;
+    contents.reserve(size_);
+    for (const Buffer &chunk : chunks_) {
+        contents.insert(contents.end(), chunk.begin(), chunk.end());
+    }
+    return contents;
+}
@@ -0,0 +1,53 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#ifndef ROPE_HPP
+#define ROPE_HPP
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+#include "Buffer.hpp"
+
+/**
+ * @brief Immutable contents made of a list of chunks, for growing files
+ * @brief Writing returns a new rope sharing the unchanged chunks with this
+ * one. Appends go to the spare capacity of the last block when no other
+ * rope has claimed it yet, and to a new, larger block otherwise, so a
+ * file grows without its existing bytes being copied or reallocated.
+ */
+class Rope {
+public:
+    Rope() = default;
+    // a one-chunk rope over contents
+    explicit Rope(Buffer contents);
+
+    [[nodiscard]] const std::vector<Buffer> &chunks() const {
+        return chunks_;
+    }
+    [[nodiscard]] uint64_t size() const {
+        return size_;
+    }
+    [[nodiscard]] bool empty() const {
+        return chunks_.empty();
+    }
+
+    // this rope with data written at offset; a gap past the end is filled
+    // with zeros. Costs the size of data plus the number of chunks.
+    [[nodiscard]] Rope write(uint64_t offset,
+                             std::span<const unsigned char> data) const;
+    // the contents in one buffer; copies unless there is a single chunk
+    [[nodiscard]] Buffer flatten() const;
+
+private:
+    struct Block;
+    std::vector<Buffer> chunks_;
+    // the block the last chunk lies in, while that chunk can still grow
+    std::shared_ptr<Block> tail_;
+    uint64_t size_ = 0;
+
+    // appends length bytes of data, or zeros if data is null
+    void append(const unsigned char *data, uint64_t length);
+};
+#endif  // ROPE_HPP
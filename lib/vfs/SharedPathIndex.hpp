@@ -0,0 +1,325 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#ifndef SHARED_PATH_INDEX_HPP
+#define SHARED_PATH_INDEX_HPP
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Hash array mapped trie from path to Value whose copies share
+ * structure
+ * @brief Each level consumes 5 bits of the key's hash and keeps only its
+ * occupied slots, found by popcount. Copying the index copies one pointer;
+ * a write then copies just the nodes on its path that another copy still
+ * references, and updates the rest in place, so copies cost memory in
+ * proportion to what changed between them. Keys whose hashes are equal in
+ * full share a list at the bottom level.
+ * @brief A copy may be read from one thread while another thread writes
+ * to a different copy. Iteration order is unspecified.
+ */
+template <typename Value>
+class SharedPathIndex {
+public:
+    [[nodiscard]] const Value *find(const std::string_view key) const {
+        const Leaf *leaf = find_leaf(key, hash_of(key));
+        return leaf ? &leaf->value : nullptr;
+    }
+    [[nodiscard]] bool contains(const std::string_view key) const {
+        return find(key) != nullptr;
+    }
+
+    // returns true if key was not present before
+    bool insert_or_assign(const std::string_view key, Value value) {
+        const size_t hash = hash_of(key);
+        std::shared_ptr<Node> *link = &root;
+        for (unsigned shift = 0;; shift += BITS) {
+            Node &node = own(*link);
+            if (shift >= HASH_BITS) {
+                for (Slot &slot : node.slots) {
+                    if (slot.leaf->key == key) {
+                        assign(slot.leaf, std::move(value));
+                        return false;
+                    }
+                }
+                node.slots.push_back({nullptr, make_leaf(key, hash, value)});
+                count++;
+                return true;
+            }
+            const uint32_t bit = bit_of(hash, shift);
+            const size_t position = position_of(node, bit);
+            if ((node.bitmap & bit) == 0) {
+                node.bitmap |= bit;
+                node.slots.insert(node.slots.begin() + position,
+                                  {nullptr, make_leaf(key, hash, value)});
+                count++;
+                return true;
+            }
+            Slot &slot = node.slots[position];
+            if (slot.leaf) {
+                if (slot.leaf->hash == hash && slot.leaf->key == key) {
+                    assign(slot.leaf, std::move(value));
+                    return false;
+                }
+                // push the leaf already here one level down and go on there
+                slot.node = std::make_shared<Node>();
+                place(*slot.node, std::move(slot.leaf), shift + BITS);
+            }
+            link = &slot.node;
+        }
+    }
+
+    bool erase(const std::string_view key) {
+        const size_t hash = hash_of(key);
+        // a miss must not unshare anything
+        if (find_leaf(key, hash) == nullptr) return false;
+        erase_below(root, key, hash, 0);
+        if (root->slots.empty()) root.reset();
+        count--;
+        return true;
+    }
+
+    void clear() {
+        root.reset();
+        count = 0;
+    }
+    [[nodiscard]] size_t size() const {
+        return count;
+    }
+    [[nodiscard]] bool empty() const {
+        return count == 0;
+    }
+
+    template <typename Callback>
+    void for_each(Callback &&callback) const {
+        if (root) visit(*root, callback);
+    }
+
+    // calls callback(key, before, after) for every key whose value differs
+    // between before and after, with nullptr on the side missing it. Only
+    // the parts the two do not share are visited, so comparing an index
+    // with an earlier copy of itself costs the number of changes.
+    template <typename Callback>
+    static void diff(const SharedPathIndex &before,
+                     const SharedPathIndex &after, Callback &&callback) {
+        diff_nodes(before.root.get(), after.root.get(), 0, callback);
+    }
+
+private:
+    struct Leaf {
+        std::string key;
+        size_t hash;
+        Value value;
+    };
+    struct Node;
+    // exactly one of node and leaf is set
+    struct Slot {
+        std::shared_ptr<Node> node;
+        std::shared_ptr<Leaf> leaf;
+    };
+    struct Node {
+        // which of the 32 hash values at this level have a slot; unused in
+        // a bottom-level list
+        uint32_t bitmap = 0;
+        std::vector<Slot> slots;
+    };
+    static constexpr unsigned BITS = 5;
+    static constexpr unsigned HASH_BITS = sizeof(size_t) * 8;
+
+    std::shared_ptr<Node> root;
+    size_t count = 0;
+
+    static size_t hash_of(const std::string_view key) {
+        return std::hash<std::string_view>{}(key);
+    }
+    static uint32_t bit_of(const size_t hash, const unsigned shift) {
+        return uint32_t{1} << ((hash >> shift) & ((1u << BITS) - 1));
+    }
+    static size_t position_of(const Node &node, const uint32_t bit) {
+        return std::popcount(node.bitmap & (bit - 1));
+    }
+
+    // true if no other copy can reach *pointer
+    template <typename T>
+    static bool unique(const std::shared_ptr<T> &pointer) {
+        if (pointer.use_count() != 1) return false;
+        // pairs with the release done by the copy that let go of it
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+    }
+    // the node behind link, copied first if another copy shares it
+    static Node &own(std::shared_ptr<Node> &link) {
+        if (!link) {
+            link = std::make_shared<Node>();
+        } else if (!unique(link)) {
+            link = std::make_shared<Node>(*link);
+        }
+        return *link;
+    }
+    static std::shared_ptr<Leaf> make_leaf(const std::string_view key,
+                                           const size_t hash, Value &value) {
+        return std::make_shared<Leaf>(
+            Leaf{std::string(key), hash, std::move(value)});
+    }
+    static void assign(std::shared_ptr<Leaf> &leaf, Value value) {
+        if (unique(leaf)) {
+            leaf->value = std::move(value);
+        } else {
+            leaf = std::make_shared<Leaf>(
+                Leaf{leaf->key, leaf->hash, std::move(value)});
+        }
+    }
+    // makes leaf the only slot of an empty node at the given level
+    static void place(Node &node, std::shared_ptr<Leaf> leaf,
+                      const unsigned shift) {
+        if (shift < HASH_BITS) node.bitmap = bit_of(leaf->hash, shift);
+        node.slots.push_back({nullptr, std::move(leaf)});
+    }
+
+    [[nodiscard]] const Leaf *find_leaf(const std::string_view key,
+                                        const size_t hash) const {
+        const Node *node = root.get();
+        for (unsigned shift = 0; node != nullptr; shift += BITS) {
+            if (shift >= HASH_BITS) {
+                for (const Slot &slot : node->slots) {
+                    if (slot.leaf->key == key) return slot.leaf.get();
+                }
+                return nullptr;
+            }
+            const uint32_t bit = bit_of(hash, shift);
+            if ((node->bitmap & bit) == 0) return nullptr;
+            const Slot &slot = node->slots[position_of(*node, bit)];
+            if (slot.leaf) {
+                return slot.leaf->hash == hash && slot.leaf->key == key
+                           ? slot.leaf.get()
+                           : nullptr;
+            }
+            node = slot.node.get();
+        }
+        return nullptr;
+    }
+
+    // removes key, which is present below link
+    static void erase_below(std::shared_ptr<Node> &link,
+                            const std::string_view key, const size_t hash,
+                            const unsigned shift) {
+        Node &node = own(link);
+        if (shift >= HASH_BITS) {
+            std::erase_if(node.slots, [key](const Slot &slot) {
+                return slot.leaf->key == key;
+            });
+            return;
+        }
+        const uint32_t bit = bit_of(hash, shift);
+        const size_t position = position_of(node, bit);
+        Slot &slot = node.slots[position];
+        if (slot.node) {
+            erase_below(slot.node, key, hash, shift + BITS);
+            // a child left with a single leaf folds back into this slot
+            if (slot.node->slots.size() == 1 && slot.node->slots[0].leaf) {
+                slot.leaf = slot.node->slots[0].leaf;
+                slot.node.reset();
+            }
+            if (slot.leaf || !slot.node->slots.empty()) return;
+        }
+        node.slots.erase(node.slots.begin() + position);
+        node.bitmap &= ~bit;
+    }
+
+    template <typename Callback>
+    static void visit(const Node &node, Callback &callback) {
+        for (const Slot &slot : node.slots) {
+            if (slot.leaf) {
+                callback(slot.leaf->key, slot.leaf->value);
+            } else {
+                visit(*slot.node, callback);
+            }
+        }
+    }
+
+    static void collect(const Slot &slot, std::vector<const Leaf *> &leaves) {
+        if (slot.leaf) {
+            leaves.push_back(slot.leaf.get());
+            return;
+        }
+        for (const Slot &child : slot.node->slots) collect(child, leaves);
+    }
+
+    // compares two groups of leaves by key; one side holds at most one
+    // leaf unless both come from a bottom-level list
+    template <typename Callback>
+    static void diff_leaves(const std::vector<const Leaf *> &before,
+                            const std::vector<const Leaf *> &after,
+                            Callback &callback) {
+        for (const Leaf *old_leaf : before) {
+            const Leaf *new_leaf = nullptr;
+            for (const Leaf *candidate : after) {
+                if (candidate->key == old_leaf->key) new_leaf = candidate;
+            }
+            if (new_leaf == nullptr || new_leaf->value != old_leaf->value) {
+                callback(old_leaf->key, &old_leaf->value,
+                         new_leaf ? &new_leaf->value : nullptr);
+            }
+        }
+        for (const Leaf *new_leaf : after) {
+            bool found = false;
+            for (const Leaf *candidate : before) {
+                found = found || candidate->key == new_leaf->key;
+            }
+            if (!found) callback(new_leaf->key, nullptr, &new_leaf->value);
+        }
+    }
+
+    template <typename Callback>
+    static void diff_nodes(const Node *before, const Node *after,
+                           const unsigned shift, Callback &callback) {
+        if (before == after) return;
+        std::vector<const Leaf *> old_leaves;
+        std::vector<const Leaf *> new_leaves;
+        if (before == nullptr || after == nullptr || shift >= HASH_BITS) {
+            if (before) {
+                for (const Slot &slot : before->slots) {
+                    collect(slot, old_leaves);
+                }
+            }
+            if (after) {
+                for (const Slot &slot : after->slots) {
+                    collect(slot, new_leaves);
+                }
+            }
+            diff_leaves(old_leaves, new_leaves, callback);
+            return;
+        }
+        for (uint32_t bits = before->bitmap | after->bitmap; bits != 0;
+             bits &= bits - 1) {
+            const uint32_t bit = bits & -bits;
+            const Slot *old_slot =
+                before->bitmap & bit
+                    ? &before->slots[position_of(*before, bit)]
+                    : nullptr;
+            const Slot *new_slot =
+                after->bitmap & bit ? &after->slots[position_of(*after, bit)]
+                                    : nullptr;
+            if (old_slot && new_slot && old_slot->node && new_slot->node) {
+                diff_nodes(old_slot->node.get(), new_slot->node.get(),
+                           shift + BITS, callback);
+                continue;
+            }
+            old_leaves.clear();
+            new_leaves.clear();
+            if (old_slot) collect(*old_slot, old_leaves);
+            if (new_slot) collect(*new_slot, new_leaves);
+            diff_leaves(old_leaves, new_leaves, callback);
+        }
+    }
+};
+#endif  // SHARED_PATH_INDEX_HPP
@@ -0,0 +1,168 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "SpillFile.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+namespace {
+// contents are packed into mappings of this size; larger ones get their own
+constexpr uint64_t SEGMENT_SIZE = 64 * 1024 * 1024;
+
+uint64_t page_size() {
+    static const auto size = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+struct Segment {
+    void *address = nullptr;
+    uint64_t length = 0;
+    uint64_t file_offset = 0;
+
+    ~Segment() {
+        if (address != nullptr) ::munmap(address, length);
+    }
+    [[nodiscard]] const unsigned char *bytes() const {
+        return static_cast<const unsigned char *>(address);
+    }
+};
+}  // namespace
+
+// Shared with the buffers handed out so they can release their extent after
+// the SpillFile itself is gone.
+struct SpillFile::State {
+    std::mutex mutex;
+    int fd = -1;
+    uint64_t file_end = 0;
+    std::shared_ptr<Segment> current;
+    uint64_t used = 0;
+    uint64_t live = 0;
+
+    ~State() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    bool open() {
+        if (fd >= 0) return true;
+        std::string path =
+            (std::filesystem::temp_directory_path() / "membrane-spill-XXXXXX")
+                .string();
+        fd = ::mkstemp(path.data());
+        if (fd < 0) {
+            std::cerr << "Failed to create spill file: " << strerror(errno)
+                      << std::endl;
+            return false;
+        }
+        // the file disappears with the last descriptor
+        ::unlink(path.c_str());
+        return true;
+    }
+
+    std::shared_ptr<Segment> map_segment(const uint64_t length) {
+        if (::ftruncate(fd, static_cast<off_t>(file_end + length)) != 0) {
+            return nullptr;
+        }
+        void *address = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd,
+                               static_cast<off_t>(file_end));
+        if (address == MAP_FAILED) return nullptr;
+        auto segment = std::make_shared<Segment>();
+        segment->address = address;
+        segment->length = length;
+        segment->file_offset = file_end;
+        file_end += length;
+        return segment;
+    }
+
+    // gives the whole pages of a released extent back to the file system
+    void release(const uint64_t file_offset, const uint64_t length) {
+        std::lock_guard lock(mutex);
+        live -= length;
+#ifdef FALLOC_FL_PUNCH_HOLE
+        const uint64_t page = page_size();
+        const uint64_t first = (file_offset + page - 1) / page * page;
+        const uint64_t last = (file_offset + length) / page * page;
+        if (last > first) {
+            ::fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                        static_cast<off_t>(first),
+                        static_cast<off_t>(last - first));
+        }
+#else
+        (void)file_offset;
+#endif
+    }
+};
+
+SpillFile::SpillFile() : state(std::make_shared<State>()) {}
+
+SpillFile::~SpillFile() = default;
+
+std::optional<Buffer> SpillFile::spill(
+    const std::span<const unsigned char> data) {
+    if (data.empty()) return Buffer();
+    std::lock_guard lock(state->mutex);
+    if (!state->open()) return std::nullopt;
+
+    std::shared_ptr<Segment> segment;
+    uint64_t offset = 0;
+    if (data.size() > SEGMENT_SIZE / 4) {
+        const uint64_t page = page_size();
+        segment =
+            state->map_segment((data.size() + page - 1) / page * page);
+    } else {
+        if (!state->current || state->used + data.size() > SEGMENT_SIZE) {
+            state->current = state->map_segment(SEGMENT_SIZE);
+            state->used = 0;
+        }
+        segment = state->current;
+        offset = state->used;
+    }
+    if (!segment) {
+        std::cerr << "Failed to map spill file: " << strerror(errno)
+                  << std::endl;
+        return std::nullopt;
+    }
+
+    const uint64_t file_offset = segment->file_offset + offset;
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t n =
+            ::pwrite(state->fd, data.data() + written, data.size() - written,
+                     static_cast<off_t>(file_offset + written));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Failed to write spill file: " << strerror(errno)
+                      << std::endl;
+            return std::nullopt;
+        }
+        written += static_cast<size_t>(n);
+    }
+    if (segment == state->current) {
+        // keep later contents 8-byte aligned
+        state->used += (data.size() + 7) / 8 * 8;
+    }
+    state->live += data.size();
+
+    // the extent keeps its segment mapped and frees its pages when the
+    // last buffer over it goes away
+    const unsigned char *bytes = segment->bytes() + offset;
+    std::shared_ptr<const void> extent(
+        bytes, [state = state, segment, file_offset,
+                length = data.size()](const void *) {
+            state->release(file_offset, length);
+        });
+    return Buffer(bytes, data.size(), std::move(extent));
+}
+
+uint64_t SpillFile::live_bytes() const {
+    std::lock_guard lock(state->mutex);
+    return state->live;
+}
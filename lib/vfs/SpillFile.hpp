@@ -0,0 +1,37 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#ifndef SPILL_FILE_HPP
+#define SPILL_FILE_HPP
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include "Buffer.hpp"
+
+/**
+ * @brief Anonymous on-disk backing for contents evicted from memory
+ * @brief Contents are written to an unlinked temporary file and handed
+ * back as buffers over a shared mapping of it, so they live in the page
+ * cache and the kernel reads them back in on access. The disk space of a
+ * spilled copy is released once no buffer refers to it.
+ */
+class SpillFile {
+public:
+    SpillFile();
+    ~SpillFile();
+    SpillFile(const SpillFile &) = delete;
+    SpillFile &operator=(const SpillFile &) = delete;
+
+    // copies data to the file; nothing is returned if it cannot be written
+    [[nodiscard]] std::optional<Buffer> spill(
+        std::span<const unsigned char> data);
+    // bytes of spilled contents still referenced
+    [[nodiscard]] uint64_t live_bytes() const;
+
+private:
+    struct State;
+    std::shared_ptr<State> state;
+};
+#endif  // SPILL_FILE_HPP
@@ -0,0 +1,111 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "vfs.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Throughput of VFS operations whose speed depends on the machine; run by
+// hand rather than by ctest.
+
+namespace {
+// lookups per second while readers, and optionally a writer replacing the
+// same entries, run for 200 ms
+long concurrent_reads(VirtualFileSystem &vfs,
+                      const std::vector<unsigned char> &data,
+                      const int reader_count, const bool with_writer) {
+    std::atomic<bool> stop{false};
+    std::atomic<long> reads{0};
+    std::vector<std::thread> threads;
+    for (int r = 0; r < reader_count; r++) {
+        threads.emplace_back([&, r] {
+            long local = 0;
+            for (int i = r; !stop; i++) {
+                if (vfs.get_file("asset" + std::to_string(i % 256) + ".js")) {
+                    local++;
+                }
+            }
+            reads += local;
+        });
+    }
+    if (with_writer) {
+        threads.emplace_back([&] {
+            for (int i = 0; !stop; i++) {
+                vfs.add_file("asset" + std::to_string(i % 256) + ".js",
+                             data.data(), data.size());
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    stop = true;
+    for (auto &thread : threads) thread.join();
+    return reads * 5;
+}
+
+void bench_concurrent_reads() {
+    VirtualFileSystem vfs;
+    const std::vector<unsigned char> data(16 * 1024, 'x');
+    for (int i = 0; i < 256; i++) {
+        vfs.add_file("asset" + std::to_string(i) + ".js", data.data(),
+                     data.size());
+    }
+    for (const int readers : {1, 4}) {
+        for (const bool with_writer : {false, true}) {
+            std::printf("%d reader(s)%s: %ld lookups/s\n", readers,
+                        with_writer ? " + writer" : "",
+                        concurrent_reads(vfs, data, readers, with_writer));
+        }
+    }
+}
+
+// save_to_disk() and load_from_disk() of 2000 16 KB files for several
+// io_threads settings
+void bench_parallel_persistence() {
+    constexpr int kFiles = 2000;
+    std::vector<unsigned char> data(16 * 1024, 'x');
+    const std::string root =
+        (std::filesystem::temp_directory_path() / "vfs_benchmark").string();
+    const auto mb_per_second = [&](const std::chrono::duration<double> time) {
+        return kFiles * data.size() / (1024.0 * 1024.0) / time.count();
+    };
+    for (const size_t workers : {1, 4, 16}) {
+        const std::string dir = root + "/workers" + std::to_string(workers);
+        std::filesystem::remove_all(dir);
+        std::chrono::steady_clock::duration save_time;
+        {
+            VirtualFileSystem vfs(dir, workers);
+            for (int i = 0; i < kFiles; i++) {
+                data[0] = static_cast<unsigned char>(i);
+                vfs.add_file("dir" + std::to_string(i % 20) + "/file" +
+                                 std::to_string(i) + ".bin",
+                             data.data(), data.size());
+            }
+            const auto start = std::chrono::steady_clock::now();
+            if (!vfs.save_to_disk()) {
+                std::fprintf(stderr, "save_to_disk failed\n");
+                return;
+            }
+            save_time = std::chrono::steady_clock::now() - start;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        const VirtualFileSystem loaded(dir, workers);
+        const auto load_time = std::chrono::steady_clock::now() - start;
+        std::printf("%zu I/O worker(s): save %.0f MB/s, load %.0f MB/s\n",
+                    workers, mb_per_second(save_time),
+                    mb_per_second(load_time));
+    }
+    std::filesystem::remove_all(root);
+}
+}  // namespace
+
+int main() {
+    bench_concurrent_reads();
+    bench_parallel_persistence();
+    return 0;
+}
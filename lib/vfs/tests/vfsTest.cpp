@@ -1,8 +1,18 @@
 #include <gtest/gtest.h>
 #include "vfs.hpp"
+#include "ResourcePack.hpp"
+#include "SharedPathIndex.hpp"
+#include <miniz.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <csignal>
 #include <filesystem>
 #include <fstream>
+#include <map>
+#include <random>
 #include <string>
+#include <thread>
 
 class VFSTest : public ::testing::Test {
 protected:
@@ -41,7 +51,7 @@ TEST_F(VFSTest, AddAndRetrieveFile) {
     EXPECT_TRUE(vfs.exists("test.txt"));
     
     // Retrieve and check the file
-    const VirtualFileSystem::FileEntry* entry = vfs.get_file("test.txt");
+    const VirtualFileSystem::FileHandle entry = vfs.get_file("test.txt");
     ASSERT_NE(entry, nullptr);
     
     // Convert back to string for comparison
@@ -56,7 +66,7 @@ TEST_F(VFSTest, FileDoesNotExist) {
     EXPECT_FALSE(vfs.exists("nonexistent.txt"));
     
     // Try to retrieve a non-existent file
-    const VirtualFileSystem::FileEntry* entry = vfs.get_file("nonexistent.txt");
+    const VirtualFileSystem::FileHandle entry = vfs.get_file("nonexistent.txt");
     EXPECT_EQ(entry, nullptr);
 }
 
@@ -113,7 +123,7 @@ TEST_F(VFSTest, BasicPersistence) {
         VirtualFileSystem vfs2(test_dir);
         EXPECT_TRUE(vfs2.exists("persistent.txt"));
         
-        const VirtualFileSystem::FileEntry* entry = vfs2.get_file("persistent.txt");
+        const VirtualFileSystem::FileHandle entry = vfs2.get_file("persistent.txt");
         ASSERT_NE(entry, nullptr);
         
         std::string retrieved_content(entry->data.begin(), entry->data.end());
@@ -147,10 +157,10 @@ TEST_F(VFSTest, PersistenceWithSubdirectories) {
         EXPECT_TRUE(vfs2.exists("subdir/nested.txt"));
         EXPECT_TRUE(vfs2.exists("deeply/nested/path/file.txt"));
         
-        const VirtualFileSystem::FileEntry* entry1 = vfs2.get_file("subdir/nested.txt");
+        const VirtualFileSystem::FileHandle entry1 = vfs2.get_file("subdir/nested.txt");
         ASSERT_NE(entry1, nullptr);
         
-        const VirtualFileSystem::FileEntry* entry2 = vfs2.get_file("deeply/nested/path/file.txt");
+        const VirtualFileSystem::FileHandle entry2 = vfs2.get_file("deeply/nested/path/file.txt");
         ASSERT_NE(entry2, nullptr);
         
         std::string retrieved_content1(entry1->data.begin(), entry1->data.end());
@@ -191,7 +201,7 @@ TEST_F(VFSTest, BinaryFileHandling) {
     
     // Check if file exists and retrieve it
     EXPECT_TRUE(vfs.exists("binary.dat"));
-    const VirtualFileSystem::FileEntry* entry = vfs.get_file("binary.dat");
+    const VirtualFileSystem::FileHandle entry = vfs.get_file("binary.dat");
     ASSERT_NE(entry, nullptr);
     
     // Verify binary data is preserved
@@ -206,7 +216,7 @@ TEST_F(VFSTest, BinaryFileHandling) {
     // Load in a new VFS instance
     VirtualFileSystem vfs2(test_dir);
     EXPECT_TRUE(vfs2.exists("binary.dat"));
-    const VirtualFileSystem::FileEntry* entry2 = vfs2.get_file("binary.dat");
+    const VirtualFileSystem::FileHandle entry2 = vfs2.get_file("binary.dat");
     ASSERT_NE(entry2, nullptr);
     
     // Verify binary data is preserved after persistence
@@ -259,6 +269,1115 @@ TEST_F(VFSTest, PersistenceDirCreation) {
     EXPECT_TRUE(std::filesystem::exists(deep_dir + "/test.txt"));
 }
 
+TEST_F(VFSTest, IncrementalSaveWritesOnlyDirtyEntries) {
+    std::vector<unsigned char> data = createTestData("original");
+    std::filesystem::path a_path = std::filesystem::path(test_dir) / "a.txt";
+    std::filesystem::path b_path = std::filesystem::path(test_dir) / "b.txt";
+
+    VirtualFileSystem vfs(test_dir);
+    vfs.add_file("a.txt", data.data(), data.size());
+    vfs.add_file("b.txt", data.data(), data.size());
+    EXPECT_TRUE(vfs.has_unsaved_changes());
+    EXPECT_TRUE(vfs.save_to_disk());
+    EXPECT_FALSE(vfs.has_unsaved_changes());
+
+    // Tamper with a clean entry on disk: an incremental save must not touch it
+    {
+        std::ofstream out(a_path, std::ios::binary | std::ios::trunc);
+        out << "external";
+    }
+    std::vector<unsigned char> updated = createTestData("updated");
+    vfs.add_file("b.txt", updated.data(), updated.size());
+    EXPECT_TRUE(vfs.save_to_disk());
+
+    std::ifstream a_in(a_path, std::ios::binary);
+    std::string a_content((std::istreambuf_iterator<char>(a_in)), std::istreambuf_iterator<char>());
+    std::ifstream b_in(b_path, std::ios::binary);
+    std::string b_content((std::istreambuf_iterator<char>(b_in)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(a_content, "external");
+    EXPECT_EQ(b_content, "updated");
+    EXPECT_TRUE(std::filesystem::is_empty(test_dir + "/.membrane-tmp"));
+}
+
+// Only the VFS's own scratch files are discarded on load, whatever the
+// user's files are called
+TEST_F(VFSTest, LoadKeepsFilesNamedLikeTempFiles) {
+    {
+        VirtualFileSystem vfs(test_dir);
+        std::vector<unsigned char> data = createTestData("kept");
+        vfs.add_file("notes.membrane-tmp", data.data(), data.size());
+        EXPECT_TRUE(vfs.save_to_disk());
+    }
+    std::ofstream(test_dir + "/.membrane-tmp/1-1", std::ios::binary) << "partial";
+
+    VirtualFileSystem loaded(test_dir);
+    EXPECT_TRUE(loaded.load_from_disk());
+    ASSERT_TRUE(loaded.exists("notes.membrane-tmp"));
+    EXPECT_EQ(loaded.get_files().size(), 1);
+    EXPECT_FALSE(std::filesystem::exists(test_dir + "/.membrane-tmp"));
+}
+
+TEST_F(VFSTest, RemoveFileDeletesOnSave) {
+    std::vector<unsigned char> data = createTestData("to be removed");
+    std::filesystem::path disk_path = std::filesystem::path(test_dir) / "gone.txt";
+
+    {
+        VirtualFileSystem vfs(test_dir);
+        vfs.add_file("gone.txt", data.data(), data.size());
+        EXPECT_TRUE(vfs.save_to_disk());
+        EXPECT_TRUE(std::filesystem::exists(disk_path));
+
+        EXPECT_TRUE(vfs.remove_file("gone.txt"));
+        EXPECT_FALSE(vfs.remove_file("gone.txt"));
+        EXPECT_FALSE(vfs.exists("gone.txt"));
+        EXPECT_TRUE(vfs.has_unsaved_changes());
+        EXPECT_TRUE(vfs.save_to_disk());
+        EXPECT_FALSE(std::filesystem::exists(disk_path));
+    }
+
+    VirtualFileSystem vfs2(test_dir);
+    EXPECT_FALSE(vfs2.exists("gone.txt"));
+}
+
+TEST_F(VFSTest, SaveWithoutChangesIsNoOp) {
+    std::vector<unsigned char> data = createTestData("stable");
+    {
+        VirtualFileSystem vfs(test_dir);
+        vfs.add_file("stable.txt", data.data(), data.size());
+        EXPECT_TRUE(vfs.save_to_disk());
+    }
+
+    // Entries loaded from disk start clean
+    VirtualFileSystem vfs2(test_dir);
+    EXPECT_FALSE(vfs2.has_unsaved_changes());
+    std::filesystem::remove(std::filesystem::path(test_dir) / "stable.txt");
+    EXPECT_TRUE(vfs2.save_to_disk());
+    EXPECT_FALSE(std::filesystem::exists(std::filesystem::path(test_dir) / "stable.txt"));
+}
+
+TEST_F(VFSTest, BackgroundPersistenceCoalescesAndFlushes) {
+    std::vector<unsigned char> data = createTestData("background");
+    std::filesystem::path disk_path = std::filesystem::path(test_dir) / "bg.txt";
+
+    VirtualFileSystem vfs(test_dir);
+    ASSERT_TRUE(vfs.start_background_persistence(std::chrono::milliseconds(50)));
+    EXPECT_TRUE(vfs.has_background_persistence());
+
+    for (int i = 0; i < 100; i++) {
+        std::string content = "version " + std::to_string(i);
+        vfs.add_file("bg.txt", reinterpret_cast<const unsigned char*>(content.data()), content.size());
+    }
+    // add_file returns before anything reaches the disk
+    EXPECT_TRUE(vfs.flush());
+    EXPECT_FALSE(vfs.has_unsaved_changes());
+
+    std::ifstream in(disk_path, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(content, "version 99");
+
+    // Without an explicit flush the debounce window eventually fires
+    std::filesystem::path later_path = std::filesystem::path(test_dir) / "later.txt";
+    vfs.add_file("later.txt", data.data(), data.size());
+    for (int i = 0; i < 100 && !std::filesystem::exists(later_path); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(std::filesystem::exists(later_path));
+}
+
+TEST_F(VFSTest, BackgroundPersistenceRequiresPersistentVFS) {
+    VirtualFileSystem vfs;
+    EXPECT_FALSE(vfs.start_background_persistence(std::chrono::milliseconds(10)));
+    EXPECT_FALSE(vfs.has_background_persistence());
+}
+
+TEST_F(VFSTest, WriteAheadLogRecoversUnsavedChanges) {
+    std::string crash_dir = test_dir + "_crash";
+    std::vector<unsigned char> kept = createTestData("kept");
+    std::vector<unsigned char> logged = createTestData("only in the log");
+    {
+        VirtualFileSystem vfs(test_dir);
+        vfs.add_file("kept.txt", kept.data(), kept.size());
+        vfs.add_file("dropped.txt", kept.data(), kept.size());
+        EXPECT_TRUE(vfs.save_to_disk());
+
+        ASSERT_TRUE(vfs.enable_write_ahead_log());
+        EXPECT_TRUE(vfs.has_write_ahead_log());
+        vfs.add_file("logged/new.txt", logged.data(), logged.size());
+        EXPECT_TRUE(vfs.remove_file("dropped.txt"));
+
+        // Capture the disk as a crash would leave it, before the destructor saves
+        std::filesystem::copy(test_dir, crash_dir, std::filesystem::copy_options::recursive);
+    }
+    // Simulate a torn write at the tail of the log
+    for (const auto& entry : std::filesystem::directory_iterator(crash_dir)) {
+        if (entry.path().filename().string().starts_with(".membrane.wal.")) {
+            std::ofstream tail(entry.path(), std::ios::binary | std::ios::app);
+            tail << "torn";
+        }
+    }
+
+    {
+        VirtualFileSystem recovered(crash_dir);
+        EXPECT_FALSE(recovered.exists("logged/new.txt"));
+        ASSERT_TRUE(recovered.enable_write_ahead_log());
+        ASSERT_TRUE(recovered.exists("logged/new.txt"));
+        EXPECT_TRUE(recovered.exists("kept.txt"));
+        EXPECT_FALSE(recovered.exists("dropped.txt"));
+        auto entry = recovered.get_file("logged/new.txt");
+        ASSERT_NE(entry, nullptr);
+        EXPECT_EQ(std::string(entry->data.begin(), entry->data.end()), "only in the log");
+        EXPECT_TRUE(recovered.has_unsaved_changes());
+    }
+
+    // The replayed changes were folded into the snapshot and the logs dropped
+    VirtualFileSystem reopened(crash_dir);
+    EXPECT_TRUE(reopened.exists("logged/new.txt"));
+    EXPECT_FALSE(reopened.exists("dropped.txt"));
+    for (const auto& entry : std::filesystem::directory_iterator(crash_dir)) {
+        EXPECT_FALSE(entry.path().filename().string().starts_with(".membrane.wal."));
+    }
+    std::filesystem::remove_all(crash_dir);
+}
+
+// A record the log could not take is cut off and saved instead, so the
+// records logged after it are still replayed
+TEST_F(VFSTest, WriteAheadLogSurvivesFailedAppend) {
+    std::string crash_dir = test_dir + "_crash";
+    std::vector<unsigned char> small = createTestData(std::string(1000, 's'));
+    std::vector<unsigned char> big = createTestData(std::string(3000, 'b'));
+    std::vector<unsigned char> after = createTestData("after");
+    {
+        VirtualFileSystem vfs(test_dir);
+        ASSERT_TRUE(vfs.enable_write_ahead_log());
+        vfs.add_file("a.txt", small.data(), small.size());
+        vfs.add_file("b.txt", small.data(), small.size());
+
+        // files may not grow past 4000 bytes: the big record tears the
+        // log, but the save that replaces it fits
+        rlimit previous{};
+        ASSERT_EQ(getrlimit(RLIMIT_FSIZE, &previous), 0);
+        rlimit limited = previous;
+        limited.rlim_cur = 4000;
+        const auto previous_handler = std::signal(SIGXFSZ, SIG_IGN);
+        ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &limited), 0);
+        vfs.add_file("big.txt", big.data(), big.size());
+        setrlimit(RLIMIT_FSIZE, &previous);
+        std::signal(SIGXFSZ, previous_handler);
+        EXPECT_FALSE(vfs.has_unsaved_changes());
+
+        vfs.add_file("after.txt", after.data(), after.size());
+        std::filesystem::copy(test_dir, crash_dir, std::filesystem::copy_options::recursive);
+    }
+
+    VirtualFileSystem recovered(crash_dir);
+    ASSERT_TRUE(recovered.enable_write_ahead_log());
+    EXPECT_TRUE(recovered.exists("a.txt"));
+    ASSERT_TRUE(recovered.exists("after.txt"));
+    auto entry = recovered.get_file("big.txt");
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->size(), big.size());
+    std::filesystem::remove_all(crash_dir);
+}
+
+TEST_F(VFSTest, WriteAheadLogCompactsIntoSnapshot) {
+    std::vector<unsigned char> data(1024, 'x');
+    VirtualFileSystem vfs(test_dir);
+    ASSERT_TRUE(vfs.enable_write_ahead_log(std::chrono::milliseconds(0), 4096));
+
+    for (int i = 0; i < 8; i++) {
+        vfs.add_file("file" + std::to_string(i) + ".bin", data.data(), data.size());
+    }
+    // Crossing the threshold saved the entries and retired the full log
+    EXPECT_TRUE(std::filesystem::exists(std::filesystem::path(test_dir) / "file0.bin"));
+    size_t log_count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(test_dir)) {
+        const std::string name = entry.path().filename().string();
+        if (name.starts_with(".membrane.wal.")) {
+            log_count++;
+            EXPECT_LT(std::filesystem::file_size(entry.path()), 4096);
+        }
+    }
+    EXPECT_EQ(log_count, 1);
+    // Logs are never loaded as entries
+    EXPECT_FALSE(vfs.exists(".membrane.wal.1"));
+}
+
+// Writes made while the pack is built are kept pending, not lost
+TEST_F(VFSTest, PackedStorageKeepsWritesDuringConversion) {
+    {
+        VirtualFileSystem vfs(test_dir);
+        for (int i = 0; i < 200; i++) {
+            std::vector<unsigned char> data = createTestData("old " + std::to_string(i));
+            vfs.add_file("f" + std::to_string(i) + ".txt", data.data(), data.size());
+        }
+        EXPECT_TRUE(vfs.save_to_disk());
+    }
+    {
+        VirtualFileSystem vfs(test_dir);
+        std::thread writer([this, &vfs] {
+            for (int i = 0; i < 200; i++) {
+                std::vector<unsigned char> data = createTestData("new " + std::to_string(i));
+                vfs.add_file("f" + std::to_string(i) + ".txt", data.data(), data.size());
+                vfs.add_file("g" + std::to_string(i) + ".txt", data.data(), data.size());
+                if (i % 10 == 0) vfs.remove_file("f" + std::to_string(i) + ".txt");
+            }
+        });
+        ASSERT_TRUE(vfs.use_packed_storage());
+        writer.join();
+        EXPECT_TRUE(vfs.save_to_disk());
+    }
+
+    VirtualFileSystem reopened(test_dir);
+    for (int i = 0; i < 200; i++) {
+        const std::string expected = "new " + std::to_string(i);
+        const auto f = reopened.get_file("f" + std::to_string(i) + ".txt");
+        if (i % 10 == 0) {
+            EXPECT_FALSE(f) << i;
+        } else {
+            ASSERT_TRUE(f) << i;
+            EXPECT_EQ(std::string(f->data.begin(), f->data.end()), expected);
+        }
+        const auto g = reopened.get_file("g" + std::to_string(i) + ".txt");
+        ASSERT_TRUE(g) << i;
+        EXPECT_EQ(std::string(g->data.begin(), g->data.end()), expected);
+    }
+}
+
+TEST_F(VFSTest, PackedStorageConvertsDirectoryLayout) {
+    std::vector<unsigned char> data = createTestData("packed content");
+    {
+        VirtualFileSystem vfs(test_dir);
+        vfs.add_file("a.txt", data.data(), data.size());
+        vfs.add_file("nested/b.txt", data.data(), data.size());
+        EXPECT_TRUE(vfs.save_to_disk());
+    }
+    {
+        VirtualFileSystem vfs(test_dir);
+        EXPECT_FALSE(vfs.has_packed_storage());
+        ASSERT_TRUE(vfs.use_packed_storage());
+        EXPECT_TRUE(vfs.has_packed_storage());
+        // The per-entry files are gone, the pack holds everything
+        EXPECT_FALSE(std::filesystem::exists(std::filesystem::path(test_dir) / "a.txt"));
+        EXPECT_FALSE(std::filesystem::exists(std::filesystem::path(test_dir) / "nested" / "b.txt"));
+
+        std::vector<unsigned char> more = createTestData("appended later");
+        vfs.add_file("c.txt", more.data(), more.size());
+        EXPECT_TRUE(vfs.remove_file("a.txt"));
+        EXPECT_TRUE(vfs.save_to_disk());
+    }
+
+    VirtualFileSystem reopened(test_dir);
+    EXPECT_TRUE(reopened.has_packed_storage());
+    EXPECT_FALSE(reopened.exists("a.txt"));
+    ASSERT_TRUE(reopened.exists("nested/b.txt"));
+    ASSERT_TRUE(reopened.exists("c.txt"));
+    auto entry = reopened.get_file("c.txt");
+    EXPECT_EQ(std::string(entry->data.begin(), entry->data.end()), "appended later");
+    EXPECT_EQ(reopened.get_file("nested/b.txt")->mime_type, "application/octet-stream");
+}
+
+TEST_F(VFSTest, PackArchiveAppendCommitAndCompact) {
+    std::vector<unsigned char> big(512 * 1024, 'a');
+    {
+        PackArchive archive(test_dir);
+        ASSERT_TRUE(archive.open());
+        for (int i = 0; i < 4; i++) {
+            big[0] = static_cast<unsigned char>('0' + i);
+            ASSERT_TRUE(archive.append("big.bin", big.data(), big.size()));
+        }
+        ASSERT_TRUE(archive.append("small.txt", reinterpret_cast<const unsigned char*>("hi"), 2));
+        EXPECT_EQ(archive.size(), 2);
+        EXPECT_EQ(archive.garbage_bytes(), 3 * big.size());
+        ASSERT_TRUE(archive.commit(true));
+
+        // Appended but never committed: dropped on the next open
+        ASSERT_TRUE(archive.append("uncommitted.txt", big.data(), 16));
+    }
+    {
+        PackArchive archive(test_dir);
+        ASSERT_TRUE(archive.open());
+        EXPECT_FALSE(archive.find("uncommitted.txt").has_value());
+        ASSERT_TRUE(archive.compact());
+        EXPECT_EQ(archive.garbage_bytes(), 0);
+        EXPECT_EQ(archive.live_bytes(), big.size() + 2);
+    }
+    PackArchive archive(test_dir);
+    ASSERT_TRUE(archive.open());
+    auto found = archive.find("big.bin");
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(found->size(), big.size());
+    EXPECT_EQ((*found)[0], '3');
+    auto small = archive.find("small.txt");
+    ASSERT_TRUE(small.has_value());
+    EXPECT_EQ(std::string(small->begin(), small->end()), "hi");
+}
+
+// An index pointing past the data file is refused instead of mapped
+TEST_F(VFSTest, PackArchiveRejectsTruncatedData) {
+    std::vector<unsigned char> data(4096, 'p');
+    {
+        PackArchive archive(test_dir);
+        ASSERT_TRUE(archive.open());
+        ASSERT_TRUE(archive.append("data.bin", data.data(), data.size()));
+        ASSERT_TRUE(archive.commit(true));
+    }
+    std::filesystem::path data_file;
+    for (const auto& entry : std::filesystem::directory_iterator(test_dir)) {
+        const std::string name = entry.path().filename().string();
+        if (name.starts_with(".membrane.pack.") && name != ".membrane.pack.idx") {
+            data_file = entry.path();
+        }
+    }
+    ASSERT_FALSE(data_file.empty());
+    std::filesystem::resize_file(data_file, 100);
+
+    PackArchive archive(test_dir);
+    EXPECT_FALSE(archive.open());
+    VirtualFileSystem vfs(test_dir);
+    EXPECT_FALSE(vfs.exists("data.bin"));
+}
+
+// Entries loaded from a pack are views of its mapping and outlive the VFS
+TEST_F(VFSTest, PackedEntriesOutliveTheirVFS) {
+    std::vector<unsigned char> data = createTestData("mapped content");
+    {
+        VirtualFileSystem vfs(test_dir);
+        ASSERT_TRUE(vfs.use_packed_storage());
+        vfs.add_file("mapped.txt", data.data(), data.size());
+        EXPECT_TRUE(vfs.save_to_disk());
+    }
+    VirtualFileSystem::FileHandle entry;
+    {
+        VirtualFileSystem vfs(test_dir);
+        entry = vfs.get_file("mapped.txt");
+    }
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(std::string(entry->data.begin(), entry->data.end()), "mapped content");
+}
+
+TEST_F(VFSTest, StaticFileReferencesDataWithoutCopy) {
+    static const unsigned char kAsset[] = {'<', 'h', '1', '>', 'h', 'i'};
+    VirtualFileSystem vfs;
+    vfs.add_static_file("index.html", kAsset, sizeof(kAsset));
+
+    auto entry = vfs.get_file("index.html");
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->data.data(), kAsset);
+    EXPECT_EQ(entry->data.size(), sizeof(kAsset));
+    EXPECT_FALSE(entry->data.is_owned());
+    EXPECT_EQ(entry->mime_type, "text/html");
+
+    // Copies of an entry share its bytes, owned or not
+    VirtualFileSystem::FileEntry copy = vfs.getFile("index.html");
+    EXPECT_EQ(copy.data.data(), kAsset);
+    std::vector<unsigned char> data = createTestData("heap");
+    vfs.add_file("heap.txt", data.data(), data.size());
+    auto heap = vfs.get_file("heap.txt");
+    EXPECT_TRUE(heap->data.is_owned());
+    EXPECT_NE(heap->data.data(), data.data());
+    EXPECT_EQ(vfs.getFile("heap.txt").data.data(), heap->data.data());
+}
+
+namespace {
+constexpr unsigned char kBlob[] = "<html></html>body{}let a;{}";
+// Tables as the generator emits them: records in slot order, then the
+// displacement of each bucket
+constexpr ResourcePackIndex<5> kIndex{
+    {{
+        {"empty.bin", 27, 0, "application/octet-stream", "\"e5\""},
+        {"data.json", 25, 2, "application/json", "\"e4\""},
+        {"index.html", 0, 13, "text/html", "\"e1\""},
+        {"style.css", 13, 6, "text/css", "\"e2\""},
+        {"assets/app.js", 19, 6, "application/javascript", "\"e3\""},
+    }},
+    {{-5, 1, 0, 0, 12}},
+};
+static_assert(kIndex.find("style.css") != nullptr);
+static_assert(kIndex.find("style.css")->offset == 13);
+static_assert(kIndex.find("missing.css") == nullptr);
+}  // namespace
+
+TEST_F(VFSTest, ResourcePackFindsEveryRecord) {
+    const ResourcePack pack(kBlob, sizeof(kBlob) - 1, kIndex);
+    EXPECT_EQ(pack.size(), 5);
+    for (const std::string_view path : {"index.html", "style.css", "assets/app.js", "data.json", "empty.bin"}) {
+        const ResourceRecord* record = pack.find(path);
+        ASSERT_NE(record, nullptr) << path;
+        EXPECT_EQ(record->path, path);
+    }
+    const auto contents = pack.contents(*pack.find("assets/app.js"));
+    EXPECT_EQ(std::string(contents.begin(), contents.end()), "let a;");
+    EXPECT_EQ(pack.find("assets/app.js")->mime_type, "application/javascript");
+    EXPECT_TRUE(pack.contents(*pack.find("empty.bin")).empty());
+    EXPECT_EQ(pack.find("assets"), nullptr);
+    EXPECT_EQ(pack.find(""), nullptr);
+
+    // A record pointing past the blob yields nothing instead of reading out of bounds
+    const ResourceRecord corrupt{"bad", 20, 100, "text/plain", ""};
+    EXPECT_TRUE(pack.contents(corrupt).empty());
+}
+
+TEST_F(VFSTest, SharedPathIndexCopiesStayIsolated) {
+    SharedPathIndex<int> index;
+    std::map<std::string, int> reference;
+    std::vector<std::pair<SharedPathIndex<int>, std::map<std::string, int>>> copies;
+    std::mt19937 rng(7);
+    for (int i = 0; i < 30000; i++) {
+        const std::string key = "dir" + std::to_string(rng() % 16) + "/file" + std::to_string(rng() % 300);
+        if (rng() % 3 == 0) {
+            EXPECT_EQ(index.erase(key), reference.erase(key) == 1);
+        } else {
+            EXPECT_EQ(index.insert_or_assign(key, i), !reference.contains(key));
+            reference[key] = i;
+        }
+        if (i % 5000 == 0) copies.emplace_back(index, reference);
+    }
+    ASSERT_EQ(index.size(), reference.size());
+    for (const auto& [key, value] : reference) {
+        const int* found = index.find(key);
+        ASSERT_NE(found, nullptr) << key;
+        EXPECT_EQ(*found, value);
+    }
+
+    for (const auto& [copy, expected] : copies) {
+        // each copy still holds exactly what the index held when it was taken
+        ASSERT_EQ(copy.size(), expected.size());
+        size_t visited = 0;
+        copy.for_each([&](const std::string& key, int value) {
+            EXPECT_EQ(expected.at(key), value);
+            visited++;
+        });
+        EXPECT_EQ(visited, expected.size());
+
+        // and diff() reports exactly the keys that changed since
+        std::map<std::string, std::pair<int, int>> changes;
+        SharedPathIndex<int>::diff(copy, index, [&](const std::string& key, const int* before, const int* after) {
+            EXPECT_TRUE(changes.emplace(key, std::pair(before ? *before : -1, after ? *after : -1)).second);
+        });
+        std::map<std::string, std::pair<int, int>> expected_changes;
+        for (const auto& [key, value] : expected) {
+            const auto now = reference.find(key);
+            if (now == reference.end()) {
+                expected_changes[key] = {value, -1};
+            } else if (now->second != value) {
+                expected_changes[key] = {value, now->second};
+            }
+        }
+        for (const auto& [key, value] : reference) {
+            if (!expected.contains(key)) expected_changes[key] = {-1, value};
+        }
+        EXPECT_EQ(changes, expected_changes);
+    }
+}
+
+TEST_F(VFSTest, SnapshotsCloneAndRestoreShareUnchangedEntries) {
+    std::vector<unsigned char> v1 = createTestData("version 1");
+    std::vector<unsigned char> v2 = createTestData("version 2");
+    VirtualFileSystem::Snapshot snapshot;
+    {
+        VirtualFileSystem vfs(test_dir);
+        for (int i = 0; i < 100; i++) {
+            vfs.add_file("docs/page" + std::to_string(i) + ".txt", v1.data(), v1.size());
+        }
+        vfs.add_file("notes.txt", v1.data(), v1.size());
+        snapshot = vfs.snapshot();
+        EXPECT_EQ(snapshot.size(), 101);
+
+        vfs.add_file("docs/page7.txt", v2.data(), v2.size());
+        vfs.remove_file("notes.txt");
+        vfs.add_file("drafts/new.txt", v2.data(), v2.size());
+
+        // the snapshot still sees the entries as they were, sharing the
+        // unchanged contents with the VFS
+        EXPECT_EQ(snapshot.get_file("docs/page7.txt")->data.size(), v1.size());
+        EXPECT_TRUE(snapshot.exists("notes.txt"));
+        EXPECT_FALSE(snapshot.exists("drafts/new.txt"));
+        EXPECT_EQ(snapshot.get_stored_file("docs/page8.txt"), vfs.get_stored_file("docs/page8.txt"));
+        EXPECT_EQ(snapshot.stat("docs").file_count, 100);
+        EXPECT_FALSE(snapshot.stat("drafts").exists);
+        EXPECT_EQ(snapshot.list_directory("").size(), 2);
+        EXPECT_EQ(vfs.list_directory("").size(), 2);
+        EXPECT_TRUE(vfs.stat("drafts").is_directory);
+
+        // a clone diverges from its source in both directions
+        auto copy = vfs.clone();
+        EXPECT_FALSE(copy->is_persistent());
+        copy->add_file("docs/page1.txt", v2.data(), v2.size());
+        vfs.remove_file("docs/page2.txt");
+        EXPECT_TRUE(copy->exists("docs/page2.txt"));
+        EXPECT_EQ(vfs.getFile("docs/page1.txt").data.size(), v1.size());
+        EXPECT_EQ(copy->stat("docs").file_count, 100);
+        EXPECT_EQ(vfs.stat("docs").file_count, 99);
+
+        // page7 and page2 come back, notes.txt is back and the draft goes
+        EXPECT_EQ(vfs.restore(snapshot), 4);
+        EXPECT_EQ(vfs.restore(snapshot), 0);
+        EXPECT_EQ(vfs.get_files().size(), 101);
+        const auto page7 = vfs.get_file("docs/page7.txt");
+        EXPECT_EQ(std::string(page7->data.begin(), page7->data.end()), "version 1");
+        EXPECT_FALSE(vfs.stat("drafts").exists);
+        EXPECT_TRUE(copy->exists("drafts/new.txt"));
+        ASSERT_TRUE(vfs.save_to_disk());
+    }
+
+    // the restore was saved like any other change
+    VirtualFileSystem reloaded(test_dir);
+    EXPECT_EQ(reloaded.get_files().size(), 101);
+    EXPECT_TRUE(reloaded.exists("notes.txt"));
+    EXPECT_FALSE(reloaded.exists("drafts/new.txt"));
+    EXPECT_EQ(reloaded.getFile("docs/page7.txt").data.size(), v1.size());
+    // the snapshot outlives the VFS it was taken from
+    EXPECT_EQ(snapshot.get_file("docs/page99.txt")->data.size(), v1.size());
+}
+
+TEST_F(VFSTest, SortedPathsAreCachedUntilPathsChange) {
+    VirtualFileSystem vfs;
+    std::vector<unsigned char> data = createTestData("x");
+    for (const char* path : {"b.txt", "a/z.txt", "c.txt", "a/b.txt"}) {
+        vfs.add_file(path, data.data(), data.size());
+    }
+    auto sorted = vfs.sorted_paths();
+    EXPECT_EQ(*sorted, (std::vector<std::string>{"a/b.txt", "a/z.txt", "b.txt", "c.txt"}));
+
+    // Replacing contents keeps the set of paths, so the view is reused
+    vfs.add_file("b.txt", data.data(), data.size());
+    EXPECT_EQ(vfs.sorted_paths(), sorted);
+
+    vfs.remove_file("a/z.txt");
+    auto updated = vfs.sorted_paths();
+    EXPECT_NE(updated, sorted);
+    EXPECT_EQ(*updated, (std::vector<std::string>{"a/b.txt", "b.txt", "c.txt"}));
+    // Views handed out earlier stay intact
+    EXPECT_EQ(sorted->size(), 4);
+}
+
+TEST_F(VFSTest, ContentStoreSharesIdenticalContentsAcrossInstances) {
+    auto store = std::make_shared<ContentStore>();
+    std::vector<unsigned char> vendor(64 * 1024, 'v');
+    std::vector<unsigned char> other = createTestData("different");
+
+    VirtualFileSystem main_vfs;
+    // Entries added before the store is attached are interned as well
+    main_vfs.add_file("vendor.js", vendor.data(), vendor.size());
+    main_vfs.use_content_store(store);
+    main_vfs.add_file("copy/vendor.js", vendor.data(), vendor.size());
+    main_vfs.add_file("other.txt", other.data(), other.size());
+
+    VirtualFileSystem custom;
+    custom.use_content_store(store);
+    custom.add_file("cached/vendor.js", vendor.data(), vendor.size());
+
+    auto a = main_vfs.get_file("vendor.js");
+    auto b = main_vfs.get_file("copy/vendor.js");
+    auto c = custom.get_file("cached/vendor.js");
+    EXPECT_EQ(a->data.data(), b->data.data());
+    EXPECT_EQ(a->data.data(), c->data.data());
+
+    ContentStore::Stats stats = store->stats();
+    EXPECT_EQ(stats.blobs, 2);
+    EXPECT_EQ(stats.references, 4);
+    EXPECT_EQ(stats.stored_bytes, vendor.size() + other.size());
+    EXPECT_EQ(stats.saved_bytes(), 2 * vendor.size());
+
+    // Replacing and removing entries releases their references
+    main_vfs.add_file("copy/vendor.js", other.data(), other.size());
+    custom.remove_file("cached/vendor.js");
+    // Handles still held keep their bytes, and their reference
+    EXPECT_EQ(c->data.size(), vendor.size());
+    EXPECT_EQ(c->data[0], 'v');
+    EXPECT_EQ(store->stats().references, 5);
+    b.reset();
+    c.reset();
+    stats = store->stats();
+    EXPECT_EQ(stats.references, 3);
+    EXPECT_EQ(stats.saved_bytes(), other.size());
+}
+
+TEST_F(VFSTest, PackedStorageStoresDuplicateContentsOnce) {
+    std::vector<unsigned char> image(256 * 1024, 'i');
+    image[0] = 'P';
+    {
+        VirtualFileSystem vfs(test_dir);
+        ASSERT_TRUE(vfs.use_packed_storage());
+        vfs.add_file("a/logo.png", image.data(), image.size());
+        vfs.add_file("b/logo.png", image.data(), image.size());
+        vfs.add_file("c/logo.png", image.data(), image.size());
+        ASSERT_TRUE(vfs.save_to_disk());
+    }
+    const auto pack_size = [this] {
+        uintmax_t total = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(test_dir)) {
+            if (entry.path().filename().string().starts_with(".membrane.pack.") &&
+                entry.path().extension() != ".idx") {
+                total += entry.file_size();
+            }
+        }
+        return total;
+    };
+    EXPECT_EQ(pack_size(), image.size());
+
+    {
+        VirtualFileSystem vfs(test_dir);
+        ASSERT_EQ(vfs.get_files().size(), 3);
+        EXPECT_EQ(vfs.get_file("c/logo.png")->data[0], 'P');
+        // Dropping some users of a shared extent keeps it for the others
+        vfs.remove_file("a/logo.png");
+        vfs.remove_file("b/logo.png");
+        ASSERT_TRUE(vfs.save_to_disk());
+    }
+    VirtualFileSystem vfs(test_dir);
+    ASSERT_EQ(vfs.get_files().size(), 1);
+    auto entry = vfs.get_file("c/logo.png");
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->data.size(), image.size());
+    EXPECT_EQ(entry->data[0], 'P');
+}
+
+TEST_F(VFSTest, MemoryBudgetSpillsLeastRecentlyReadEntries) {
+    VirtualFileSystem vfs;
+    std::vector<unsigned char> first(1024, 'a');
+    vfs.add_file("file0.bin", first.data(), first.size());
+    // Entries already present are counted once a budget is set
+    vfs.set_memory_budget(8 * 1024);
+    EXPECT_EQ(vfs.memory_stats().resident_bytes, 1024);
+
+    std::vector<std::vector<unsigned char>> contents{first};
+    for (int i = 1; i < 4; ++i) {
+        contents.emplace_back(1024, static_cast<unsigned char>('a' + i));
+        vfs.add_file("file" + std::to_string(i) + ".bin",
+                     contents.back().data(), contents.back().size());
+    }
+    // Borrowed contents are not counted
+    static const unsigned char logo[] = "compiled-in";
+    vfs.add_static_file("logo.txt", logo, sizeof(logo));
+    VirtualFileSystem::MemoryStats stats = vfs.memory_stats();
+    EXPECT_EQ(stats.resident_bytes, 4 * 1024);
+    EXPECT_EQ(stats.evictions, 0);
+
+    // Reading file0 makes file1 the least recently read
+    EXPECT_NE(vfs.get_file("file0.bin"), nullptr);
+    vfs.set_memory_budget(3 * 1024);
+    stats = vfs.memory_stats();
+    EXPECT_EQ(stats.evictions, 1);
+    EXPECT_EQ(stats.resident_bytes, 3 * 1024);
+    EXPECT_EQ(stats.spilled_bytes, 1024);
+
+    // A spilled entry reads back intact from the spill file
+    auto spilled = vfs.get_file("file1.bin");
+    ASSERT_NE(spilled, nullptr);
+    EXPECT_EQ(std::vector<unsigned char>(spilled->data.begin(),
+                                         spilled->data.end()),
+              contents[1]);
+    EXPECT_EQ(spilled->mime_type, "application/octet-stream");
+    EXPECT_EQ(vfs.get_file("logo.txt")->data.data(), logo);
+
+    // Adding past the budget evicts the least recently read entry
+    vfs.add_file("file4.bin", contents[0].data(), contents[0].size());
+    stats = vfs.memory_stats();
+    EXPECT_EQ(stats.evictions, 2);
+    EXPECT_EQ(stats.resident_bytes, 3 * 1024);
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_DOUBLE_EQ(stats.hit_rate(), 0.5);
+    auto second = vfs.get_file("file2.bin");
+    EXPECT_EQ(second->data[0], 'c');
+    EXPECT_EQ(vfs.memory_stats().misses, 2);
+
+    // Spill space is released with the last reference to the spilled copy
+    vfs.remove_file("file1.bin");
+    EXPECT_EQ(vfs.memory_stats().spilled_bytes, 2 * 1024);
+    spilled.reset();
+    EXPECT_EQ(vfs.memory_stats().spilled_bytes, 1024);
+
+    // Rewriting a spilled entry brings it back into memory
+    vfs.add_file("file2.bin", contents[2].data(), contents[2].size());
+    EXPECT_EQ(vfs.memory_stats().evictions, 3);
+    EXPECT_EQ(vfs.get_file("file2.bin")->data[0], 'c');
+
+    vfs.set_memory_budget(0);
+    stats = vfs.memory_stats();
+    EXPECT_EQ(stats.budget, 0);
+    EXPECT_EQ(stats.resident_bytes, 0);
+}
+
+TEST_F(VFSTest, CompressionStoresTextDeflatedAndReadsItBack) {
+    std::string page;
+    for (int i = 0; i < 200; ++i) {
+        page += "<div class=\"row\">item " + std::to_string(i) + "</div>\n";
+    }
+    const std::vector<unsigned char> html(page.begin(), page.end());
+    const std::vector<unsigned char> image(4096, 'p');
+    const std::vector<unsigned char> small = createTestData("tiny");
+    {
+        VirtualFileSystem vfs(test_dir);
+        vfs.add_file("before.html", html.data(), html.size());
+        vfs.use_compression(true);
+        EXPECT_TRUE(vfs.has_compression());
+        vfs.add_file("index.html", html.data(), html.size());
+        vfs.add_file("photo.png", image.data(), image.size());
+        vfs.add_file("small.css", small.data(), small.size());
+
+        // Text is stored deflated, including entries added before
+        for (const char *path : {"before.html", "index.html"}) {
+            const auto stored = vfs.get_stored_file(path);
+            ASSERT_TRUE(stored->compressed);
+            EXPECT_LT(stored->data.size(), html.size() / 3);
+            EXPECT_EQ(stored->original_size, html.size());
+            EXPECT_EQ(stored->mime_type, "text/html");
+        }
+        // Images and tiny entries are kept as they are
+        EXPECT_FALSE(vfs.get_stored_file("photo.png")->compressed);
+        EXPECT_FALSE(vfs.get_stored_file("small.css")->compressed);
+
+        // get_file inflates
+        const auto file = vfs.get_file("index.html");
+        EXPECT_FALSE(file->compressed);
+        EXPECT_EQ(std::vector<unsigned char>(file->data.begin(),
+                                             file->data.end()),
+                  html);
+        EXPECT_EQ(vfs.getFile("before.html").data.size(), html.size());
+        EXPECT_TRUE(vfs.save_to_disk());
+    }
+
+    // Saved files hold the uncompressed contents
+    std::ifstream saved(test_dir + "/index.html", std::ios::binary);
+    const std::string on_disk((std::istreambuf_iterator<char>(saved)),
+                              std::istreambuf_iterator<char>());
+    EXPECT_EQ(on_disk, page);
+
+    VirtualFileSystem reloaded(test_dir);
+    reloaded.use_compression(true);
+    EXPECT_TRUE(reloaded.get_stored_file("index.html")->compressed);
+    reloaded.use_compression(false);
+    const auto restored = reloaded.get_stored_file("index.html");
+    EXPECT_FALSE(restored->compressed);
+    EXPECT_EQ(restored->data.size(), html.size());
+}
+
+TEST_F(VFSTest, ListPagesThroughPrefixWithoutCopyingContents) {
+    VirtualFileSystem vfs;
+    const std::vector<unsigned char> data = createTestData("contents");
+    for (int i = 0; i < 25; ++i) {
+        const std::string name = (i < 10 ? "0" : "") + std::to_string(i);
+        vfs.add_file("images/" + name + ".png", data.data(), data.size());
+    }
+    vfs.add_file("image.txt", data.data(), data.size());
+    vfs.add_file("index.html", data.data(), data.size());
+
+    std::vector<std::string> listed;
+    std::string after;
+    int pages = 0;
+    do {
+        const VirtualFileSystem::ListPage page =
+            vfs.list("images/", after, 10);
+        EXPECT_LE(page.entries.size(), 10);
+        for (const auto &[path, entry] : page.entries) {
+            listed.push_back(path);
+            // Handles share the stored contents
+            EXPECT_EQ(entry->data.data(),
+                      vfs.get_stored_file(path)->data.data());
+        }
+        after = page.next_after;
+        ++pages;
+    } while (!after.empty());
+    EXPECT_EQ(pages, 3);
+    ASSERT_EQ(listed.size(), 25);
+    EXPECT_EQ(listed.front(), "images/00.png");
+    EXPECT_EQ(listed.back(), "images/24.png");
+    EXPECT_TRUE(std::ranges::is_sorted(listed));
+
+    EXPECT_TRUE(vfs.list("videos/").entries.empty());
+    EXPECT_EQ(vfs.list("").entries.size(), 27);
+    EXPECT_TRUE(vfs.list("images/", "images/24.png").entries.empty());
+
+    size_t visited = 0;
+    uint64_t total = 0;
+    vfs.for_each_file([&](const std::string &,
+                          const VirtualFileSystem::FileHandle &entry) {
+        ++visited;
+        total += entry->size();
+    });
+    EXPECT_EQ(visited, 27);
+    EXPECT_EQ(total, 27 * data.size());
+}
+
+TEST_F(VFSTest, DirectoryIndexListsStatsRemovesAndMovesSubtrees) {
+    VirtualFileSystem vfs(test_dir);
+    const std::vector<unsigned char> small = createTestData("1234");
+    const std::vector<unsigned char> large(100, 'x');
+    vfs.add_file("index.html", small.data(), small.size());
+    vfs.add_file("images/a.png", small.data(), small.size());
+    vfs.add_file("images/icons/b.png", large.data(), large.size());
+    vfs.add_file("images/icons/c.png", small.data(), small.size());
+    vfs.add_file("docs/readme.txt", large.data(), large.size());
+
+    const std::vector<DirectoryIndex::Child> root = vfs.list_directory("");
+    ASSERT_EQ(root.size(), 3);
+    EXPECT_EQ(root[0].name, "docs");
+    EXPECT_TRUE(root[0].is_directory);
+    EXPECT_EQ(root[1].name, "images");
+    EXPECT_EQ(root[1].size, 108);
+    EXPECT_EQ(root[1].file_count, 3);
+    EXPECT_EQ(root[2].name, "index.html");
+    EXPECT_FALSE(root[2].is_directory);
+    EXPECT_EQ(vfs.list_directory("images/").size(), 2);
+
+    DirectoryIndex::Stat stat = vfs.stat("images/icons");
+    EXPECT_TRUE(stat.exists);
+    EXPECT_TRUE(stat.is_directory);
+    EXPECT_EQ(stat.size, 104);
+    EXPECT_EQ(stat.file_count, 2);
+    EXPECT_EQ(vfs.stat("").size, 212);
+    EXPECT_FALSE(vfs.stat("images/icons/b.png").is_directory);
+    EXPECT_FALSE(vfs.stat("videos").exists);
+
+    // Replacing an entry updates the cached sizes
+    vfs.add_file("images/icons/b.png", small.data(), small.size());
+    EXPECT_EQ(vfs.stat("images").size, 12);
+
+    // Moving a directory carries its entries and their contents
+    const auto *contents = vfs.get_file("images/a.png")->data.data();
+    EXPECT_EQ(vfs.move("images", "media/pictures"), 3);
+    EXPECT_FALSE(vfs.stat("images").exists);
+    EXPECT_EQ(vfs.stat("media").file_count, 3);
+    EXPECT_EQ(vfs.get_file("media/pictures/a.png")->data.data(), contents);
+    EXPECT_EQ(vfs.move("index.html", "home.html"), 1);
+    EXPECT_TRUE(vfs.exists("home.html"));
+    EXPECT_EQ(vfs.move("missing", "elsewhere"), 0);
+
+    // Separators are normalised; the root can be a target but not a source
+    EXPECT_EQ(vfs.move("/docs/", "archive//"), 1);
+    EXPECT_TRUE(vfs.exists("archive/readme.txt"));
+    EXPECT_EQ(vfs.move("archive", "/"), 1);
+    EXPECT_TRUE(vfs.exists("readme.txt"));
+    EXPECT_EQ(vfs.move("readme.txt", ""), 0);
+    EXPECT_EQ(vfs.move("", "everything"), 0);
+    EXPECT_EQ(vfs.move("/", "everything"), 0);
+    EXPECT_EQ(vfs.move("readme.txt", "docs/readme.txt"), 1);
+    EXPECT_EQ(vfs.remove_tree(""), 0);
+    EXPECT_EQ(vfs.remove_tree("/"), 0);
+    EXPECT_EQ(vfs.stat("").file_count, 5);
+    EXPECT_EQ(vfs.remove_tree("/docs"), 1);
+    vfs.add_file("docs/readme.txt", large.data(), large.size());
+
+    // Removing a subtree drops empty directories with it
+    EXPECT_EQ(vfs.remove_tree("media/"), 3);
+    EXPECT_FALSE(vfs.stat("media").exists);
+    EXPECT_EQ(vfs.list_directory("").size(), 2);
+    EXPECT_EQ(vfs.stat("").file_count, 2);
+
+    EXPECT_TRUE(vfs.save_to_disk());
+    EXPECT_FALSE(std::filesystem::exists(test_dir + "/images/a.png"));
+    EXPECT_FALSE(std::filesystem::exists(test_dir + "/index.html"));
+    EXPECT_TRUE(std::filesystem::exists(test_dir + "/home.html"));
+}
+
+TEST_F(VFSTest, AppendAndOffsetWritesGrowChunkedEntries) {
+    std::string expected;
+    {
+        VirtualFileSystem vfs(test_dir);
+        ASSERT_TRUE(vfs.enable_write_ahead_log());
+        const std::vector<unsigned char> header = createTestData("header\n");
+        vfs.add_file("app.log", header.data(), header.size());
+        expected = "header\n";
+        const unsigned char *first_chunk =
+            vfs.get_stored_file("app.log")->data.data();
+
+        VirtualFileSystem::FileHandle early;
+        for (int i = 0; i < 2000; ++i) {
+            const std::string line = "line " + std::to_string(i) + "\n";
+            vfs.append_file("app.log",
+                            reinterpret_cast<const unsigned char *>(line.data()),
+                            line.size());
+            expected += line;
+            if (i == 9) early = vfs.get_stored_file("app.log");
+        }
+        const auto stored = vfs.get_stored_file("app.log");
+        EXPECT_EQ(stored->size(), expected.size());
+        // The original contents are still the first chunk, and the blocks
+        // after it grow geometrically
+        ASSERT_FALSE(stored->rope.empty());
+        EXPECT_EQ(stored->rope.chunks().front().data(), first_chunk);
+        EXPECT_LT(stored->rope.chunks().size(), 8);
+        std::string scattered;
+        for (const auto piece : stored->scatter()) {
+            scattered.append(piece.begin(), piece.end());
+        }
+        EXPECT_EQ(scattered, expected);
+        // A version read earlier keeps its own length and bytes
+        EXPECT_EQ(early->size(), expected.find("line 10\n"));
+
+        // Overwriting in the middle, and writing past the end
+        const std::vector<unsigned char> patch = createTestData("PATCH");
+        vfs.write_file("app.log", 7, patch.data(), patch.size());
+        expected.replace(7, 5, "PATCH");
+        vfs.write_file("app.log", expected.size() + 3, patch.data(),
+                       patch.size());
+        expected += std::string(3, '\0') + "PATCH";
+        const auto file = vfs.get_file("app.log");
+        EXPECT_TRUE(file->rope.empty());
+        EXPECT_EQ(std::string(file->data.begin(), file->data.end()), expected);
+        EXPECT_EQ(vfs.stat("app.log").size, expected.size());
+
+        vfs.write_file("new.txt", 2, patch.data(), patch.size());
+        EXPECT_EQ(vfs.getFile("new.txt").data.size(), 7);
+        // Closed without saving: the log holds every write
+    }
+
+    VirtualFileSystem recovered(test_dir);
+    ASSERT_TRUE(recovered.enable_write_ahead_log());
+    const auto file = recovered.get_file("app.log");
+    ASSERT_NE(file, nullptr);
+    EXPECT_EQ(std::string(file->data.begin(), file->data.end()), expected);
+    ASSERT_TRUE(recovered.save_to_disk());
+    std::ifstream saved(test_dir + "/app.log", std::ios::binary);
+    EXPECT_EQ(std::string((std::istreambuf_iterator<char>(saved)),
+                          std::istreambuf_iterator<char>()),
+              expected);
+}
+
+TEST_F(VFSTest, ConcurrentReadersSeeWholeVersions) {
+    VirtualFileSystem vfs;
+    constexpr int kPaths = 8;
+    // Every version of a file is one byte repeated, so a reader that sees
+    // two different bytes in one entry read a torn or freed buffer
+    auto publish = [&vfs](int path, unsigned char version) {
+        std::vector<unsigned char> data(4096 + path * 512, version);
+        vfs.add_file("file" + std::to_string(path) + ".bin", data.data(), data.size());
+    };
+    for (int i = 0; i < kPaths; i++) publish(i, 0);
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> torn{0};
+    std::atomic<long> reads{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; r++) {
+        readers.emplace_back([&, r] {
+            for (int i = r; !stop; i++) {
+                auto entry = vfs.get_file("file" + std::to_string(i % kPaths) + ".bin");
+                if (!entry) continue;
+                // Give writers a chance to replace the entry while it is held
+                std::this_thread::yield();
+                const unsigned char first = entry->data.front();
+                for (unsigned char byte : entry->data) {
+                    if (byte != first) {
+                        torn++;
+                        break;
+                    }
+                }
+                reads++;
+            }
+        });
+    }
+    std::vector<std::thread> writers;
+    for (int w = 0; w < 2; w++) {
+        writers.emplace_back([&, w] {
+            for (int v = 1; v <= 2000; v++) {
+                const int path = (v + w) % kPaths;
+                if (v % 7 == 0) {
+                    vfs.remove_file("file" + std::to_string(path) + ".bin");
+                }
+                publish(path, static_cast<unsigned char>(v));
+            }
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    stop = true;
+    for (auto& reader : readers) reader.join();
+
+    EXPECT_EQ(torn, 0);
+    EXPECT_GT(reads, 0);
+    EXPECT_EQ(vfs.get_files().size(), kPaths);
+}
+
+TEST_F(VFSTest, ParallelPersistenceRoundTrips) {
+    constexpr int kFiles = 200;
+    std::vector<unsigned char> data(4 * 1024, 'x');
+    {
+        VirtualFileSystem vfs(test_dir, 4);
+        EXPECT_EQ(vfs.io_threads(), 4);
+        for (int i = 0; i < kFiles; i++) {
+            data[0] = static_cast<unsigned char>(i);
+            vfs.add_file("dir" + std::to_string(i % 20) + "/file" + std::to_string(i) + ".bin",
+                         data.data(), data.size());
+        }
+        ASSERT_TRUE(vfs.save_to_disk());
+    }
+
+    VirtualFileSystem loaded(test_dir, 4);
+    ASSERT_EQ(loaded.get_files().size(), kFiles);
+    const auto file = loaded.get_file("dir7/file107.bin");
+    ASSERT_NE(file, nullptr);
+    ASSERT_EQ(file->data.size(), data.size());
+    EXPECT_EQ(file->data.data()[0], static_cast<unsigned char>(107));
+    EXPECT_EQ(VirtualFileSystem(test_dir).io_threads(), 1);
+}
+
+TEST_F(VFSTest, ZipEntriesAreServedFromTheArchive) {
+    std::string page = "<html>";
+    for (int i = 0; i < 200; i++) page += "<p>paragraph " + std::to_string(i) + "</p>";
+    const std::string image(300, '\x7f');
+    mz_zip_archive writer;
+    memset(&writer, 0, sizeof(writer));
+    ASSERT_TRUE(mz_zip_writer_init_heap(&writer, 0, 0));
+    ASSERT_TRUE(mz_zip_writer_add_mem(&writer, "dist/", nullptr, 0, 0));
+    ASSERT_TRUE(mz_zip_writer_add_mem(&writer, "dist/index.html", page.data(), page.size(),
+                                      MZ_BEST_COMPRESSION));
+    ASSERT_TRUE(mz_zip_writer_add_mem(&writer, "dist/img/logo.png", image.data(), image.size(),
+                                      MZ_NO_COMPRESSION));
+    void *heap = nullptr;
+    size_t heap_size = 0;
+    ASSERT_TRUE(mz_zip_writer_finalize_heap_archive(&writer, &heap, &heap_size));
+    const Buffer archive(std::vector<unsigned char>(static_cast<unsigned char *>(heap),
+                                                    static_cast<unsigned char *>(heap) + heap_size));
+    mz_free(heap);
+    mz_zip_writer_end(&writer);
+
+    VirtualFileSystem vfs;
+    EXPECT_EQ(vfs.add_zip(archive, true), 2u);
+    EXPECT_EQ(vfs.add_zip(createTestData("not a zip")), 0u);
+
+    // the stored entry is a view into the archive
+    const auto logo = vfs.get_stored_file("img/logo.png");
+    ASSERT_NE(logo, nullptr);
+    EXPECT_FALSE(logo->compressed);
+    EXPECT_GE(logo->data.data(), archive.data());
+    EXPECT_LE(logo->data.data() + logo->data.size(), archive.data() + archive.size());
+    EXPECT_EQ(std::string(logo->data.begin(), logo->data.end()), image);
+
+    // the deflated one stays compressed, and is inflated once while cached
+    const auto index = vfs.get_stored_file("index.html");
+    ASSERT_NE(index, nullptr);
+    EXPECT_TRUE(index->compressed);
+    EXPECT_TRUE(index->raw_deflate);
+    EXPECT_LT(index->data.size(), page.size());
+    EXPECT_EQ(index->size(), page.size());
+    EXPECT_EQ(vfs.stat("index.html").size, page.size());
+    const auto first = vfs.get_file("index.html");
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(std::string(first->data.begin(), first->data.end()), page);
+    EXPECT_EQ(vfs.get_file("index.html"), first);
+    EXPECT_EQ(vfs.list_directory("").size(), 2u);
+
+    // a cache too small for the contents inflates them on every read
+    vfs.set_inflate_cache_size(page.size() - 1);
+    const auto uncached = vfs.get_file("index.html");
+    EXPECT_NE(uncached, first);
+    EXPECT_EQ(std::string(uncached->data.begin(), uncached->data.end()), page);
+    EXPECT_NE(vfs.get_file("index.html"), uncached);
+
+    // saving writes the inflated contents
+    {
+        VirtualFileSystem persistent(test_dir);
+        persistent.add_zip(archive, true);
+        ASSERT_TRUE(persistent.save_to_disk());
+    }
+    VirtualFileSystem loaded(test_dir);
+    const auto saved = loaded.get_file("index.html");
+    ASSERT_NE(saved, nullptr);
+    EXPECT_EQ(std::string(saved->data.begin(), saved->data.end()), page);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,137 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "vfs.hpp"
+#include <miniz.h>
+
+#include <iostream>
+
+namespace {
+// below this, the zlib framing eats most of the gain
+constexpr size_t MIN_COMPRESSED_SIZE = 256;
+
+// formats that are compressed already gain nothing from deflate
+bool is_compressible(const std::string &mime_type) {
+    return mime_type.starts_with("text/") ||
+           mime_type == "application/javascript" ||
+           mime_type == "application/json" || mime_type == "image/svg+xml" ||
+           mime_type == "application/wasm";
+}
+}  // namespace
+
+VirtualFileSystem::FileEntry VirtualFileSystem::compress_entry(
+    FileEntry entry) {
+    const size_t size = entry.data.size();
+    if (entry.compressed || !entry.rope.empty() ||
+        size < MIN_COMPRESSED_SIZE ||
+        !is_compressible(entry.mime_type)) {
+        return entry;
+    }
+    std::vector<unsigned char> deflated(mz_compressBound(size));
+    mz_ulong deflated_size = deflated.size();
+    if (mz_compress2(deflated.data(), &deflated_size, entry.data.data(), size,
+                     MZ_DEFAULT_LEVEL) != MZ_OK ||
+        deflated_size >= size - size / 8) {
+        return entry;
+    }
+    deflated.resize(deflated_size);
+    deflated.shrink_to_fit();
+    entry.crc32 = static_cast<uint32_t>(mz_crc32(0, entry.data.data(), size));
+    entry.original_size = size;
+    entry.compressed = true;
+    entry.data = std::move(deflated);
+    return entry;
+}
+
+Buffer VirtualFileSystem::contents_of(const FileEntry &entry) {
+    if (!entry.rope.empty()) return entry.rope.flatten();
+    if (!entry.compressed) return entry.data;
+    std::vector<unsigned char> inflated(entry.original_size);
+    bool ok;
+    if (entry.raw_deflate) {
+        // a raw stream carries no checksum of its own; the CRC-32 from the
+        // archive catches a corrupt one
+        ok = tinfl_decompress_mem_to_mem(inflated.data(), inflated.size(),
+                                         entry.data.data(), entry.data.size(),
+                                         0) == entry.original_size &&
+             mz_crc32(0, inflated.data(), inflated.size()) == entry.crc32;
+    } else {
+        mz_ulong inflated_size = inflated.size();
+        ok = mz_uncompress(inflated.data(), &inflated_size, entry.data.data(),
+                           entry.data.size()) == MZ_OK &&
+             inflated_size == entry.original_size;
+    }
+    if (!ok) {
+        std::cerr << "Failed to inflate VFS entry" << std::endl;
+        return {};
+    }
+    return inflated;
+}
+
+VirtualFileSystem::FileHandle VirtualFileSystem::contiguous(
+    FileHandle entry) {
+    if (!entry || (!entry->compressed && entry->rope.empty())) return entry;
+    return std::make_shared<const FileEntry>(
+        FileEntry{contents_of(*entry), entry->mime_type});
+}
+
+VirtualFileSystem::FileHandle VirtualFileSystem::uncompressed(
+    FileHandle entry) const {
+    if (!entry || !entry->compressed) return contiguous(std::move(entry));
+    {
+        std::lock_guard lock(inflate_mutex);
+        if (const auto slot = inflate_slots.find(entry.get());
+            slot != inflate_slots.end()) {
+            inflate_order.splice(inflate_order.begin(), inflate_order,
+                                 slot->second);
+            return slot->second->inflated;
+        }
+    }
+    // inflated outside the lock; two readers racing on the same entry may
+    // both inflate it, and the second one's copy is dropped
+    FileHandle inflated = contiguous(entry);
+    const uint64_t limit = inflate_cache_size;
+    // a failed inflate is not cached, so it is retried and reported again
+    if (inflated->data.size() != entry->size() ||
+        inflated->data.size() > limit) {
+        return inflated;
+    }
+    std::lock_guard lock(inflate_mutex);
+    if (inflate_slots.contains(entry.get())) return inflated;
+    trim_inflate_cache(limit - inflated->data.size());
+    inflate_order.push_front({entry, inflated});
+    inflate_slots.emplace(entry.get(), inflate_order.begin());
+    inflated_bytes += inflated->data.size();
+    return inflated;
+}
+
+void VirtualFileSystem::set_inflate_cache_size(const uint64_t bytes) {
+    inflate_cache_size = bytes;
+    std::lock_guard lock(inflate_mutex);
+    trim_inflate_cache(bytes);
+}
+
+void VirtualFileSystem::trim_inflate_cache(const uint64_t limit) const {
+    while (inflated_bytes > limit) {
+        const InflateSlot &victim = inflate_order.back();
+        inflated_bytes -= victim.inflated->data.size();
+        inflate_slots.erase(victim.stored.get());
+        inflate_order.pop_back();
+    }
+}
+
+void VirtualFileSystem::use_compression(const bool enabled) {
+    if (compression.exchange(enabled) == enabled) return;
+    const auto store = content_store.load();
+    // entries written meanwhile were converted by their writer already
+    rewrite_entries([enabled, &store](const FileHandle &entry) {
+        if (entry->compressed == enabled) return entry;
+        FileEntry converted =
+            enabled ? compress_entry(*entry)
+                    : FileEntry{contents_of(*entry), entry->mime_type};
+        if (!converted.compressed && !entry->compressed) return entry;
+        if (store) converted.data = store->intern(std::move(converted.data));
+        return std::make_shared<const FileEntry>(std::move(converted));
+    });
+}
@@ -3,18 +3,58 @@
 // Copyright (c) 2025 Maxime Le Besnerais
 
 #include "vfs.hpp"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
+#include <ranges>
+#include <string_view>
 
-VirtualFileSystem::VirtualFileSystem(std::string dir_p)
+namespace {
+// directory the scratch file of an entry is written to before being
+// renamed over its final path. It is reserved like the other .membrane
+// names, so no user file is mistaken for a leftover of an interrupted
+// save; those are discarded on load.
+constexpr std::string_view TEMP_DIR = ".membrane-tmp";
+// names the scratch files of concurrent writers apart
+std::atomic<uint64_t> next_temp_file{0};
+// top-level names starting with this belong to the VFS itself (logs,
+// archives) and are never loaded as entries
+constexpr std::string_view RESERVED_PREFIX = ".membrane";
+
+bool read_whole_file(const std::filesystem::path &path,
+                     std::vector<unsigned char> &contents) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info {};
+    bool ok = ::fstat(fd, &info) == 0;
+    if (ok) contents.resize(static_cast<size_t>(info.st_size));
+    size_t done = 0;
+    while (ok && done < contents.size()) {
+        const ssize_t n =
+            ::read(fd, contents.data() + done, contents.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        // a file that shrank meanwhile is loaded as it is now
+        if (n == 0) contents.resize(done);
+        ok = n >= 0;
+        if (n > 0) done += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    return ok;
+}
+}  // namespace
+
+VirtualFileSystem::VirtualFileSystem(std::string dir_p,
+                                     const size_t io_threads)
     : enable_persistence(true), persistence_dir(std::move(dir_p)) {
     if (!std::filesystem::exists(persistence_dir) &&
-        !std::filesystem::create_directory(persistence_dir)) {
+        !std::filesystem::create_directories(persistence_dir)) {
         throw std::runtime_error("Failed to create persistence directory");
     }
+    set_io_threads(io_threads);
     if (!load_from_disk()) {
         std::cerr << "Failed to load files from disk" << std::endl;
     }
@@ -23,23 +63,249 @@ VirtualFileSystem::VirtualFileSystem(std::string dir_p)
 void VirtualFileSystem::add_file(const std::string &path,
                                  const unsigned char *data,
                                  const unsigned int len) {
-    const std::vector file_data(data, data + len);
-    files[path] = {file_data, get_mime_type(path)};
+    publish(path, std::vector(data, data + len));
+}
+
+void VirtualFileSystem::add_file(const std::string &path, Buffer data) {
+    publish(path, std::move(data));
+}
+
+void VirtualFileSystem::add_static_file(const std::string &path,
+                                        const unsigned char *data,
+                                        const unsigned int len) {
+    publish(path, Buffer::borrow(data, len));
+}
+
+void VirtualFileSystem::append_file(const std::string &path,
+                                    const unsigned char *data,
+                                    const unsigned int len) {
+    write_chunked(path, std::nullopt, {data, len});
+}
+
+void VirtualFileSystem::write_file(const std::string &path,
+                                   const uint64_t offset,
+                                   const unsigned char *data,
+                                   const unsigned int len) {
+    write_chunked(path, offset, {data, len});
+}
+
+void VirtualFileSystem::write_chunked(
+    const std::string &path, const std::optional<uint64_t> offset,
+    const std::span<const unsigned char> data) {
+    uint64_t seq;
+    {
+        // writers hold wal_mutex, so the entry written to is still the
+        // current one when the result replaces it
+        std::lock_guard wal_lock(wal_mutex);
+        FileHandle current;
+        {
+            std::shared_lock lock(state_mutex);
+            if (const FileHandle *found = files.find(path)) current = *found;
+        }
+        const uint64_t at =
+            offset ? *offset : (current ? current->size() : 0);
+        FileHandle entry = spliced_entry(path, current, at, data);
+        seq = wal_append(WalOp::Write, path, data.data(), data.size(), at);
+        std::lock_guard lock(state_mutex);
+        put_entry(path, std::move(entry));
+        removed_paths.erase(path);
+        dirty_paths.insert(path);
+    }
+    wal_commit(seq);
+    notify_change();
+}
+
+VirtualFileSystem::FileHandle VirtualFileSystem::spliced_entry(
+    const std::string &path, const FileHandle &current, const uint64_t offset,
+    const std::span<const unsigned char> data) {
+    FileEntry entry;
+    entry.mime_type = current ? current->mime_type : get_mime_type(path);
+    // a contiguous entry becomes the first chunk as it is
+    const Rope base = !current                ? Rope()
+                      : !current->rope.empty() ? current->rope
+                                               : Rope(contents_of(*current));
+    entry.rope = base.write(offset, data);
+    return std::make_shared<const FileEntry>(std::move(entry));
 }
 
-bool VirtualFileSystem::exists(const std::string &path) const {
+VirtualFileSystem::FileHandle VirtualFileSystem::make_entry(
+    const std::string &path, Buffer data) const {
+    FileEntry entry{std::move(data), get_mime_type(path)};
+    if (compression) {
+        entry = compress_entry(std::move(entry));
+    }
+    if (const auto store = content_store.load()) {
+        entry.data = store->intern(std::move(entry.data));
+    }
+    return std::make_shared<const FileEntry>(std::move(entry));
+}
+
+void VirtualFileSystem::publish(const std::string &path, Buffer data) {
+    // the log records the uncompressed contents
+    FileHandle entry = make_entry(path, data);
+    uint64_t seq;
+    {
+        std::lock_guard wal_lock(wal_mutex);
+        seq = wal_append(WalOp::Put, path, data.data(), data.size());
+        std::lock_guard lock(state_mutex);
+        put_entry(path, std::move(entry));
+        removed_paths.erase(path);
+        dirty_paths.insert(path);
+    }
+    wal_commit(seq);
+    notify_change();
+    enforce_memory_budget();
+}
+
+bool VirtualFileSystem::remove_file(const std::string &path) {
+    uint64_t seq;
+    {
+        std::lock_guard wal_lock(wal_mutex);
+        if (!exists(path)) {
+            return false;
+        }
+        seq = wal_append(WalOp::Remove, path, nullptr, 0);
+        std::lock_guard lock(state_mutex);
+        erase_entry(path);
+        dirty_paths.erase(path);
+        removed_paths.insert(path);
+    }
+    wal_commit(seq);
+    notify_change();
+    return true;
+}
+
+bool VirtualFileSystem::exists(const std::string_view path) const {
+    std::shared_lock lock(state_mutex);
     return files.contains(path);
 }
 
-const VirtualFileSystem::FileEntry *VirtualFileSystem::get_file(
-    const std::string &path) const {
-    const auto it = files.find(path);
-    if (it != files.end()) {
-        return &it->second;
+VirtualFileSystem::FileHandle VirtualFileSystem::get_file(
+    const std::string_view path) const {
+    // inflated outside the lock
+    return uncompressed(get_stored_file(path));
+}
+
+VirtualFileSystem::FileHandle VirtualFileSystem::get_stored_file(
+    const std::string_view path) const {
+    std::shared_lock lock(state_mutex);
+    if (const FileHandle *entry = files.find(path)) {
+        if (memory_budget != 0) note_access(path);
+        return *entry;
     }
     return nullptr;
 }
 
+std::map<std::string, VirtualFileSystem::FileHandle>
+VirtualFileSystem::get_files() const {
+    std::map<std::string, FileHandle> snapshot;
+    std::shared_lock lock(state_mutex);
+    files.for_each([&snapshot](const std::string &path,
+                               const FileHandle &entry) {
+        snapshot.emplace(path, entry);
+    });
+    return snapshot;
+}
+
+std::shared_ptr<const std::vector<std::string>>
+VirtualFileSystem::sorted_paths() const {
+    std::shared_lock lock(state_mutex);
+    std::lock_guard sorted_lock(sorted_mutex);
+    if (!sorted_cache) {
+        std::vector<std::string> paths;
+        paths.reserve(files.size());
+        files.for_each([&paths](const std::string &path, const FileHandle &) {
+            paths.push_back(path);
+        });
+        std::ranges::sort(paths);
+        sorted_cache =
+            std::make_shared<const std::vector<std::string>>(std::move(paths));
+    }
+    return sorted_cache;
+}
+
+VirtualFileSystem::ListPage VirtualFileSystem::list(
+    const std::string_view prefix, const std::string_view after,
+    const size_t limit) const {
+    const auto paths = sorted_paths();
+    auto it = std::ranges::lower_bound(*paths, prefix, std::less<>());
+    if (!after.empty()) {
+        it = std::max(it, std::ranges::upper_bound(*paths, after,
+                                                    std::less<>()));
+    }
+    ListPage page;
+    if (limit == 0) return page;
+    std::shared_lock lock(state_mutex);
+    for (; it != paths->end() && it->starts_with(prefix); ++it) {
+        if (page.entries.size() == limit) {
+            page.next_after = page.entries.back().path;
+            break;
+        }
+        // paths removed since the snapshot was taken are skipped
+        if (const FileHandle *entry = files.find(*it)) {
+            page.entries.push_back({*it, *entry});
+        }
+    }
+    return page;
+}
+
+void VirtualFileSystem::use_content_store(
+    std::shared_ptr<ContentStore> store) {
+    content_store.store(store);
+    if (!store) return;
+    // move the current contents into the store; entries changed meanwhile
+    // were interned by their writer already
+    rewrite_entries([&store](const FileHandle &entry) {
+        FileEntry interned = *entry;
+        interned.data = store->intern(entry->data);
+        return std::make_shared<const FileEntry>(std::move(interned));
+    });
+}
+
+void VirtualFileSystem::rewrite_entries(
+    const std::function<FileHandle(const FileHandle &)> &transform) {
+    std::vector<std::pair<std::string, FileHandle>> current;
+    {
+        std::shared_lock lock(state_mutex);
+        files.for_each([&current](const std::string &path,
+                                  const FileHandle &entry) {
+            current.emplace_back(path, entry);
+        });
+    }
+    for (auto &[path, entry] : current) {
+        FileHandle rewritten = transform(entry);
+        if (rewritten == entry) continue;
+        std::lock_guard lock(state_mutex);
+        if (const FileHandle *now = files.find(path); now && *now == entry) {
+            put_entry(path, std::move(rewritten));
+        }
+    }
+    enforce_memory_budget();
+}
+
+void VirtualFileSystem::put_entry(const std::string_view path,
+                                  FileHandle entry) {
+    if (memory_budget != 0) {
+        std::lock_guard lru_lock(lru_mutex);
+        track_entry(path, entry);
+    }
+    directories.insert(path, entry->size());
+    if (files.insert_or_assign(path, std::move(entry))) {
+        sorted_cache.reset();
+    }
+}
+
+bool VirtualFileSystem::erase_entry(const std::string_view path) {
+    if (!files.erase(path)) return false;
+    directories.erase(path);
+    if (memory_budget != 0) {
+        std::lock_guard lru_lock(lru_mutex);
+        untrack_entry(path);
+    }
+    sorted_cache.reset();
+    return true;
+}
+
 std::string VirtualFileSystem::get_mime_type(const std::string &path) {
     if (path.ends_with(".html")) return "text/html";
     if (path.ends_with(".css")) return "text/css";
@@ -53,6 +319,12 @@ std::string VirtualFileSystem::get_mime_type(const std::string &path) {
     return "application/octet-stream";
 }
 
+void VirtualFileSystem::set_io_threads(const size_t threads) {
+    // a pass already running keeps the pool it started with
+    io_pool.store(threads > 1 ? std::make_shared<ThreadPool>(threads)
+                              : nullptr);
+}
+
 bool VirtualFileSystem::save_to_disk() {
     if (!enable_persistence) {
         std::cerr << "Persistence is not enabled" << std::endl;
@@ -63,26 +335,169 @@ bool VirtualFileSystem::save_to_disk() {
         return false;
     }
     if (!std::filesystem::exists(persistence_dir) &&
-        !std::filesystem::create_directory(persistence_dir)) {
+        !std::filesystem::create_directories(persistence_dir)) {
         std::cerr << "Failed to create persistence directory" << std::endl;
         return false;
     }
-    for (const auto &[path, entry] : files) {
-        std::filesystem::path path_on_disk = persistence_dir + "/" + path;
-        if (!std::filesystem::exists(path_on_disk.parent_path()) &&
-            !std::filesystem::create_directories(path_on_disk.parent_path())) {
-            std::cerr << "Failed to create parent directory for "
-                      << path_on_disk << std::endl;
-            return false;
+    return save_pending(false);
+}
+
+// Takes the pending changes out of the dirty/removed sets, applies them to
+// disk, and puts back the ones that failed unless they changed meanwhile.
+// With a write-ahead log, the log is rotated first: once the pass succeeds
+// every record in the older generations is covered by the snapshot.
+bool VirtualFileSystem::save_pending(bool durable) {
+    std::lock_guard save_lock(save_mutex);
+    const uint64_t log_generation = rotate_wal();
+    // the snapshot replaces the log, so it must be as durable as the log
+    durable = durable || log_generation != 0;
+    std::vector<std::pair<std::string, FileHandle>> writes;
+    std::vector<std::string> removals;
+    {
+        std::lock_guard lock(state_mutex);
+        if (dirty_paths.empty() && removed_paths.empty()) {
+            if (log_generation != 0) {
+                drop_wal_generations_before(log_generation);
+            }
+            return true;
+        }
+        removals.assign(removed_paths.begin(), removed_paths.end());
+        removed_paths.clear();
+        writes.reserve(dirty_paths.size());
+        for (const auto &path : dirty_paths) {
+            if (const FileHandle *entry = files.find(path)) {
+                writes.emplace_back(path, *entry);
+            }
+        }
+        dirty_paths.clear();
+    }
+
+    std::vector<std::string> failed_removals;
+    std::vector<std::string> failed_writes;
+    if (pack) {
+        // a pack commit is all or nothing
+        if (!save_to_pack(writes, removals, durable)) {
+            failed_removals = removals;
+            for (const auto &path : writes | std::views::keys) {
+                failed_writes.push_back(path);
+            }
         }
-        std::ofstream file(path_on_disk, std::ios::binary);
-        if (!file.is_open()) {
-            std::cerr << "Failed to open file " << path_on_disk << std::endl;
+    } else {
+        // every file is independent, so they are removed and written in
+        // parallel; ok[i] records the outcome of task i
+        std::vector<char> ok(removals.size() + writes.size());
+        for_each_io(ok.size(), [&](const size_t i) {
+            if (i >= removals.size()) {
+                const auto &[path, entry] = writes[i - removals.size()];
+                ok[i] = write_entry_to_disk(path, *entry, durable);
+                return;
+            }
+            std::error_code ec;
+            std::filesystem::remove(persistence_dir + "/" + removals[i], ec);
+            if (ec) {
+                std::cerr << "Failed to remove file " << removals[i] << ": "
+                          << ec.message() << std::endl;
+            }
+            ok[i] = !ec;
+        });
+        std::unordered_set<std::string> touched_dirs;
+        for (size_t i = 0; i < ok.size(); ++i) {
+            const bool removal = i < removals.size();
+            const std::string &path =
+                removal ? removals[i] : writes[i - removals.size()].first;
+            if (!ok[i]) {
+                (removal ? failed_removals : failed_writes).push_back(path);
+            } else if (durable && !removal) {
+                touched_dirs.insert(
+                    std::filesystem::path(persistence_dir + "/" + path)
+                        .parent_path()
+                        .string());
+            }
+        }
+        // one directory fsync per batch makes the renames themselves durable
+        const std::vector<std::string> dirs(touched_dirs.begin(),
+                                            touched_dirs.end());
+        for_each_io(dirs.size(), [&dirs](const size_t i) {
+            if (const int fd = ::open(dirs[i].c_str(), O_RDONLY); fd >= 0) {
+                ::fsync(fd);
+                ::close(fd);
+            }
+        });
+    }
+
+    if (failed_removals.empty() && failed_writes.empty()) {
+        if (log_generation != 0) {
+            drop_wal_generations_before(log_generation);
+        }
+        return true;
+    }
+    std::lock_guard lock(state_mutex);
+    for (const auto &path : failed_removals) {
+        if (!files.contains(path)) removed_paths.insert(path);
+    }
+    for (const auto &path : failed_writes) {
+        if (files.contains(path)) dirty_paths.insert(path);
+    }
+    return false;
+}
+
+bool VirtualFileSystem::write_entry_to_disk(const std::string &path,
+                                            const FileEntry &entry,
+                                            const bool durable) const {
+    const std::filesystem::path path_on_disk = persistence_dir + "/" + path;
+    const std::filesystem::path temp_dir =
+        std::filesystem::path(persistence_dir) / TEMP_DIR;
+    const std::filesystem::path temp_path =
+        temp_dir / (std::to_string(::getpid()) + "-" +
+                    std::to_string(next_temp_file++));
+    // another writer may create the same directories concurrently
+    for (const auto &dir : {path_on_disk.parent_path(), temp_dir}) {
+        std::error_code dir_ec;
+        std::filesystem::create_directories(dir, dir_ec);
+        if (dir_ec && !std::filesystem::is_directory(dir, dir_ec)) {
+            std::cerr << "Failed to create directory " << dir << std::endl;
             return false;
         }
-        file.write(reinterpret_cast<const char *>(entry.data.data()),
-                   static_cast<long>(entry.data.size()));
-        file.close();
+    }
+    const int fd =
+        ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open file " << temp_path << std::endl;
+        return false;
+    }
+    // chunked entries are written chunk by chunk, without flattening them
+    const Buffer contents = entry.rope.empty() ? contents_of(entry) : Buffer();
+    const auto pieces = entry.rope.empty()
+                            ? std::vector{contents.span()}
+                            : entry.scatter();
+    bool ok = true;
+    for (const std::span<const unsigned char> piece : pieces) {
+        size_t written = 0;
+        while (written < piece.size()) {
+            const ssize_t n =
+                ::write(fd, piece.data() + written, piece.size() - written);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            written += static_cast<size_t>(n);
+        }
+        ok = ok && written == piece.size();
+    }
+    ok = ok && (!durable || ::fsync(fd) == 0);
+    ::close(fd);
+    std::error_code ec;
+    if (!ok) {
+        std::cerr << "Failed to write file " << temp_path << std::endl;
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+    std::filesystem::rename(temp_path, path_on_disk, ec);
+    if (ec) {
+        std::cerr << "Failed to rename " << temp_path << ": " << ec.message()
+                  << std::endl;
+        std::filesystem::remove(temp_path, ec);
+        return false;
     }
     return true;
 }
@@ -101,7 +516,15 @@ bool VirtualFileSystem::load_from_disk() {
         std::cerr << "Persistence directory does not exist" << std::endl;
         return false;
     }
+    if (pack || PackArchive::exists(persistence_dir)) {
+        return load_from_pack();
+    }
     try {
+        // scratch files left by an interrupted save
+        std::filesystem::remove_all(
+            std::filesystem::path(persistence_dir) / TEMP_DIR);
+        // the walk only collects paths; the files are read in parallel
+        std::vector<std::pair<std::filesystem::path, std::string>> to_load;
         for (const auto &entry :
              std::filesystem::recursive_directory_iterator(persistence_dir)) {
             if (!entry.is_regular_file()) {
@@ -111,28 +534,145 @@ bool VirtualFileSystem::load_from_disk() {
             std::string relative_path =
                 path.lexically_relative(persistence_dir).string();
             std::ranges::replace(relative_path, '\\', '/');
-
-            std::ifstream file_stream(path, std::ios::binary);
-            if (!file_stream.is_open()) {
-                std::cerr << "Failed to open file " << path << std::endl;
-                return false;
+            if (relative_path.starts_with(RESERVED_PREFIX)) {
+                continue;
             }
+            to_load.emplace_back(path, std::move(relative_path));
+        }
 
-            file_stream.seekg(0, std::ios::end);
-            const auto file_size = file_stream.tellg();
-            file_stream.seekg(0, std::ios::beg);
-
-            std::vector<unsigned char> file_data(file_size);
-            file_stream.read(reinterpret_cast<char *>(file_data.data()),
-                             file_size);
-            file_stream.close();
-
-            files[relative_path] = {file_data, get_mime_type(relative_path)};
+        std::vector<FileHandle> entries(to_load.size());
+        for_each_io(to_load.size(), [&](const size_t i) {
+            const auto &[path, relative_path] = to_load[i];
+            std::vector<unsigned char> file_data;
+            if (!read_whole_file(path, file_data)) {
+                std::cerr << "Failed to read file " << path << std::endl;
+                return;
+            }
+            entries[i] = make_entry(relative_path, std::move(file_data));
+        });
+        bool loaded = true;
+        {
+            std::lock_guard lock(state_mutex);
+            for (size_t i = 0; i < entries.size(); ++i) {
+                if (!entries[i]) {
+                    loaded = false;
+                    continue;
+                }
+                const std::string &relative_path = to_load[i].second;
+                put_entry(relative_path, std::move(entries[i]));
+                dirty_paths.erase(relative_path);
+                removed_paths.erase(relative_path);
+            }
         }
-        return true;
+        return loaded;
     } catch (const std::exception &e) {
         std::cerr << "Failed to load files from disk: " << e.what()
                   << std::endl;
         return false;
     }
 }
+
+bool VirtualFileSystem::save_to_pack(
+    const std::vector<std::pair<std::string, FileHandle>> &writes,
+    const std::vector<std::string> &removals, const bool durable) {
+    for (const auto &path : removals) {
+        pack->remove(path);
+    }
+    for (const auto &[path, entry] : writes) {
+        const Buffer contents = contents_of(*entry);
+        if (!pack->append(path, contents.data(), contents.size())) {
+            return false;
+        }
+    }
+    if (!pack->commit(durable)) {
+        return false;
+    }
+    // reclaim space once replaced and removed contents outweigh live ones
+    if (pack->garbage_bytes() > pack->live_bytes() &&
+        pack->garbage_bytes() > 1024 * 1024 && !pack->compact()) {
+        std::cerr << "Failed to compact pack in " << persistence_dir
+                  << std::endl;
+    }
+    return true;
+}
+
+bool VirtualFileSystem::load_from_pack() {
+    std::lock_guard save_lock(save_mutex);
+    if (!pack) {
+        auto archive = std::make_unique<PackArchive>(persistence_dir);
+        if (!archive->open()) {
+            return false;
+        }
+        pack = std::move(archive);
+    }
+    std::lock_guard lock(state_mutex);
+    // entries are views of the mapped pack, which they keep alive
+    pack->for_each([this](const std::string &path,
+                          const std::span<const unsigned char> data,
+                          const std::shared_ptr<const void> &owner) {
+        put_entry(path, make_entry(path, Buffer(data.data(), data.size(),
+                                                owner)));
+        dirty_paths.erase(path);
+        removed_paths.erase(path);
+    });
+    return true;
+}
+
+bool VirtualFileSystem::use_packed_storage() {
+    if (!enable_persistence) {
+        std::cerr << "Persistence is not enabled" << std::endl;
+        return false;
+    }
+    std::lock_guard save_lock(save_mutex);
+    if (pack) {
+        return true;
+    }
+    auto archive = std::make_unique<PackArchive>(persistence_dir);
+    if (!archive->open()) {
+        return false;
+    }
+    // written from a snapshot of the handles, so readers and writers go on
+    // while the pack is built
+    std::unordered_map<std::string, FileHandle> snapshot;
+    {
+        std::shared_lock lock(state_mutex);
+        files.for_each([&](const std::string &path, const FileHandle &entry) {
+            snapshot.emplace(path, entry);
+        });
+    }
+    for (const auto &[path, entry] : snapshot) {
+        const Buffer contents = contents_of(*entry);
+        if (!archive->append(path, contents.data(), contents.size())) {
+            return false;
+        }
+    }
+    if (!archive->commit(true)) {
+        return false;
+    }
+    std::vector<std::string> loose_files;
+    loose_files.reserve(snapshot.size());
+    for (const auto &path : snapshot | std::views::keys) {
+        loose_files.push_back(path);
+    }
+    {
+        std::lock_guard lock(state_mutex);
+        // the pack holds the snapshot; what changed since stays pending
+        std::erase_if(dirty_paths, [&](const std::string &path) {
+            const FileHandle *entry = files.find(path);
+            const auto packed = snapshot.find(path);
+            return entry && packed != snapshot.end() &&
+                   *entry == packed->second;
+        });
+        std::erase_if(removed_paths, [&](const std::string &path) {
+            if (snapshot.contains(path)) return false;
+            loose_files.push_back(path);
+            return true;
+        });
+        pack = std::move(archive);
+    }
+    for (const auto &path : loose_files) {
+        std::error_code ec;
+        std::filesystem::remove(persistence_dir + "/" + path, ec);
+    }
+    return true;
+}
@@ -0,0 +1,130 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "vfs.hpp"
+#include <algorithm>
+
+namespace {
+// a directory or entry path as stored, without leading or trailing '/'
+std::string_view trim_dir(std::string_view path) {
+    while (path.starts_with('/')) path.remove_prefix(1);
+    while (path.ends_with('/')) path.remove_suffix(1);
+    return path;
+}
+}  // namespace
+
+DirectoryIndex::Stat VirtualFileSystem::stat(
+    const std::string_view path) const {
+    std::shared_lock lock(state_mutex);
+    return directories.stat(path);
+}
+
+std::vector<DirectoryIndex::Child> VirtualFileSystem::list_directory(
+    const std::string_view dir) const {
+    std::shared_lock lock(state_mutex);
+    return directories.list(dir);
+}
+
+std::vector<std::string> VirtualFileSystem::tree_paths(
+    const std::string_view path) const {
+    std::vector<std::string> paths = directories.files_under(path);
+    if (files.contains(path)) paths.emplace_back(path);
+    return paths;
+}
+
+size_t VirtualFileSystem::remove_tree(std::string_view path) {
+    path = trim_dir(path);
+    // the root would be every entry
+    if (path.empty()) return 0;
+    std::vector<std::string> paths;
+    uint64_t seq = 0;
+    {
+        std::lock_guard wal_lock(wal_mutex);
+        {
+            std::shared_lock lock(state_mutex);
+            paths = tree_paths(path);
+        }
+        if (paths.empty()) return 0;
+        for (const auto &removed : paths) {
+            seq = std::max(seq, wal_append(WalOp::Remove, removed, nullptr, 0));
+        }
+        std::lock_guard lock(state_mutex);
+        for (const auto &removed : paths) {
+            erase_entry(removed);
+            dirty_paths.erase(removed);
+            removed_paths.insert(removed);
+        }
+    }
+    wal_commit(seq);
+    notify_change();
+    return paths.size();
+}
+
+size_t VirtualFileSystem::move(std::string_view from, std::string_view to) {
+    from = trim_dir(from);
+    to = trim_dir(to);
+    if (from.empty() || from == to) return 0;
+    std::vector<std::pair<std::string, FileHandle>> moved;
+    std::vector<std::string> sources;
+    uint64_t seq = 0;
+    {
+        // writers hold wal_mutex, so the entries cannot change until the
+        // move is applied
+        std::lock_guard wal_lock(wal_mutex);
+        {
+            std::shared_lock lock(state_mutex);
+            sources = tree_paths(from);
+            for (const auto &source : sources) {
+                // empty for from itself, else "/" and the path below it
+                const std::string_view rest =
+                    std::string_view(source).substr(from.size());
+                std::string target(to);
+                if (!rest.empty()) {
+                    if (!target.empty()) target += '/';
+                    target += rest.substr(1);
+                }
+                // an entry cannot become the root
+                if (target.empty()) return 0;
+                FileHandle entry = *files.find(source);
+                // the contents are shared; only the type may change
+                if (std::string mime_type = get_mime_type(target);
+                    mime_type != entry->mime_type) {
+                    FileEntry retyped = *entry;
+                    retyped.mime_type = std::move(mime_type);
+                    entry = std::make_shared<const FileEntry>(
+                        std::move(retyped));
+                }
+                moved.emplace_back(std::move(target), std::move(entry));
+            }
+        }
+        if (sources.empty()) return 0;
+        // removals first, so a source that is also a target keeps the
+        // entry moved onto it, in the log as in memory
+        for (const auto &source : sources) {
+            seq = std::max(seq, wal_append(WalOp::Remove, source, nullptr, 0));
+        }
+        if (wal_enabled) {
+            for (const auto &[target, entry] : moved) {
+                const Buffer contents = contents_of(*entry);
+                seq = std::max(seq, wal_append(WalOp::Put, target,
+                                               contents.data(),
+                                               contents.size()));
+            }
+        }
+        std::lock_guard lock(state_mutex);
+        for (const auto &source : sources) {
+            erase_entry(source);
+            dirty_paths.erase(source);
+            removed_paths.insert(source);
+        }
+        for (auto &[target, entry] : moved) {
+            put_entry(target, std::move(entry));
+            removed_paths.erase(target);
+            dirty_paths.insert(target);
+        }
+    }
+    wal_commit(seq);
+    notify_change();
+    return moved.size();
+}
@@ -4,63 +4,528 @@
 
 #ifndef VFS_HPP
 #define VFS_HPP
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <iostream>
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
+#include "Buffer.hpp"
+#include "ContentStore.hpp"
+#include "DirectoryIndex.hpp"
+#include "PackArchive.hpp"
+#include "Rope.hpp"
+#include "SharedPathIndex.hpp"
+#include "SpillFile.hpp"
+#include "ThreadPool.hpp"
 
 class VirtualFileSystem {
 public:
     struct FileEntry {
-        std::vector<unsigned char> data;
+        Buffer data;
         std::string mime_type;
+        // data holds the contents deflated in the zlib format; original_size
+        // and crc32 describe the uncompressed contents
+        bool compressed = false;
+        uint64_t original_size = 0;
+        uint32_t crc32 = 0;
+        // with compressed: data is a raw deflate stream, as a ZIP entry
+        // holds it, instead of the zlib format
+        bool raw_deflate = false;
+        // chunked entries, grown by append_file() and write_file(): the
+        // contents are the rope's chunks, and data is empty
+        Rope rope{};
+
+        // size of the contents, uncompressed
+        [[nodiscard]] uint64_t size() const {
+            if (!rope.empty()) return rope.size();
+            return compressed ? original_size : data.size();
+        }
+        // the stored bytes as a list of pieces, without copying
+        [[nodiscard]] std::vector<std::span<const unsigned char>> scatter()
+            const {
+            if (rope.empty()) return {data.span()};
+            std::vector<std::span<const unsigned char>> pieces;
+            pieces.reserve(rope.chunks().size());
+            for (const Buffer &chunk : rope.chunks()) {
+                pieces.push_back(chunk.span());
+            }
+            return pieces;
+        }
+    };
+    // entries are immutable once published: a writer replaces the handle
+    // in the index, and a reader keeps the version it looked up alive for
+    // as long as it holds the handle
+    using FileHandle = std::shared_ptr<const FileEntry>;
+
+    // a listed entry; the handle shares the entry's contents
+    struct ListedEntry {
+        std::string path;
+        FileHandle entry;
+    };
+    struct ListPage {
+        std::vector<ListedEntry> entries;
+        // pass as `after` to get the next page; empty on the last one
+        std::string next_after;
+    };
+
+    struct MemoryStats {
+        uint64_t budget = 0;
+        // contents held in memory and subject to eviction
+        uint64_t resident_bytes = 0;
+        // contents moved out to the spill file
+        uint64_t spilled_bytes = 0;
+        // get_file on a resident entry, and on a spilled one
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+
+        [[nodiscard]] double hit_rate() const {
+            return hits + misses == 0
+                       ? 1.0
+                       : static_cast<double>(hits) /
+                             static_cast<double>(hits + misses);
+        }
     };
 
+    // a read-only, point-in-time view of the entries. It shares the path
+    // index, the directory trie and the contents with the VFS, which
+    // copies only what it changes afterwards, so taking one is O(1). It
+    // needs no locking and may outlive the VFS. Contents it keeps alive are
+    // not counted against the memory budget.
+    class Snapshot {
+    public:
+        [[nodiscard]] FileHandle get_stored_file(
+            const std::string_view path) const {
+            const FileHandle *entry = files.find(path);
+            return entry ? *entry : nullptr;
+        }
+        [[nodiscard]] FileHandle get_file(const std::string_view path) const {
+            return contiguous(get_stored_file(path));
+        }
+        [[nodiscard]] bool exists(const std::string_view path) const {
+            return files.contains(path);
+        }
+        [[nodiscard]] size_t size() const {
+            return files.size();
+        }
+        [[nodiscard]] DirectoryIndex::Stat stat(
+            const std::string_view path) const {
+            return directories.stat(path);
+        }
+        [[nodiscard]] std::vector<DirectoryIndex::Child> list_directory(
+            const std::string_view dir) const {
+            return directories.list(dir);
+        }
+        // calls callback(path, handle) for every entry, in no particular
+        // order
+        template <typename Callback>
+        void for_each_file(Callback &&callback) const {
+            files.for_each(callback);
+        }
+
+    private:
+        friend class VirtualFileSystem;
+        SharedPathIndex<FileHandle> files;
+        DirectoryIndex directories;
+    };
+
+    // files read or written at once by load_from_disk() and save_to_disk();
+    // a pool measured no faster than one thread on local disks (see
+    // vfs_benchmark), so it is opt-in
+    static constexpr size_t DEFAULT_IO_THREADS = 1;
+    // inflated contents get_file() keeps for compressed entries
+    static constexpr uint64_t DEFAULT_INFLATE_CACHE_SIZE = 16 * 1024 * 1024;
+
     VirtualFileSystem() : enable_persistence(false) {}
-    explicit VirtualFileSystem(std::string persistence_dir);
+    explicit VirtualFileSystem(std::string persistence_dir,
+                               size_t io_threads = DEFAULT_IO_THREADS);
+    // an in-memory VFS starting from the entries of snapshot, which it
+    // shares until either side changes them
+    explicit VirtualFileSystem(const Snapshot &snapshot);
 
     ~VirtualFileSystem() {
-        if (enable_persistence) {
+        stop_background_persistence();
+        if (enable_persistence && has_unsaved_changes()) {
             if (!save_to_disk()) {
                 std::cerr << "Failed to save files to disk" << std::endl;
             }
         }
+        disable_write_ahead_log();
     }
 
     void add_file(const std::string &path, const unsigned char *data,
                   unsigned int len);
-    [[nodiscard]] bool exists(const std::string &path) const;
-    [[nodiscard]] const FileEntry *get_file(const std::string &path) const;
+    // adds an entry holding data itself; nothing is copied
+    void add_file(const std::string &path, Buffer data);
+    // adds every file of the ZIP archive as an entry over its bytes in
+    // archive, from the central directory alone: nothing is extracted or
+    // copied. Stored files are served as they are, deflated ones stay
+    // compressed and are inflated when read. With strip_root, the first
+    // component of names that have one is dropped. Returns how many
+    // entries were added; an archive that cannot be read adds none.
+    size_t add_zip(Buffer archive, bool strip_root = false);
+    // adds an entry that points at data instead of copying it; data must
+    // outlive the VFS, as compiled-in resource arrays do
+    void add_static_file(const std::string &path, const unsigned char *data,
+                         unsigned int len);
+    // appends to the entry at path, creating it if needed. The entry
+    // becomes chunked: its current contents are neither copied nor
+    // reallocated, so repeated appends cost the appended bytes only.
+    void append_file(const std::string &path, const unsigned char *data,
+                     unsigned int len);
+    // writes data at offset into the entry at path, creating it if needed
+    // and zero-filling a gap past its end; only data itself is copied
+    void write_file(const std::string &path, uint64_t offset,
+                    const unsigned char *data, unsigned int len);
+    // removes an entry; the file on disk is deleted on the next save
+    bool remove_file(const std::string &path);
+    [[nodiscard]] bool exists(std::string_view path) const;
+    // a single hashed lookup; prefer it over exists() followed by get_file()
+    // Chunked entries are copied into one contiguous buffer on each call;
+    // compressed ones are inflated through the inflate cache.
+    [[nodiscard]] FileHandle get_file(std::string_view path) const;
+    // like get_file, but entries are returned as stored: compressed ones
+    // deflated, chunked ones as their chunks (see FileEntry::scatter)
+    [[nodiscard]] FileHandle get_stored_file(std::string_view path) const;
+    // entry itself, or a copy of it with its uncompressed contents in data
+    // if it is compressed or chunked
+    [[nodiscard]] static FileHandle contiguous(FileHandle entry);
+    // like contiguous(), but a compressed entry read recently is not
+    // inflated again
+    [[nodiscard]] FileHandle uncompressed(FileHandle entry) const;
+    // bounds the inflated contents kept for compressed entries; the least
+    // recently read go first. 0 disables the cache.
+    void set_inflate_cache_size(uint64_t bytes);
     // persistence functions
     void set_persistence_dir(const std::string &dir) {
         persistence_dir = dir;
     }
+    // writes only the entries changed since the last save, and deletes
+    // the removed ones; a save with nothing pending is a no-op
     bool save_to_disk();
+    [[nodiscard]] bool has_unsaved_changes() const {
+        std::shared_lock lock(state_mutex);
+        return !dirty_paths.empty() || !removed_paths.empty();
+    }
+    // background persistence: changes are coalesced until no mutation
+    // happened for `debounce`, then written and fsynced off the caller's
+    // thread in a single pass
+    bool start_background_persistence(std::chrono::milliseconds debounce);
+    void stop_background_persistence();
+    [[nodiscard]] bool has_background_persistence() const {
+        return background_persistence;
+    }
+    // asks the persister to write pending changes without waiting for the
+    // debounce window; does not block
+    void request_save();
+    // blocks until every change made before the call is on disk
+    bool flush();
+    // write-ahead log: every mutation is appended to a checksummed log
+    // before it is applied, and the log is replayed when this is called on
+    // the next run. A background thread fsyncs the log at most once per
+    // sync_interval, so mutations return without waiting for the disk and
+    // are durable at the latest one interval later. With a zero
+    // sync_interval each mutation is durable on return instead, the calling
+    // thread waiting for an fsync it shares with concurrent writers. Saves
+    // fold the log into the snapshot, and a log larger than
+    // compact_after_bytes triggers one. A mutation the log cannot take is
+    // saved at once instead.
+    static constexpr std::chrono::milliseconds DEFAULT_WAL_SYNC_INTERVAL{10};
+    bool enable_write_ahead_log(
+        std::chrono::milliseconds sync_interval = DEFAULT_WAL_SYNC_INTERVAL,
+        uint64_t compact_after_bytes = 16 * 1024 * 1024);
+    void disable_write_ahead_log();
+    [[nodiscard]] bool has_write_ahead_log() const {
+        return wal_enabled;
+    }
+    // content deduplication: contents are interned in store, which may be
+    // shared with other instances, so identical bytes are held once.
+    // Applies to the current entries too; nullptr stops interning.
+    void use_content_store(std::shared_ptr<ContentStore> store);
+    // memory budget: once the contents held in memory exceed bytes, the
+    // least recently read entries are moved to a spill file and read back
+    // from its mapping by the kernel when accessed. Compiled-in contents
+    // are not counted. 0 disables the budget.
+    void set_memory_budget(uint64_t bytes);
+    [[nodiscard]] MemoryStats memory_stats() const;
+    // compression at rest: text-like entries are stored deflated when that
+    // saves space. Applies to the current entries too. Saves, the
+    // write-ahead log and get_file() still see the uncompressed contents.
+    void use_compression(bool enabled);
+    [[nodiscard]] bool has_compression() const {
+        return compression;
+    }
+    // packed storage: entries are kept in one data file plus a sorted index
+    // instead of one file each. Converts the current contents, including a
+    // directory loaded in the per-file layout, and removes the loose files.
+    // A directory holding a pack is opened in packed mode automatically.
+    bool use_packed_storage();
+    [[nodiscard]] bool has_packed_storage() const {
+        return pack != nullptr;
+    }
+    // number of files load_from_disk() and save_to_disk() work on at
+    // once; 1 reads and writes them one after another
+    void set_io_threads(size_t threads);
+    [[nodiscard]] size_t io_threads() const {
+        const auto pool = io_pool.load();
+        return pool ? pool->size() : 1;
+    }
     // load from disk
     [[nodiscard]] bool load_from_disk();
-    // get current files
-    [[nodiscard]] const std::map<std::string, FileEntry> &get_files() const {
-        return files;
+    // snapshot of the current entries; only the handles are copied, and
+    // compressed entries are returned as stored
+    [[nodiscard]] std::map<std::string, FileHandle> get_files() const;
+    // every path in order; built on first use after the set of paths
+    // changed and shared until it changes again
+    [[nodiscard]] std::shared_ptr<const std::vector<std::string>>
+    sorted_paths() const;
+    // up to limit entries whose path starts with prefix, in path order and
+    // after the path `after`. Costs a binary search plus the page, and
+    // copies only handles; compressed entries are returned as stored.
+    [[nodiscard]] ListPage list(std::string_view prefix,
+                                std::string_view after = {},
+                                size_t limit = SIZE_MAX) const;
+    // directory view: paths are split on '/', and a directory exists while
+    // some entry is below it. Sizes are uncompressed and cached per
+    // directory, so none of these scan unrelated entries.
+    [[nodiscard]] DirectoryIndex::Stat stat(std::string_view path) const;
+    [[nodiscard]] std::vector<DirectoryIndex::Child> list_directory(
+        std::string_view dir) const;
+    // removes the entry at path and every entry below it as one change;
+    // returns how many entries were removed. Leading and trailing '/' are
+    // ignored, and the root is never removed.
+    size_t remove_tree(std::string_view path);
+    // moves the entry at from, and every entry below it, to the same place
+    // under to, replacing what is there; contents are not copied. Both are
+    // taken as directories, '/' and "" for to being the root; from must not
+    // be the root. Returns how many entries were moved, 0 for none.
+    size_t move(std::string_view from, std::string_view to);
+    // the current entries as a Snapshot, in O(1)
+    [[nodiscard]] Snapshot snapshot() const;
+    // an in-memory copy of this VFS with the same compression and content
+    // store, in O(1); the two share their entries until they diverge
+    [[nodiscard]] std::unique_ptr<VirtualFileSystem> clone() const;
+    // makes the entries what they were in snapshot, as one change that is
+    // logged and saved like any other. Costs the number of entries that
+    // differ, which is returned.
+    size_t restore(const Snapshot &snapshot);
+    // calls callback(path, handle) for every entry without copying
+    // anything, in no particular order. Runs under the read lock, so
+    // callback must not modify this VFS.
+    template <typename Callback>
+    void for_each_file(Callback &&callback) const {
+        std::shared_lock lock(state_mutex);
+        files.for_each(callback);
     }
     [[nodiscard]] bool is_persistent() const {
         return enable_persistence;
     }
+    // copies of every entry, uncompressed; prefer list() or for_each_file()
     inline std::map<std::string, FileEntry> get_allFiles() {
-        return files;
+        std::map<std::string, FileEntry> copy;
+        for (const auto &[path, entry] : get_files()) {
+            copy.emplace(path, *contiguous(entry));
+        }
+        return copy;
     };
     inline FileEntry getFile(std::string path) {
-        if (files.find(path) != files.end()) {
-            return files[path];
+        if (const FileHandle entry = get_file(path)) {
+            return *entry;
         }
-        return {.data = {}, .mime_type = ""};
+        return {};
     };
 
 private:
     const bool enable_persistence;
-    std::map<std::string, FileEntry> files;
+    // guards files, dirty_paths and removed_paths. Readers share it and
+    // writers hold it only to swap a handle, never while copying contents
+    // or doing I/O
+    mutable std::shared_mutex state_mutex;
+    SharedPathIndex<FileHandle> files;
+    // directory trie over the paths in files
+    DirectoryIndex directories;
+    // lazily built by sorted_paths() under a shared lock, so guarded by
+    // sorted_mutex as well; reset by writers when a path is added or removed
+    mutable std::mutex sorted_mutex;
+    mutable std::shared_ptr<const std::vector<std::string>> sorted_cache;
+    std::atomic<std::shared_ptr<ContentStore>> content_store;
+    std::atomic<bool> compression{false};
+
+    // memory budget state, guarded by lru_mutex; taken after state_mutex.
+    // Only resident entries with owned contents are in the LRU list.
+    struct PathHash {
+        using is_transparent = void;
+        size_t operator()(const std::string_view path) const {
+            return std::hash<std::string_view>{}(path);
+        }
+    };
+    struct LruSlot {
+        std::list<std::string>::iterator position;
+        uint64_t size;
+    };
+    std::atomic<uint64_t> memory_budget{0};
+    mutable std::mutex lru_mutex;
+    // most recently read first
+    mutable std::list<std::string> lru_order;
+    mutable std::unordered_map<std::string, LruSlot, PathHash, std::equal_to<>>
+        lru_slots;
+    std::unordered_set<std::string, PathHash, std::equal_to<>> spilled_paths;
+    uint64_t resident_bytes = 0;
+    uint64_t evictions = 0;
+    mutable std::atomic<uint64_t> memory_hits{0};
+    mutable std::atomic<uint64_t> memory_misses{0};
+    // serializes evictions, and guards spill_file
+    mutable std::mutex evict_mutex;
+    std::unique_ptr<SpillFile> spill_file;
+    // entries added or replaced since the last save
+    std::unordered_set<std::string> dirty_paths;
+    // tombstones: entries removed since the last save
+    std::unordered_set<std::string> removed_paths;
     std::string persistence_dir;
+    // serializes save passes between callers and the persister
+    std::mutex save_mutex;
+    // set in packed mode, guarded by save_mutex
+    std::unique_ptr<PackArchive> pack;
+    // inflate cache, guarded by inflate_mutex. Slots are keyed by the
+    // stored entry and keep it alive, so its address is not reused while
+    // it is a key; an entry replaced in the index ages out like any other.
+    struct InflateSlot {
+        FileHandle stored;
+        FileHandle inflated;
+    };
+    std::atomic<uint64_t> inflate_cache_size{DEFAULT_INFLATE_CACHE_SIZE};
+    mutable std::mutex inflate_mutex;
+    // most recently read first
+    mutable std::list<InflateSlot> inflate_order;
+    mutable std::unordered_map<const FileEntry *,
+                               std::list<InflateSlot>::iterator>
+        inflate_slots;
+    mutable uint64_t inflated_bytes = 0;
+    // runs the per-file disk I/O; null when it is sequential
+    std::atomic<std::shared_ptr<ThreadPool>> io_pool;
+
+    // background persister state, guarded by persist_mutex
+    std::thread persister;
+    std::atomic<bool> background_persistence{false};
+    std::mutex persist_mutex;
+    std::condition_variable persist_cv;
+    std::condition_variable flushed_cv;
+    std::chrono::milliseconds persist_debounce{0};
+    std::chrono::steady_clock::time_point first_unsaved_change;
+    std::chrono::steady_clock::time_point last_change;
+    uint64_t change_seq = 0;
+    uint64_t saved_seq = 0;
+    bool save_requested = false;
+    bool persist_stop = false;
+    bool persist_ok = true;
+
+    // write-ahead log state, guarded by wal_mutex; mutations hold it while
+    // appending and applying so a log rotation never splits the two
+    // a Write record's data starts with the 8-byte offset written at
+    enum class WalOp : uint8_t { Put = 1, Remove = 2, Write = 3 };
+    std::atomic<bool> wal_enabled{false};
+    std::mutex wal_mutex;
+    std::condition_variable wal_synced_cv;
+    int wal_fd = -1;
+    uint64_t wal_generation = 0;
+    uint64_t wal_size = 0;
+    uint64_t wal_compact_bytes = 0;
+    std::chrono::milliseconds wal_sync_interval{0};
+    std::chrono::steady_clock::time_point wal_last_sync;
+    uint64_t wal_appended = 0;
+    uint64_t wal_synced = 0;
+    bool wal_syncing = false;
+    // set when a failed append could not be cut off the log; appends fail
+    // until the next generation
+    bool wal_broken = false;
+    // with a non-zero sync interval, fsyncs a tail no later mutation
+    // commits once the interval has passed
+    std::thread wal_syncer;
+    std::condition_variable wal_pending_cv;
+    bool wal_syncer_stop = false;
+    // returned by wal_append when the record is not in the log
+    static constexpr uint64_t WAL_APPEND_FAILED = UINT64_MAX;
+
     static std::string get_mime_type(const std::string &path);
+    [[nodiscard]] FileHandle make_entry(const std::string &path,
+                                        Buffer data) const;
+    void publish(const std::string &path, Buffer data);
+    // entry with its contents deflated, or unchanged if they are not worth
+    // compressing
+    [[nodiscard]] static FileEntry compress_entry(FileEntry entry);
+    // the uncompressed contents of entry, in one buffer
+    [[nodiscard]] static Buffer contents_of(const FileEntry &entry);
+    // current with data written at offset, as a chunked entry
+    [[nodiscard]] static FileHandle spliced_entry(
+        const std::string &path, const FileHandle &current, uint64_t offset,
+        std::span<const unsigned char> data);
+    // append_file (no offset) and write_file
+    void write_chunked(const std::string &path,
+                       std::optional<uint64_t> offset,
+                       std::span<const unsigned char> data);
+    // replaces every entry by transform(entry), skipping the ones changed
+    // meanwhile; transform runs without any lock held
+    void rewrite_entries(
+        const std::function<FileHandle(const FileHandle &)> &transform);
+    // called with state_mutex held exclusively
+    void put_entry(std::string_view path, FileHandle entry);
+    bool erase_entry(std::string_view path);
+    // the entry at path and the ones below it; called with state_mutex held
+    [[nodiscard]] std::vector<std::string> tree_paths(
+        std::string_view path) const;
+    // LRU bookkeeping, called with lru_mutex held
+    void track_entry(std::string_view path, const FileHandle &entry);
+    void untrack_entry(std::string_view path);
+    // take lru_mutex themselves
+    void note_access(std::string_view path) const;
+    void enforce_memory_budget();
+    // drops the least recently read inflate cache slots until the cache
+    // fits in limit; called with inflate_mutex held
+    void trim_inflate_cache(uint64_t limit) const;
+    void notify_change();
+    void persister_loop();
+    bool save_pending(bool durable);
+    bool save_to_pack(
+        const std::vector<std::pair<std::string, FileHandle>> &writes,
+        const std::vector<std::string> &removals, bool durable);
+    bool load_from_pack();
+    uint64_t wal_append(WalOp op, const std::string &path,
+                        const unsigned char *data, size_t len,
+                        uint64_t offset = 0);
+    void wal_commit(uint64_t seq);
+    void wal_sync_to(uint64_t seq, std::unique_lock<std::mutex> &lock);
+    void wal_syncer_loop();
+    bool open_wal_generation(uint64_t generation);
+    uint64_t rotate_wal();
+    void drop_wal_generations_before(uint64_t generation);
+    bool replay_wal(uint64_t &last_generation);
+    bool write_entry_to_disk(const std::string &path, const FileEntry &entry,
+                             bool durable) const;
+    // calls body(i) for every i in [0, count) on the I/O pool, or in order
+    // on the calling thread without one
+    template <typename Body>
+    void for_each_io(const size_t count, Body &&body) const {
+        if (const auto pool = io_pool.load()) {
+            pool->parallel_for(count, body);
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) body(i);
+    }
 };
 #endif  // VFS_HPP
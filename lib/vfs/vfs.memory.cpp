@@ -0,0 +1,127 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "vfs.hpp"
+
+// Memory budget: resident entries with owned contents are kept in LRU
+// order. When their total exceeds the budget, the least recently read
+// ones are copied to the spill file and their entries republished over the
+// mapped copy, so the heap copy is freed once no reader holds it.
+
+void VirtualFileSystem::set_memory_budget(const uint64_t bytes) {
+    const uint64_t previous = memory_budget.exchange(bytes);
+    if (bytes == 0) {
+        std::lock_guard lru_lock(lru_mutex);
+        lru_order.clear();
+        lru_slots.clear();
+        spilled_paths.clear();
+        resident_bytes = 0;
+        return;
+    }
+    if (previous == 0) {
+        // writers track their entries from now on; pick up the rest
+        std::shared_lock lock(state_mutex);
+        std::lock_guard lru_lock(lru_mutex);
+        files.for_each([this](const std::string &path,
+                              const FileHandle &entry) {
+            if (!lru_slots.contains(path)) track_entry(path, entry);
+        });
+    }
+    enforce_memory_budget();
+}
+
+VirtualFileSystem::MemoryStats VirtualFileSystem::memory_stats() const {
+    MemoryStats stats;
+    stats.budget = memory_budget;
+    stats.hits = memory_hits;
+    stats.misses = memory_misses;
+    {
+        std::lock_guard lru_lock(lru_mutex);
+        stats.resident_bytes = resident_bytes;
+        stats.evictions = evictions;
+    }
+    std::lock_guard evict_lock(evict_mutex);
+    stats.spilled_bytes = spill_file ? spill_file->live_bytes() : 0;
+    return stats;
+}
+
+void VirtualFileSystem::track_entry(const std::string_view path,
+                                    const FileHandle &entry) {
+    untrack_entry(path);
+    // borrowed contents cost no heap, so evicting them gains nothing
+    if (!entry->data.is_owned() || entry->data.empty()) return;
+    lru_order.emplace_front(path);
+    lru_slots.emplace(path, LruSlot{lru_order.begin(), entry->data.size()});
+    resident_bytes += entry->data.size();
+}
+
+void VirtualFileSystem::untrack_entry(const std::string_view path) {
+    if (const auto spilled = spilled_paths.find(path);
+        spilled != spilled_paths.end()) {
+        spilled_paths.erase(spilled);
+    }
+    const auto slot = lru_slots.find(path);
+    if (slot == lru_slots.end()) return;
+    resident_bytes -= slot->second.size;
+    lru_order.erase(slot->second.position);
+    lru_slots.erase(slot);
+}
+
+void VirtualFileSystem::note_access(const std::string_view path) const {
+    std::lock_guard lru_lock(lru_mutex);
+    if (const auto slot = lru_slots.find(path); slot != lru_slots.end()) {
+        lru_order.splice(lru_order.begin(), lru_order, slot->second.position);
+        ++memory_hits;
+    } else if (spilled_paths.contains(path)) {
+        ++memory_misses;
+    }
+}
+
+void VirtualFileSystem::enforce_memory_budget() {
+    if (memory_budget == 0) return;
+    // one evicting thread is enough; the others go back to their callers
+    std::unique_lock evict_lock(evict_mutex, std::try_to_lock);
+    if (!evict_lock.owns_lock()) return;
+    while (true) {
+        std::string victim;
+        {
+            std::lock_guard lru_lock(lru_mutex);
+            if (resident_bytes <= memory_budget || lru_order.empty()) return;
+            victim = lru_order.back();
+        }
+        FileHandle entry;
+        {
+            std::shared_lock lock(state_mutex);
+            if (const FileHandle *found = files.find(victim)) {
+                entry = *found;
+            }
+        }
+        if (!entry) {
+            std::lock_guard lru_lock(lru_mutex);
+            untrack_entry(victim);
+            continue;
+        }
+
+        if (!spill_file) {
+            spill_file = std::make_unique<SpillFile>();
+        }
+        std::optional<Buffer> spilled = spill_file->spill(entry->data.span());
+        if (!spilled) return;
+        FileEntry spilled_entry = *entry;
+        spilled_entry.data = std::move(*spilled);
+        auto replacement =
+            std::make_shared<const FileEntry>(std::move(spilled_entry));
+
+        std::lock_guard lock(state_mutex);
+        // an entry replaced meanwhile was tracked again by its writer
+        if (const FileHandle *current = files.find(victim);
+            current != nullptr && *current == entry) {
+            files.insert_or_assign(victim, std::move(replacement));
+            std::lock_guard lru_lock(lru_mutex);
+            untrack_entry(victim);
+            spilled_paths.insert(victim);
+            evictions++;
+        }
+    }
+}
@@ -0,0 +1,108 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "vfs.hpp"
+
+// Background persister: mutations only bump a sequence number and wake the
+// thread; the thread waits for the debounce window to go quiet and then
+// writes every pending change in one durable pass.
+
+bool VirtualFileSystem::start_background_persistence(
+    const std::chrono::milliseconds debounce) {
+    if (!enable_persistence) {
+        std::cerr << "Persistence is not enabled" << std::endl;
+        return false;
+    }
+    if (persister.joinable()) {
+        std::lock_guard lock(persist_mutex);
+        persist_debounce = debounce;
+        return true;
+    }
+    {
+        std::lock_guard lock(persist_mutex);
+        persist_debounce = debounce;
+        persist_stop = false;
+        // changes made before the persister started are picked up at once
+        if (has_unsaved_changes()) {
+            ++change_seq;
+            save_requested = true;
+        }
+    }
+    background_persistence = true;
+    persister = std::thread(&VirtualFileSystem::persister_loop, this);
+    return true;
+}
+
+void VirtualFileSystem::stop_background_persistence() {
+    if (!persister.joinable()) return;
+    {
+        std::lock_guard lock(persist_mutex);
+        persist_stop = true;
+    }
+    persist_cv.notify_all();
+    persister.join();
+    background_persistence = false;
+}
+
+void VirtualFileSystem::request_save() {
+    {
+        std::lock_guard lock(persist_mutex);
+        save_requested = true;
+    }
+    persist_cv.notify_all();
+}
+
+bool VirtualFileSystem::flush() {
+    if (!background_persistence) {
+        return save_to_disk();
+    }
+    std::unique_lock lock(persist_mutex);
+    const uint64_t target = change_seq;
+    save_requested = true;
+    persist_cv.notify_all();
+    flushed_cv.wait(lock,
+                    [&] { return saved_seq >= target || persist_stop; });
+    return saved_seq >= target && persist_ok;
+}
+
+void VirtualFileSystem::notify_change() {
+    if (!background_persistence) return;
+    {
+        std::lock_guard lock(persist_mutex);
+        const auto now = std::chrono::steady_clock::now();
+        if (saved_seq == change_seq) first_unsaved_change = now;
+        last_change = now;
+        ++change_seq;
+    }
+    persist_cv.notify_all();
+}
+
+void VirtualFileSystem::persister_loop() {
+    std::unique_lock lock(persist_mutex);
+    while (true) {
+        persist_cv.wait(lock, [this] {
+            return persist_stop || save_requested || saved_seq != change_seq;
+        });
+        // coalesce: wait until no change arrived for a full debounce
+        // window, but never hold a steady stream of changes back for more
+        // than a few windows
+        while (!persist_stop && !save_requested) {
+            const auto deadline =
+                std::min(last_change + persist_debounce,
+                         first_unsaved_change + 4 * persist_debounce);
+            if (std::chrono::steady_clock::now() >= deadline) break;
+            persist_cv.wait_until(lock, deadline);
+        }
+        const uint64_t target = change_seq;
+        const bool stopping = persist_stop;
+        save_requested = false;
+        lock.unlock();
+        const bool ok = save_pending(true);
+        lock.lock();
+        persist_ok = ok;
+        saved_seq = std::max(saved_seq, target);
+        flushed_cv.notify_all();
+        if (stopping) break;
+    }
+}
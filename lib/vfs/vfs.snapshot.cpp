@@ -0,0 +1,77 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "vfs.hpp"
+#include <algorithm>
+
+VirtualFileSystem::VirtualFileSystem(const Snapshot &snapshot)
+    : enable_persistence(false),
+      files(snapshot.files),
+      directories(snapshot.directories) {}
+
+VirtualFileSystem::Snapshot VirtualFileSystem::snapshot() const {
+    Snapshot snapshot;
+    std::shared_lock lock(state_mutex);
+    snapshot.files = files;
+    snapshot.directories = directories;
+    return snapshot;
+}
+
+std::unique_ptr<VirtualFileSystem> VirtualFileSystem::clone() const {
+    auto copy = std::make_unique<VirtualFileSystem>(snapshot());
+    copy->compression = compression.load();
+    copy->content_store.store(content_store.load());
+    return copy;
+}
+
+size_t VirtualFileSystem::restore(const Snapshot &snapshot) {
+    std::vector<std::string> removals;
+    std::vector<std::pair<std::string, FileHandle>> puts;
+    uint64_t seq = 0;
+    {
+        // writers hold wal_mutex, so the entries cannot change until the
+        // restore is applied
+        std::lock_guard wal_lock(wal_mutex);
+        {
+            std::shared_lock lock(state_mutex);
+            SharedPathIndex<FileHandle>::diff(
+                files, snapshot.files,
+                [&](const std::string &path, const FileHandle *,
+                    const FileHandle *restored) {
+                    if (restored) {
+                        puts.emplace_back(path, *restored);
+                    } else {
+                        removals.push_back(path);
+                    }
+                });
+        }
+        if (removals.empty() && puts.empty()) return 0;
+        for (const auto &path : removals) {
+            seq = std::max(seq, wal_append(WalOp::Remove, path, nullptr, 0));
+        }
+        if (wal_enabled) {
+            for (const auto &[path, entry] : puts) {
+                const Buffer contents = contents_of(*entry);
+                seq = std::max(seq, wal_append(WalOp::Put, path,
+                                               contents.data(),
+                                               contents.size()));
+            }
+        }
+        std::lock_guard lock(state_mutex);
+        for (const auto &path : removals) {
+            erase_entry(path);
+            dirty_paths.erase(path);
+            removed_paths.insert(path);
+        }
+        for (auto &[path, entry] : puts) {
+            put_entry(path, std::move(entry));
+            removed_paths.erase(path);
+            dirty_paths.insert(path);
+        }
+    }
+    wal_commit(seq);
+    notify_change();
+    enforce_memory_budget();
+    return removals.size() + puts.size();
+}
@@ -0,0 +1,409 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "vfs.hpp"
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+
+// Write-ahead log. Logs live in the persistence directory as
+// .membrane.wal.<generation>; each starts with WAL_MAGIC followed by
+// records laid out (host byte order) as
+//   u32 crc32 | u8 op | u32 path_len | u64 data_len | path | data
+// where the checksum covers everything after itself. A save rotates to a
+// new generation and deletes the older ones once the snapshot holds them.
+
+namespace {
+constexpr std::string_view WAL_PREFIX = ".membrane.wal.";
+constexpr std::array<char, 8> WAL_MAGIC = {'M', 'V', 'F', 'S',
+                                           'W', 'A', 'L', '1'};
+constexpr size_t RECORD_HEADER_SIZE = 4 + 1 + 4 + 8;
+
+const std::array<uint32_t, 256> &crc32_table() {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    return table;
+}
+
+uint32_t crc32_update(uint32_t crc, const unsigned char *data,
+                      const size_t len) {
+    const auto &table = crc32_table();
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+bool write_all(const int fd, const iovec *iov, int count) {
+    std::vector<iovec> pending(iov, iov + count);
+    size_t index = 0;
+    while (index < pending.size()) {
+        const ssize_t n = ::writev(fd, pending.data() + index,
+                                   static_cast<int>(pending.size() - index));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        auto remaining = static_cast<size_t>(n);
+        while (index < pending.size() && remaining >= pending[index].iov_len) {
+            remaining -= pending[index].iov_len;
+            index++;
+        }
+        if (index < pending.size()) {
+            pending[index].iov_base =
+                static_cast<char *>(pending[index].iov_base) + remaining;
+            pending[index].iov_len -= remaining;
+        }
+    }
+    return true;
+}
+
+void fsync_directory(const std::string &dir) {
+    if (const int fd = ::open(dir.c_str(), O_RDONLY); fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+std::string wal_path(const std::string &dir, const uint64_t generation) {
+    return dir + "/" + std::string(WAL_PREFIX) + std::to_string(generation);
+}
+
+std::vector<uint64_t> list_wal_generations(const std::string &dir) {
+    std::vector<uint64_t> generations;
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+        const std::string name = entry.path().filename().string();
+        if (!name.starts_with(WAL_PREFIX)) continue;
+        try {
+            generations.push_back(std::stoull(name.substr(WAL_PREFIX.size())));
+        } catch ([[maybe_unused]] const std::exception &e) {
+        }
+    }
+    std::ranges::sort(generations);
+    return generations;
+}
+}  // namespace
+
+bool VirtualFileSystem::enable_write_ahead_log(
+    const std::chrono::milliseconds sync_interval,
+    const uint64_t compact_after_bytes) {
+    if (!enable_persistence) {
+        std::cerr << "Persistence is not enabled" << std::endl;
+        return false;
+    }
+    std::lock_guard save_lock(save_mutex);
+    std::lock_guard wal_lock(wal_mutex);
+    wal_sync_interval = sync_interval;
+    wal_compact_bytes = compact_after_bytes;
+    const auto start_syncer = [this] {
+        if (wal_sync_interval.count() > 0 && !wal_syncer.joinable()) {
+            wal_syncer_stop = false;
+            wal_syncer = std::thread(&VirtualFileSystem::wal_syncer_loop, this);
+        }
+    };
+    if (wal_enabled) {
+        start_syncer();
+        return true;
+    }
+    uint64_t last_generation = 0;
+    if (!replay_wal(last_generation)) {
+        return false;
+    }
+    if (!open_wal_generation(last_generation + 1)) {
+        return false;
+    }
+    wal_enabled = true;
+    start_syncer();
+    return true;
+}
+
+void VirtualFileSystem::disable_write_ahead_log() {
+    if (!wal_enabled) return;
+    if (wal_syncer.joinable()) {
+        {
+            std::lock_guard lock(wal_mutex);
+            wal_syncer_stop = true;
+        }
+        wal_pending_cv.notify_all();
+        wal_syncer.join();
+    }
+    std::unique_lock wal_lock(wal_mutex);
+    wal_synced_cv.wait(wal_lock, [this] { return !wal_syncing; });
+    ::fsync(wal_fd);
+    ::close(wal_fd);
+    wal_fd = -1;
+    wal_enabled = false;
+    // a log without records after a clean save carries nothing to replay
+    if (wal_size == WAL_MAGIC.size() && !has_unsaved_changes() &&
+        list_wal_generations(persistence_dir).size() == 1) {
+        std::filesystem::remove(wal_path(persistence_dir, wal_generation));
+    }
+}
+
+bool VirtualFileSystem::open_wal_generation(const uint64_t generation) {
+    const std::string path = wal_path(persistence_dir, generation);
+    const int fd =
+        ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open write-ahead log " << path << std::endl;
+        return false;
+    }
+    const iovec magic = {const_cast<char *>(WAL_MAGIC.data()),
+                         WAL_MAGIC.size()};
+    if (!write_all(fd, &magic, 1) || ::fsync(fd) != 0) {
+        std::cerr << "Failed to initialize write-ahead log " << path
+                  << std::endl;
+        ::close(fd);
+        return false;
+    }
+    fsync_directory(persistence_dir);
+    wal_fd = fd;
+    wal_generation = generation;
+    wal_size = WAL_MAGIC.size();
+    wal_broken = false;
+    wal_last_sync = std::chrono::steady_clock::now();
+    return true;
+}
+
+// Called with wal_mutex held. Returns the sequence number to commit, 0
+// when there is no log, or WAL_APPEND_FAILED when the record could not be
+// logged; the caller still applies the mutation and wal_commit saves it.
+uint64_t VirtualFileSystem::wal_append(const WalOp op, const std::string &path,
+                                       const unsigned char *data,
+                                       const size_t len,
+                                       const uint64_t offset) {
+    if (!wal_enabled) return 0;
+    std::array<unsigned char, RECORD_HEADER_SIZE> header{};
+    std::array<unsigned char, 8> offset_bytes{};
+    std::memcpy(offset_bytes.data(), &offset, 8);
+    const size_t offset_len = op == WalOp::Write ? offset_bytes.size() : 0;
+    const auto op_byte = static_cast<uint8_t>(op);
+    const auto path_len = static_cast<uint32_t>(path.size());
+    const auto data_len = static_cast<uint64_t>(offset_len + len);
+    std::memcpy(header.data() + 4, &op_byte, 1);
+    std::memcpy(header.data() + 5, &path_len, 4);
+    std::memcpy(header.data() + 9, &data_len, 8);
+    uint32_t crc = crc32_update(0, header.data() + 4, header.size() - 4);
+    crc = crc32_update(
+        crc, reinterpret_cast<const unsigned char *>(path.data()), path.size());
+    crc = crc32_update(crc, offset_bytes.data(), offset_len);
+    crc = crc32_update(crc, data, len);
+    std::memcpy(header.data(), &crc, 4);
+
+    std::array<iovec, 4> iov{};
+    int count = 0;
+    iov[count++] = {header.data(), header.size()};
+    iov[count++] = {const_cast<char *>(path.data()), path.size()};
+    if (offset_len > 0) iov[count++] = {offset_bytes.data(), offset_len};
+    if (len > 0) iov[count++] = {const_cast<unsigned char *>(data), len};
+    if (wal_broken) return WAL_APPEND_FAILED;
+    if (!write_all(wal_fd, iov.data(), count)) {
+        std::cerr << "Failed to append to write-ahead log: "
+                  << strerror(errno) << std::endl;
+        // replay stops at a torn record, so the part written is cut off
+        // for the records appended after it to be replayed
+        if (::ftruncate(wal_fd, static_cast<off_t>(wal_size)) != 0) {
+            std::cerr << "Failed to truncate write-ahead log: "
+                      << strerror(errno) << std::endl;
+            wal_broken = true;
+        }
+        return WAL_APPEND_FAILED;
+    }
+    wal_size += header.size() + path.size() + data_len;
+    if (wal_sync_interval.count() > 0) wal_pending_cv.notify_one();
+    return ++wal_appended;
+}
+
+// Group commit: with a sync interval the syncer thread fsyncs for every
+// writer; without one, the first writer to arrive fsyncs everything
+// appended so far while the others wait for it instead of issuing their own.
+void VirtualFileSystem::wal_commit(const uint64_t seq) {
+    if (seq == 0) return;
+    if (seq == WAL_APPEND_FAILED) {
+        // the mutation is only in memory; a save is the one way left to
+        // put it on disk, and on failure its path stays unsaved
+        std::cerr << "Saving " << persistence_dir
+                  << " as its write-ahead log failed" << std::endl;
+        if (!flush()) {
+            std::cerr << "Failed to save " << persistence_dir << std::endl;
+        }
+        return;
+    }
+    bool compact;
+    {
+        std::unique_lock lock(wal_mutex);
+        if (wal_sync_interval.count() == 0) wal_sync_to(seq, lock);
+        compact = wal_size >= wal_compact_bytes;
+    }
+    if (!compact) return;
+    if (has_background_persistence()) {
+        request_save();
+    } else {
+        save_to_disk();
+    }
+}
+
+// Called with wal_mutex held through lock; returns once the records up to
+// seq are on disk.
+void VirtualFileSystem::wal_sync_to(const uint64_t seq,
+                                    std::unique_lock<std::mutex> &lock) {
+    while (wal_synced < seq) {
+        if (wal_syncing) {
+            wal_synced_cv.wait(lock);
+            continue;
+        }
+        wal_syncing = true;
+        const uint64_t target = wal_appended;
+        const int fd = wal_fd;
+        lock.unlock();
+        ::fdatasync(fd);
+        lock.lock();
+        wal_syncing = false;
+        wal_synced = std::max(wal_synced, target);
+        wal_last_sync = std::chrono::steady_clock::now();
+        wal_synced_cv.notify_all();
+    }
+}
+
+void VirtualFileSystem::wal_syncer_loop() {
+    std::unique_lock lock(wal_mutex);
+    while (!wal_syncer_stop) {
+        if (wal_synced >= wal_appended) {
+            wal_pending_cv.wait(lock);
+            continue;
+        }
+        const auto deadline = wal_last_sync + wal_sync_interval;
+        if (std::chrono::steady_clock::now() < deadline) {
+            wal_pending_cv.wait_until(lock, deadline);
+            continue;
+        }
+        wal_sync_to(wal_appended, lock);
+    }
+}
+
+// Starts a new log generation and returns it, or 0 when the current log is
+// empty or there is none.
+uint64_t VirtualFileSystem::rotate_wal() {
+    if (!wal_enabled) return 0;
+    std::unique_lock lock(wal_mutex);
+    if (wal_size == WAL_MAGIC.size() &&
+        list_wal_generations(persistence_dir).size() == 1) {
+        return 0;
+    }
+    wal_synced_cv.wait(lock, [this] { return !wal_syncing; });
+    const int old_fd = wal_fd;
+    ::fdatasync(old_fd);
+    if (!open_wal_generation(wal_generation + 1)) {
+        // keep appending to the old log; the pass still saves, but
+        // nothing is dropped
+        wal_fd = old_fd;
+        return 0;
+    }
+    ::close(old_fd);
+    wal_synced = wal_appended;
+    wal_synced_cv.notify_all();
+    return wal_generation;
+}
+
+void VirtualFileSystem::drop_wal_generations_before(const uint64_t generation) {
+    for (const uint64_t old : list_wal_generations(persistence_dir)) {
+        if (old >= generation) break;
+        std::error_code ec;
+        std::filesystem::remove(wal_path(persistence_dir, old), ec);
+    }
+    fsync_directory(persistence_dir);
+}
+
+// Applies every intact record of every log generation, oldest first. A torn
+// or corrupt record ends its log: it was never acknowledged as durable.
+bool VirtualFileSystem::replay_wal(uint64_t &last_generation) {
+    for (const uint64_t generation : list_wal_generations(persistence_dir)) {
+        last_generation = generation;
+        const std::string path = wal_path(persistence_dir, generation);
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) {
+            std::cerr << "Failed to open write-ahead log " << path
+                      << std::endl;
+            return false;
+        }
+        const std::vector<unsigned char> log(
+            (std::istreambuf_iterator<char>(in)),
+            std::istreambuf_iterator<char>());
+        if (log.size() < WAL_MAGIC.size() ||
+            !std::equal(WAL_MAGIC.begin(), WAL_MAGIC.end(), log.begin())) {
+            std::cerr << "Ignoring invalid write-ahead log " << path
+                      << std::endl;
+            continue;
+        }
+        size_t offset = WAL_MAGIC.size();
+        while (offset + RECORD_HEADER_SIZE <= log.size()) {
+            uint32_t crc;
+            uint8_t op;
+            uint32_t path_len;
+            uint64_t data_len;
+            std::memcpy(&crc, log.data() + offset, 4);
+            std::memcpy(&op, log.data() + offset + 4, 1);
+            std::memcpy(&path_len, log.data() + offset + 5, 4);
+            std::memcpy(&data_len, log.data() + offset + 9, 8);
+            const size_t body = offset + RECORD_HEADER_SIZE;
+            if (data_len > log.size() ||
+                body + path_len + data_len > log.size()) {
+                break;
+            }
+            if (crc32_update(0, log.data() + offset + 4,
+                             RECORD_HEADER_SIZE - 4 + path_len + data_len) !=
+                crc) {
+                std::cerr << "Corrupt record in write-ahead log " << path
+                          << std::endl;
+                break;
+            }
+            const std::string entry_path(
+                reinterpret_cast<const char *>(log.data() + body), path_len);
+            const unsigned char *data = log.data() + body + path_len;
+            if (op == static_cast<uint8_t>(WalOp::Put)) {
+                FileHandle entry = make_entry(
+                    entry_path, std::vector(data, data + data_len));
+                std::lock_guard lock(state_mutex);
+                put_entry(entry_path, std::move(entry));
+                removed_paths.erase(entry_path);
+                dirty_paths.insert(entry_path);
+            } else if (op == static_cast<uint8_t>(WalOp::Write) &&
+                       data_len >= 8) {
+                uint64_t at;
+                std::memcpy(&at, data, 8);
+                std::lock_guard lock(state_mutex);
+                const FileHandle *current = files.find(entry_path);
+                put_entry(entry_path,
+                          spliced_entry(entry_path,
+                                        current ? *current : nullptr, at,
+                                        {data + 8, data_len - 8}));
+                removed_paths.erase(entry_path);
+                dirty_paths.insert(entry_path);
+            } else if (op == static_cast<uint8_t>(WalOp::Remove)) {
+                std::lock_guard lock(state_mutex);
+                erase_entry(entry_path);
+                dirty_paths.erase(entry_path);
+                removed_paths.insert(entry_path);
+            }
+            offset = body + path_len + data_len;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,122 @@
+// Membrane - A C++ and Web Tech Interface
+// Created by Maxime Le Besnerais
+// Copyright (c) 2025 Maxime Le Besnerais
+
+#include "vfs.hpp"
+#include <miniz.h>
+
+#include <cstring>
+#include <iostream>
+
+// ZIP-backed entries: the central directory gives each file's method,
+// sizes, CRC-32 and local header. The data after that header is exactly
+// what a stored entry holds, or a raw deflate stream, so an entry can be a
+// slice of the archive either way.
+
+namespace {
+constexpr uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+constexpr uint64_t LOCAL_HEADER_SIZE = 30;
+
+// where the length bytes of data following the local header at offset
+// start, or nullopt if the header is not one or the data overruns archive
+std::optional<uint64_t> data_offset(const Buffer &archive,
+                                    const uint64_t offset,
+                                    const uint64_t length) {
+    if (offset > archive.size() ||
+        archive.size() - offset < LOCAL_HEADER_SIZE) {
+        return std::nullopt;
+    }
+    const unsigned char *header = archive.data() + offset;
+    uint32_t signature;
+    uint16_t name_length;
+    uint16_t extra_length;
+    std::memcpy(&signature, header, 4);
+    std::memcpy(&name_length, header + 26, 2);
+    std::memcpy(&extra_length, header + 28, 2);
+    if (signature != LOCAL_HEADER_SIGNATURE) return std::nullopt;
+    // the extra field may differ from the central directory's copy
+    const uint64_t start =
+        offset + LOCAL_HEADER_SIZE + name_length + extra_length;
+    if (start > archive.size() || archive.size() - start < length) {
+        return std::nullopt;
+    }
+    return start;
+}
+}  // namespace
+
+size_t VirtualFileSystem::add_zip(Buffer archive, const bool strip_root) {
+    mz_zip_archive zip;
+    std::memset(&zip, 0, sizeof(zip));
+    if (!mz_zip_reader_init_mem(&zip, archive.data(), archive.size(), 0)) {
+        std::cerr << "Failed to open ZIP archive" << std::endl;
+        return 0;
+    }
+    std::vector<std::pair<std::string, FileHandle>> entries;
+    const mz_uint file_count = mz_zip_reader_get_num_files(&zip);
+    entries.reserve(file_count);
+    for (mz_uint i = 0; i < file_count; ++i) {
+        mz_zip_archive_file_stat file_stat;
+        if (!mz_zip_reader_file_stat(&zip, i, &file_stat)) {
+            std::cerr << "Failed to get file stat for entry " << i
+                      << std::endl;
+            continue;
+        }
+        if (file_stat.m_is_directory) continue;
+        const bool deflated = file_stat.m_method == MZ_DEFLATED;
+        if (file_stat.m_is_encrypted || !file_stat.m_is_supported ||
+            (!deflated && (file_stat.m_method != 0 ||
+                           file_stat.m_comp_size != file_stat.m_uncomp_size))) {
+            std::cerr << "Skipping unsupported ZIP entry: "
+                      << file_stat.m_filename << std::endl;
+            continue;
+        }
+        const std::optional<uint64_t> start = data_offset(
+            archive, file_stat.m_local_header_ofs, file_stat.m_comp_size);
+        if (!start) {
+            std::cerr << "Skipping corrupt ZIP entry: " << file_stat.m_filename
+                      << std::endl;
+            continue;
+        }
+
+        std::string path = file_stat.m_filename;
+        if (strip_root) path = path.substr(path.find_first_of('/') + 1);
+        if (path.empty()) continue;
+        FileEntry entry{archive.slice(*start, file_stat.m_comp_size),
+                        get_mime_type(path)};
+        if (deflated) {
+            entry.compressed = true;
+            entry.raw_deflate = true;
+            entry.original_size = file_stat.m_uncomp_size;
+            entry.crc32 = file_stat.m_crc32;
+        }
+        entries.emplace_back(std::move(path),
+                             std::make_shared<const FileEntry>(
+                                 std::move(entry)));
+    }
+    mz_zip_reader_end(&zip);
+
+    uint64_t seq = 0;
+    {
+        std::lock_guard wal_lock(wal_mutex);
+        // the log records the uncompressed contents, so only a logged
+        // archive is inflated here
+        if (wal_enabled) {
+            for (const auto &[path, entry] : entries) {
+                const Buffer contents = contents_of(*entry);
+                seq = std::max(seq, wal_append(WalOp::Put, path,
+                                               contents.data(),
+                                               contents.size()));
+            }
+        }
+        std::lock_guard lock(state_mutex);
+        for (auto &[path, entry] : entries) {
+            put_entry(path, std::move(entry));
+            removed_paths.erase(path);
+            dirty_paths.insert(path);
+        }
+    }
+    wal_commit(seq);
+    notify_change();
+    enforce_memory_budget();
+    return entries.size();
+}
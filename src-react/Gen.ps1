@@ -1,5 +1,6 @@
 # Membrane Resource Compiler for Windows
-# Transforms React build output into C++ headers for Membrane
+# Packs the React build output into a single blob plus a perfect-hash
+# index for Membrane, emitted as constant tables
 
 # Print banner
 Write-Host "­ƒöº Membrane Resource Compiler for Windows"
@@ -8,10 +9,9 @@ Write-Host "Current working directory: `"$((Get-Location).Path)`""
 # Configuration
 $DIST_DIR = "./dist"
 $OUTPUT_DIR = "../res"
-$HEADERS_DIR = "$OUTPUT_DIR/headers"
-$MAIN_HEADER = "aggregate.hpp"
+$BLOB_NAME = "resources.bin"
+$BLOB_BYTES_NAME = "resources.inc"
 $HASH_FILE = "$OUTPUT_DIR/resource_hashes.txt"
-$TEMP_RESOURCES = "$env:TEMP/membrane_resources.txt"
 
 # Ensure output directories exist
 if (Test-Path $OUTPUT_DIR) {
@@ -19,111 +19,205 @@ if (Test-Path $OUTPUT_DIR) {
 }
 
 New-Item -ItemType Directory -Path $OUTPUT_DIR -Force | Out-Null
-New-Item -ItemType Directory -Path $HEADERS_DIR -Force | Out-Null
-
-# Load previous hashes
-$prev_hashes = @{}
-if (Test-Path $HASH_FILE) {
-    Get-Content $HASH_FILE | ForEach-Object {
-        $hash, $file = $_ -split ' ', 2
-        $prev_hashes[$file] = $hash
-    }
-}
 
-# Clear temporary and output files
-"" | Set-Content $TEMP_RESOURCES
-"" | Set-Content "$OUTPUT_DIR/$MAIN_HEADER"
 "" | Set-Content $HASH_FILE
 
-# Function to create a valid C variable name from file path
-function Make-VarName {
-    param($file)
-    $rel_path = $file -replace [regex]::Escape($DIST_DIR + "/"), ""
-    $var_name = "res_" + ($rel_path -replace '[^a-zA-Z0-9]', '_')
-    return $var_name
+# Must match VirtualFileSystem::get_mime_type
+function Get-MimeType {
+    param($path)
+    switch -Wildcard ($path) {
+        "*.html" { return "text/html" }
+        "*.css" { return "text/css" }
+        "*.js" { return "application/javascript" }
+        "*.png" { return "image/png" }
+        "*.jpg" { return "image/jpeg" }
+        "*.jpeg" { return "image/jpeg" }
+        "*.svg" { return "image/svg+xml" }
+        "*.json" { return "application/json" }
+        "*.wasm" { return "application/wasm" }
+        "*.zip" { return "application/zip" }
+        default { return "application/octet-stream" }
+    }
 }
 
-# Add header guard to the main header file
-@"
-#ifndef MEMBRANE_RESOURCES_HPP
-#define MEMBRANE_RESOURCES_HPP
-// Auto-generated resource headers for Membrane
-"@ | Set-Content "$OUTPUT_DIR/$MAIN_HEADER"
+# The hash and displacement search of ResourcePack.hpp; C# has the
+# wrapping 64-bit arithmetic they need
+Add-Type -TypeDefinition @"
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+
+public static class MembraneResourceIndex {
+    const ulong Golden = 0x9E3779B97F4A7C15UL;
+
+    static ulong Mix(ulong h) {
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDUL;
+        h ^= h >> 33;
+        return h;
+    }
 
-Write-Host "Processing files in $DIST_DIR..."
+    static ulong Hash(string key) {
+        ulong h = 0xCBF29CE484222325UL;
+        foreach (byte c in Encoding.UTF8.GetBytes(key)) {
+            h ^= c;
+            h *= 0x100000001B3UL;
+        }
+        return Mix(h);
+    }
 
-# Process each file in the distribution directory
-Get-ChildItem -Path $DIST_DIR -File -Recurse | ForEach-Object {
-    $file = $_.FullName
-    $rel_path = $file -replace [regex]::Escape((Get-Location).Path + "\$DIST_DIR\"), ""
-    $rel_path = $rel_path -replace "\\", "/"
-    
-    Write-Host "Checking: $file"
-    Write-Host "File name: $($_.Name)"
-    Write-Host "Resource path: $rel_path"
-    
-    $var_name = Make-VarName $rel_path
-    Write-Host "Variable name: $var_name"
-    
-    # Calculate hash of the file
-    $new_hash = (Get-FileHash -Path $file -Algorithm SHA256).Hash
-    
-    if ($prev_hashes[$rel_path] -eq $new_hash) {
-        Write-Host "Skipping unchanged: $rel_path"
-    } else {
-        Write-Host "Processing: $rel_path"
-        
-        # Generate C header using xxd-like functionality
-        $bytes = [System.IO.File]::ReadAllBytes($file)
-        $output = "unsigned char $var_name[] = {`n"
-        $lineCount = 0
-        
-        for ($i = 0; $i -lt $bytes.Length; $i++) {
-            if ($lineCount -eq 0) {
-                $output += "  "
+    // Fills slotOf with the record index of each slot and returns the
+    // displacement of each bucket: buckets of several paths first, largest
+    // first, then the single ones straight into the free slots
+    public static long[] Build(string[] paths, int[] slotOf) {
+        int n = paths.Length;
+        var seen = new HashSet<string>(StringComparer.Ordinal);
+        foreach (string path in paths) {
+            if (!seen.Add(path)) {
+                throw new Exception("Duplicate resource path: " + path);
             }
-            
-            $output += "0x" + $bytes[$i].ToString("x2") + ", "
-            $lineCount++
-            
-            if ($lineCount -eq 12) {
-                $output += "`n"
-                $lineCount = 0
+        }
+        ulong[] hashes = paths.Select(Hash).ToArray();
+        var buckets = new List<int>[n];
+        for (int b = 0; b < n; b++) buckets[b] = new List<int>();
+        for (int i = 0; i < n; i++) buckets[(int)(hashes[i] % (ulong)n)].Add(i);
+        var displacements = new long[n];
+        for (int i = 0; i < n; i++) slotOf[i] = -1;
+        foreach (int b in Enumerable.Range(0, n)
+                     .Where(b => buckets[b].Count > 1)
+                     .OrderByDescending(b => buckets[b].Count)) {
+            for (ulong d = 1; ; d++) {
+                if (d > 100000) {
+                    throw new Exception("Resource paths with the same hash: " +
+                        string.Join(", ", buckets[b].Select(i => paths[i])));
+                }
+                var placed = buckets[b]
+                    .Select(i => (int)(Mix(hashes[i] + d * Golden) % (ulong)n))
+                    .ToList();
+                if (placed.Distinct().Count() != placed.Count ||
+                    placed.Any(slot => slotOf[slot] != -1)) continue;
+                for (int k = 0; k < placed.Count; k++) {
+                    slotOf[placed[k]] = buckets[b][k];
+                }
+                displacements[b] = (long)d;
+                break;
             }
         }
-        
-        if ($lineCount -ne 0) {
-            $output += "`n"
+        int free = 0;
+        for (int b = 0; b < n; b++) {
+            if (buckets[b].Count != 1) continue;
+            while (slotOf[free] != -1) free++;
+            slotOf[free] = buckets[b][0];
+            displacements[b] = -free - 1;
         }
-        
-        $output += "};`nunsigned int ${var_name}_len = " + $bytes.Length + ";`n"
-        $output | Set-Content "$HEADERS_DIR/${var_name}.hpp"
+        return displacements;
     }
-    
-    # Save hash and update includes
+}
+"@
+
+Write-Host "Processing files in $DIST_DIR..."
+
+$blob = New-Object System.IO.MemoryStream
+$paths = New-Object System.Collections.Generic.List[string]
+$records = New-Object System.Collections.Generic.List[string]
+
+# Process each file in the distribution directory
+Get-ChildItem -Path $DIST_DIR -File -Recurse | Sort-Object FullName | ForEach-Object {
+    $file = $_.FullName
+    $rel_path = $file -replace [regex]::Escape((Get-Location).Path + "\$DIST_DIR\"), ""
+    $rel_path = $rel_path -replace "\\", "/"
+    Write-Host "Packing: $rel_path"
+
+    $bytes = [System.IO.File]::ReadAllBytes($file)
+    $new_hash = (Get-FileHash -Path $file -Algorithm SHA256).Hash.ToLower()
+    $offset = $blob.Length
+    $blob.Write($bytes, 0, $bytes.Length)
+
+    $escaped = $rel_path -replace '\\', '\\' -replace '"', '\"'
+    $mime = Get-MimeType $rel_path
+    $etag = $new_hash.Substring(0, 16)
+    $paths.Add($rel_path)
+    $records.Add("        {`"$escaped`", $offset, $($bytes.Length), `"$mime`", `"\`"$etag\`"`"},")
+
     "$new_hash $rel_path" | Add-Content $HASH_FILE
-    "#include `"headers/${var_name}.hpp`"" | Add-Content "$OUTPUT_DIR/$MAIN_HEADER"
-    "$var_name|$rel_path" | Add-Content $TEMP_RESOURCES
 }
 
-# Close the main header
-"#endif" | Add-Content "$OUTPUT_DIR/$MAIN_HEADER"
+$count = $paths.Count
+Write-Host "Building the resource index..."
+$slot_of = New-Object int[] $count
+try {
+    $displacement_table = [MembraneResourceIndex]::Build($paths.ToArray(), $slot_of)
+} catch {
+    Write-Error "Resource index failed: $($_.Exception.InnerException.Message)"
+    exit 1
+}
+$slot_records = New-Object System.Text.StringBuilder
+foreach ($slot in $slot_of) {
+    [void]$slot_records.AppendLine($records[$slot])
+}
+$displacements = New-Object System.Text.StringBuilder
+for ($b = 0; $b -lt $count; $b += 16) {
+    $line = $displacement_table[$b..([Math]::Min($b + 15, $count - 1))] -join ", "
+    [void]$displacements.AppendLine("        $line,")
+}
+
+$blob_bytes = $blob.ToArray()
+[System.IO.File]::WriteAllBytes("$OUTPUT_DIR/$BLOB_NAME", $blob_bytes)
+$blob_hash = (Get-FileHash -Path "$OUTPUT_DIR/$BLOB_NAME" -Algorithm SHA256).Hash.ToLower()
+
+# Byte list for compilers without #embed (MSVC has no .incbin either)
+$hex = New-Object System.Text.StringBuilder
+for ($i = 0; $i -lt $blob_bytes.Length; $i++) {
+    [void]$hex.Append("0x").Append($blob_bytes[$i].ToString("x2")).Append(",")
+    if ($i % 16 -eq 15) {
+        [void]$hex.Append("`n")
+    }
+}
+if ($blob_bytes.Length -eq 0) {
+    [void]$hex.Append("0")
+}
+$hex.ToString() | Set-Content "$OUTPUT_DIR/$BLOB_BYTES_NAME"
 
 # Create a resource initialization file
 $init_content = @"
+// Auto-generated by the Membrane resource compiler
+// blob sha256: $blob_hash
+#include <array>
 #include "Membrane.hpp"
-#include "aggregate.hpp"
-void initialize_resources(Membrane& app) {
+#include "ResourcePack.hpp"
+
+#if defined(__has_embed)
+#if __has_embed("$BLOB_NAME")
+#define MEMBRANE_EMBED_BLOB
+#endif
+#endif
+
+alignas(16) static constexpr unsigned char membrane_resource_blob[] = {
+#ifdef MEMBRANE_EMBED_BLOB
+#embed "$BLOB_NAME" if_empty(0)
+#else
+#include "$BLOB_BYTES_NAME"
+#endif
+};
+
+namespace {
+// records in slot order, then the displacement of each bucket
+constexpr ResourcePackIndex<$count> resource_index{
+    {{
+$($slot_records.ToString())    }},
+    {{
+$($displacements.ToString())    }},
+};
+const ResourcePack resource_pack(membrane_resource_blob, $($blob_bytes.Length),
+                                 resource_index);
+}  // namespace
 
-"@
-
-# Add each resource to the initialization file
-Get-Content $TEMP_RESOURCES | ForEach-Object {
-    $var_name, $path = $_ -split '\|', 2
-    $init_content += "    app.add_vfs(""$path"", $var_name, ${var_name}_len);`n"
+void initialize_resources(Membrane& app) {
+    app.add_resource_pack(resource_pack);
 }
 
-$init_content += "}`n"
+"@
 $init_content | Set-Content "$OUTPUT_DIR/resource_init.cpp"
 
 # Create a header for the initialization function
@@ -137,7 +231,4 @@ void initialize_resources(Membrane& app);
 #endif // MEMBRANE_RESOURCE_INIT_HPP
 "@ | Set-Content "$OUTPUT_DIR/resource_init.hpp"
 
-# Clean up
-Remove-Item $TEMP_RESOURCES -Force
-
-Write-Host "Resource compilation complete!"
\ No newline at end of file
+Write-Host "Resource compilation complete!"
@@ -1,80 +1,218 @@
 #!/bin/bash
 
 # Membrane Resource Compiler
-# Transforms React build output into C++ headers for Membrane
-# Uses hashing to prevent unnecessary reprocessing
+# Packs the React build output into a single blob plus a perfect-hash
+# index for Membrane, emitted as constant tables
 
 # Configuration
 DIST_DIR="./dist"
 OUTPUT_DIR="../res"
-HEADERS_DIR="$OUTPUT_DIR/headers"
-MAIN_HEADER="aggregate.hpp"
+BLOB_NAME="resources.bin"
 HASH_FILE="../res/resource_hashes.txt"
-TEMP_RESOURCES="/tmp/membrane_resources.txt"
 
 if [ -d "$OUTPUT_DIR" ]; then
     rm -r "$OUTPUT_DIR"
 fi
 
 mkdir -p "$OUTPUT_DIR"
-mkdir -p "$HEADERS_DIR"
-
-# Load previous hashes
-declare -A prev_hashes
-if [[ -f "$HASH_FILE" ]]; then
-    while IFS=" " read -r hash file; do
-        prev_hashes["$file"]="$hash"
-    done < "$HASH_FILE"
-fi
 
-> "$TEMP_RESOURCES"
-> "$OUTPUT_DIR/$MAIN_HEADER"
+> "$OUTPUT_DIR/$BLOB_NAME"
 > "$HASH_FILE"
 
-# Function to create a valid C variable name from file path
-function make_var_name() {
-    local file="$1"
-    local rel_path="${file#$DIST_DIR/}"
-    local var_name="res_$(echo "$rel_path" | tr -c '[:alnum:]' '_')"
-    echo "$var_name"
+# Must match VirtualFileSystem::get_mime_type
+function mime_type() {
+    case "$1" in
+        *.html) echo "text/html" ;;
+        *.css) echo "text/css" ;;
+        *.js) echo "application/javascript" ;;
+        *.png) echo "image/png" ;;
+        *.jpg | *.jpeg) echo "image/jpeg" ;;
+        *.svg) echo "image/svg+xml" ;;
+        *.json) echo "application/json" ;;
+        *.wasm) echo "application/wasm" ;;
+        *.zip) echo "application/zip" ;;
+        *) echo "application/octet-stream" ;;
+    esac
 }
 
-# Add header guard to the main header file
-cat > "$OUTPUT_DIR/$MAIN_HEADER" << EOF
-#ifndef MEMBRANE_RESOURCES_HPP
-#define MEMBRANE_RESOURCES_HPP
-// Auto-generated resource headers for Membrane
-EOF
+# Escapes a path for use in a C++ string literal
+function c_string() {
+    printf '%s' "$1" | sed 's/\\/\\\\/g; s/"/\\"/g'
+}
+
+# The hash of ResourcePack.hpp. Bash arithmetic wraps at 64 bits like
+# uint64_t; only >> and % need their unsigned forms spelled out.
+function mix() {
+    local h=$1
+    h=$(( h ^ ((h >> 33) & 0x7FFFFFFF) ))
+    h=$(( h * 0xFF51AFD7ED558CCD ))
+    MIX=$(( h ^ ((h >> 33) & 0x7FFFFFFF) ))
+}
+
+# $1 % $2 with $1 taken as unsigned
+function umod() {
+    UMOD=$(( ((($1 >> 1) & 0x7FFFFFFFFFFFFFFF) % $2 * 2 + ($1 & 1)) % $2 ))
+}
+
+function path_hash() {
+    local LC_ALL=C
+    local key=$1 h=$((0xCBF29CE484222325)) k c
+    for ((k = 0; k < ${#key}; k++)); do
+        printf -v c '%d' "'${key:k:1}"
+        h=$(( (h ^ c) * 0x100000001B3 ))
+    done
+    mix "$h"
+    HASH=$MIX
+}
+
+# Searches the displacement of every bucket of paths, as ResourcePackIndex
+# expects them: buckets of several paths first, largest first, then the
+# single ones straight into the free slots. Sets SLOT_OF (record index by
+# slot) and DISPLACEMENTS.
+function build_index() {
+    local n=${#paths[@]} i b d s size largest=0 free=0 placed clash
+    local -a hashes buckets sizes
+    SLOT_OF=()
+    DISPLACEMENTS=()
+    for ((i = 0; i < n; i++)); do
+        path_hash "${paths[i]}"
+        hashes[i]=$HASH
+        umod "$HASH" "$n"
+        buckets[UMOD]+=" $i"
+        sizes[UMOD]=$(( ${sizes[UMOD]:-0} + 1 ))
+        DISPLACEMENTS[i]=0
+    done
+    for ((b = 0; b < n; b++)); do
+        (( ${sizes[b]:-0} > largest )) && largest=${sizes[b]}
+    done
+    for ((size = largest; size >= 2; size--)); do
+        for ((b = 0; b < n; b++)); do
+            (( ${sizes[b]:-0} == size )) || continue
+            for ((d = 1; ; d++)); do
+                if ((d > 100000)); then
+                    echo "❌ Resource paths with the same hash:${buckets[b]}" >&2
+                    exit 1
+                fi
+                placed=" "
+                clash=0
+                for i in ${buckets[b]}; do
+                    mix $(( hashes[i] + d * 0x9E3779B97F4A7C15 ))
+                    umod "$MIX" "$n"
+                    if [[ -n ${SLOT_OF[UMOD]} || $placed == *" $UMOD "* ]]; then
+                        clash=1
+                        break
+                    fi
+                    placed+="$UMOD "
+                done
+                ((clash)) || break
+            done
+            for i in ${buckets[b]}; do
+                mix $(( hashes[i] + d * 0x9E3779B97F4A7C15 ))
+                umod "$MIX" "$n"
+                SLOT_OF[UMOD]=$i
+            done
+            DISPLACEMENTS[b]=$d
+        done
+    done
+    for ((b = 0; b < n; b++)); do
+        (( ${sizes[b]:-0} == 1 )) || continue
+        while [[ -n ${SLOT_OF[free]} ]]; do free=$((free + 1)); done
+        SLOT_OF[free]=${buckets[b]# }
+        DISPLACEMENTS[b]=$(( -free - 1 ))
+    done
+}
 
 echo "Processing files in $DIST_DIR..."
 
-find "$DIST_DIR" -type f -not -path "*/\.*" | while read -r file; do
+paths=()
+records=()
+offset=0
+while read -r file; do
     rel_path="${file#$DIST_DIR/}"
-    var_name=$(make_var_name "$file")
+    size=$(wc -c < "$file" | tr -d ' ')
     new_hash=$(sha256sum "$file" | awk '{print $1}')
+    echo "Packing: $rel_path"
 
-    if [[ "${prev_hashes[$rel_path]}" == "$new_hash" ]]; then
-        echo "Skipping unchanged: $rel_path"
-    else
-        echo "Processing: $rel_path"
-        xxd -i -n "$var_name" "$file" > "$HEADERS_DIR/${var_name}.hpp"
-    fi
-
+    cat "$file" >> "$OUTPUT_DIR/$BLOB_NAME"
+    paths+=("$rel_path")
+    records+=("        {\"$(c_string "$rel_path")\", $offset, $size, \"$(mime_type "$rel_path")\", \"\\\"${new_hash:0:16}\\\"\"},")
     echo "$new_hash $rel_path" >> "$HASH_FILE"
-    echo "#include \"headers/${var_name}.hpp\"" >> "$OUTPUT_DIR/$MAIN_HEADER"
-    echo "$var_name|$rel_path" >> "$TEMP_RESOURCES"
-done
+    offset=$((offset + size))
+done < <(find "$DIST_DIR" -type f -not -path "*/\.*" | sort)
 
-echo "#endif" >> "$OUTPUT_DIR/$MAIN_HEADER"
+duplicate=$(printf '%s\n' "${paths[@]}" | sort | uniq -d | head -n 1)
+if [ -n "$duplicate" ]; then
+    echo "❌ Duplicate resource path: $duplicate" >&2
+    exit 1
+fi
+count=${#paths[@]}
+echo "Building the resource index..."
+build_index
+slot_records=""
+for ((slot = 0; slot < count; slot++)); do
+    slot_records+="${records[SLOT_OF[slot]]}"$'\n'
+done
+displacements=""
+for ((b = 0; b < count; b += 16)); do
+    line="${DISPLACEMENTS[*]:b:16}"
+    displacements+="        ${line// /, },"$'\n'
+done
+blob_size=$(wc -c < "$OUTPUT_DIR/$BLOB_NAME" | tr -d ' ')
+blob_hash=$(sha256sum "$OUTPUT_DIR/$BLOB_NAME" | awk '{print $1}')
+blob_path="$(cd "$OUTPUT_DIR" && pwd)/$BLOB_NAME"
 
-# Create a resource initialization file
+# Create a resource initialization file. The blob is embedded with #embed
+# where the compiler supports it, otherwise with the assembler's .incbin;
+# either way it never goes through the compiler as an array literal.
 cat > "$OUTPUT_DIR/resource_init.cpp" << EOF
+// Auto-generated by the Membrane resource compiler
+// blob sha256: $blob_hash
+#include <array>
 #include "Membrane.hpp"
-#include "aggregate.hpp"
+#include "ResourcePack.hpp"
+
+#if defined(__has_embed)
+#if __has_embed("$BLOB_NAME")
+#define MEMBRANE_EMBED_BLOB
+#endif
+#endif
+
+#ifdef MEMBRANE_EMBED_BLOB
+alignas(16) static constexpr unsigned char membrane_resource_blob[] = {
+#embed "$BLOB_NAME" if_empty(0)
+};
+#else
+#if defined(__APPLE__)
+#define MEMBRANE_BLOB_SYMBOL "_membrane_resource_blob"
+#define MEMBRANE_BLOB_SECTION ".const_data"
+#else
+#define MEMBRANE_BLOB_SYMBOL "membrane_resource_blob"
+#define MEMBRANE_BLOB_SECTION ".section .rodata"
+#endif
+__asm__(MEMBRANE_BLOB_SECTION "\n"
+        ".balign 16\n"
+        ".globl " MEMBRANE_BLOB_SYMBOL "\n"
+        MEMBRANE_BLOB_SYMBOL ":\n"
+        ".incbin \"$(c_string "$blob_path")\"\n"
+        ".byte 0\n"
+        ".text\n");
+extern "C" const unsigned char membrane_resource_blob[];
+#endif
+
+namespace {
+// records in slot order, then the displacement of each bucket
+constexpr ResourcePackIndex<$count> resource_index{
+    {{
+${slot_records}    }},
+    {{
+${displacements}    }},
+};
+const ResourcePack resource_pack(membrane_resource_blob, $blob_size,
+                                 resource_index);
+}  // namespace
+
 void initialize_resources(Membrane& app) {
-$(while IFS="|" read -r var_name path; do
-    echo "    app.add_vfs(\"$path\", $var_name, ${var_name}_len);"
-done < "$TEMP_RESOURCES")
+    app.add_resource_pack(resource_pack);
 }
 EOF
 
@@ -89,5 +227,4 @@ void initialize_resources(Membrane& app);
 #endif // MEMBRANE_RESOURCE_INIT_HPP
 EOF
 
-rm "$TEMP_RESOURCES"
 echo "✅ Resource compilation complete!"